@@ -4,6 +4,10 @@
  */
 
 #include "aht20.h"
+#include "evlog.h"
+#include "i2c_trace.h"
+#include "sensor_sim.h"
+#include "power_mgmt.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -39,11 +43,21 @@ static const char *TAG = "AHT20";
 static esp_err_t aht20_write_cmd(aht20_handle_t *handle, uint8_t cmd, uint8_t param1, uint8_t param2)
 {
     uint8_t write_buf[3] = {cmd, param1, param2};
-    return i2c_master_write_to_device(
+    power_lock_acquire(POWER_LOCK_I2C);
+    I2C_TRACE_BEGIN(start);
+#ifdef CONFIG_SENSOR_SIMULATED
+    (void)handle;
+    esp_err_t ret = sensor_sim_transfer(AHT20_I2C_ADDR, write_buf, 3, NULL, 0);
+#else
+    esp_err_t ret = i2c_master_write_to_device(
         handle->config.i2c_port,
         AHT20_I2C_ADDR,
         write_buf, 3,
         pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+#endif
+    I2C_TRACE_END(start, MEASUREMENT_I2C_AHT20, sizeof(write_buf), ret);
+    power_lock_release(POWER_LOCK_I2C);
+    return ret;
 }
 
 /**
@@ -51,11 +65,21 @@ static esp_err_t aht20_write_cmd(aht20_handle_t *handle, uint8_t cmd, uint8_t pa
  */
 static esp_err_t aht20_read_data(aht20_handle_t *handle, uint8_t *data, size_t len)
 {
-    return i2c_master_read_from_device(
+    power_lock_acquire(POWER_LOCK_I2C);
+    I2C_TRACE_BEGIN(start);
+#ifdef CONFIG_SENSOR_SIMULATED
+    (void)handle;
+    esp_err_t ret = sensor_sim_transfer(AHT20_I2C_ADDR, NULL, 0, data, len);
+#else
+    esp_err_t ret = i2c_master_read_from_device(
         handle->config.i2c_port,
         AHT20_I2C_ADDR,
         data, len,
         pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+#endif
+    I2C_TRACE_END(start, MEASUREMENT_I2C_AHT20, len, ret);
+    power_lock_release(POWER_LOCK_I2C);
+    return ret;
 }
 
 /**
@@ -98,6 +122,98 @@ static esp_err_t aht20_wait_ready(aht20_handle_t *handle, uint32_t timeout_ms)
     }
 }
 
+/**
+ * Validate a measurement frame (status + 5 data bytes + CRC)
+ */
+static esp_err_t aht20_check_frame(const uint8_t *data)
+{
+    if (data[0] & AHT20_STATUS_BUSY)
+    {
+        ESP_LOGW(TAG, "Sensor still busy after wait");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!aht20_frame_crc_ok(data))
+    {
+        ESP_LOGW(TAG, "CRC mismatch (0x%02X != 0x%02X)", aht20_crc8(data, 6), data[6]);
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Convert a validated frame, check the result is plausible
+ */
+static esp_err_t aht20_frame_result(aht20_handle_t *handle, const uint8_t *data, float *temp, float *humidity)
+{
+    uint32_t raw_humidity, raw_temp;
+    float t, rh;
+    aht20_parse_frame(data, &raw_humidity, &raw_temp);
+    aht20_convert(raw_humidity, raw_temp, &t, &rh);
+
+    // Sanity check: sensor range, all-zero / all-one raw values
+    if (!aht20_result_valid(raw_humidity, t))
+    {
+        ESP_LOGW(TAG, "Implausible reading: %.2f°C, %.2f%%", t, rh);
+        handle->stats.implausible++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    *temp = t;
+    *humidity = rh;
+    handle->stats.reads++;
+
+    EVLOG2(EVLOG_AHT20_READ, evlog_f(*temp), evlog_f(*humidity));
+    ESP_LOGI(TAG, "Temperature: %.2f°C, Humidity: %.2f%%", *temp, *humidity);
+    return ESP_OK;
+}
+
+/**
+ * One conversion: trigger, wait and read a validated frame
+ */
+static esp_err_t aht20_measure(aht20_handle_t *handle, uint8_t *data)
+{
+    // Trigger measurement
+    esp_err_t ret = aht20_write_cmd(handle, AHT20_CMD_TRIGGER,
+                                    AHT20_TRIGGER_PARAM1, AHT20_TRIGGER_PARAM2);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to trigger measurement");
+        return ret;
+    }
+
+    // Wait for measurement to complete
+    vTaskDelay(pdMS_TO_TICKS(AHT20_MEASUREMENT_DELAY_MS));
+
+    // Wait for sensor to be ready
+    ret = aht20_wait_ready(handle, 100);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    // The sensor keeps the result: after a CRC error, reading it again
+    // is much cheaper than a new conversion
+    for (int read = 0; read < 2; read++)
+    {
+        // Read measurement data (7 bytes: status + data + CRC)
+        ret = aht20_read_data(handle, data, AHT20_FRAME_LEN);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read measurement data");
+            return ret;
+        }
+        memcpy(handle->last_frame, data, AHT20_FRAME_LEN);
+
+        ret = aht20_check_frame(data);
+        if (ret != ESP_ERR_INVALID_CRC)
+        {
+            return ret;
+        }
+        handle->stats.crc_errors++;
+    }
+    return ret;
+}
+
 esp_err_t aht20_soft_reset(aht20_handle_t *handle)
 {
     if (handle == NULL || !handle->initialized)
@@ -106,11 +222,19 @@ esp_err_t aht20_soft_reset(aht20_handle_t *handle)
     }
 
     uint8_t cmd = AHT20_CMD_SOFT_RESET;
+    power_lock_acquire(POWER_LOCK_I2C);
+    I2C_TRACE_BEGIN(start);
+#ifdef CONFIG_SENSOR_SIMULATED
+    esp_err_t ret = sensor_sim_transfer(AHT20_I2C_ADDR, &cmd, 1, NULL, 0);
+#else
     esp_err_t ret = i2c_master_write_to_device(
         handle->config.i2c_port,
         AHT20_I2C_ADDR,
         &cmd, 1,
         pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+#endif
+    I2C_TRACE_END(start, MEASUREMENT_I2C_AHT20, 1, ret);
+    power_lock_release(POWER_LOCK_I2C);
 
     if (ret != ESP_OK)
     {
@@ -136,6 +260,8 @@ esp_err_t aht20_init(aht20_handle_t *handle, const aht20_config_t *config)
 
     // Copy configuration
     memcpy(&handle->config, config, sizeof(aht20_config_t));
+    handle->retry.max_attempts = AHT20_DEFAULT_ATTEMPTS;
+    handle->retry.budget_ms = AHT20_DEFAULT_BUDGET_MS;
 
     // Configure and install I2C driver (if not already done)
     i2c_config_t i2c_conf = {
@@ -171,7 +297,10 @@ esp_err_t aht20_init(aht20_handle_t *handle, const aht20_config_t *config)
     }
 
     // Wait for sensor to be ready after power-up
-    vTaskDelay(pdMS_TO_TICKS(40));
+    if (!config->powered)
+    {
+        vTaskDelay(pdMS_TO_TICKS(40));
+    }
 
     // Check status
     uint8_t status;
@@ -229,69 +358,107 @@ esp_err_t aht20_read(aht20_handle_t *handle, float *temp, float *humidity)
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Trigger measurement
+    TickType_t start = xTaskGetTickCount();
+    esp_err_t ret = ESP_FAIL;
+
+    for (uint8_t attempt = 0; attempt < handle->retry.max_attempts; attempt++)
+    {
+        if (attempt > 0)
+        {
+            // Only start another conversion if it ends within the budget
+            uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+            if (elapsed_ms + AHT20_MEASUREMENT_DELAY_MS > handle->retry.budget_ms)
+            {
+                break;
+            }
+            handle->stats.retries++;
+            EVLOG2(EVLOG_AHT20_RETRY, attempt, ret);
+        }
+
+        uint8_t data[AHT20_FRAME_LEN];
+        ret = aht20_measure(handle, data);
+        if (ret == ESP_ERR_INVALID_CRC)
+        {
+            continue;
+        }
+        if (ret != ESP_OK)
+        {
+            handle->stats.bus_errors++;
+            continue;
+        }
+
+        ret = aht20_frame_result(handle, data, temp, humidity);
+        if (ret == ESP_OK)
+        {
+            return ESP_OK;
+        }
+    }
+
+    handle->stats.failures++;
+    ESP_LOGE(TAG, "Read failed: %s", esp_err_to_name(ret));
+    return ret;
+}
+
+esp_err_t aht20_trigger(aht20_handle_t *handle)
+{
+    if (handle == NULL || !handle->initialized)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
     esp_err_t ret = aht20_write_cmd(handle, AHT20_CMD_TRIGGER,
                                     AHT20_TRIGGER_PARAM1, AHT20_TRIGGER_PARAM2);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to trigger measurement");
-        return ret;
     }
+    return ret;
+}
 
-    // Wait for measurement to complete
-    vTaskDelay(pdMS_TO_TICKS(AHT20_MEASUREMENT_DELAY_MS));
+esp_err_t aht20_read_triggered(aht20_handle_t *handle, float *temp, float *humidity)
+{
+    if (handle == NULL || !handle->initialized || temp == NULL || humidity == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    // Wait for sensor to be ready
-    ret = aht20_wait_ready(handle, 100);
+    // Normally long finished; a trigger right before a short sleep may not be
+    esp_err_t ret = aht20_wait_ready(handle, AHT20_MEASUREMENT_DELAY_MS);
     if (ret != ESP_OK)
     {
         return ret;
     }
 
-    // Read measurement data (7 bytes: status + data)
-    uint8_t data[7];
-    ret = aht20_read_data(handle, data, 7);
+    uint8_t data[AHT20_FRAME_LEN];
+    ret = aht20_read_data(handle, data, AHT20_FRAME_LEN);
     if (ret != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to read measurement data");
         return ret;
     }
+    memcpy(handle->last_frame, data, AHT20_FRAME_LEN);
 
-    // Check status
-    if (data[0] & AHT20_STATUS_BUSY)
+    ret = aht20_check_frame(data);
+    if (ret == ESP_ERR_INVALID_CRC)
     {
-        ESP_LOGW(TAG, "Sensor still busy after wait");
-        return ESP_ERR_INVALID_STATE;
+        handle->stats.crc_errors++;
     }
-
-    // Extract humidity data (20 bits)
-    uint32_t raw_humidity = ((uint32_t)data[1] << 12) |
-                            ((uint32_t)data[2] << 4) |
-                            ((uint32_t)data[3] >> 4);
-
-    // Extract temperature data (20 bits)
-    uint32_t raw_temp = (((uint32_t)data[3] & 0x0F) << 16) |
-                        ((uint32_t)data[4] << 8) |
-                        (uint32_t)data[5];
-
-    // Convert to physical values
-    // Humidity: RH% = (raw / 2^20) * 100
-    *humidity = ((float)raw_humidity / 1048576.0f) * 100.0f;
-
-    // Temperature: T(°C) = (raw / 2^20) * 200 - 50
-    *temp = ((float)raw_temp / 1048576.0f) * 200.0f - 50.0f;
-
-    // Sanity check
-    if (*temp < -40.0f || *temp > 85.0f)
+    if (ret != ESP_OK)
     {
-        ESP_LOGW(TAG, "Temperature out of range: %.2f°C", *temp);
+        return ret;
     }
-    if (*humidity < 0.0f || *humidity > 100.0f)
+    return aht20_frame_result(handle, data, temp, humidity);
+}
+
+void aht20_set_retry_policy(aht20_handle_t *handle, const aht20_retry_policy_t *policy)
+{
+    if (handle == NULL || policy == NULL)
     {
-        ESP_LOGW(TAG, "Humidity out of range: %.2f%%", *humidity);
+        return;
     }
 
-    ESP_LOGI(TAG, "Temperature: %.2f°C, Humidity: %.2f%%", *temp, *humidity);
-
-    return ESP_OK;
+    handle->retry = *policy;
+    if (handle->retry.max_attempts == 0)
+    {
+        handle->retry.max_attempts = 1;
+    }
 }
@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include "aht20_conv.h"
 #include "driver/i2c.h"
 #include "esp_err.h"
 #include <stdint.h>
@@ -26,6 +27,10 @@ extern "C"
 // AHT20 I²C address (fixed)
 #define AHT20_I2C_ADDR 0x38
 
+// Default retry policy
+#define AHT20_DEFAULT_ATTEMPTS 3
+#define AHT20_DEFAULT_BUDGET_MS 300
+
     /**
      * Configuration for AHT20 sensor
      */
@@ -35,8 +40,34 @@ extern "C"
         gpio_num_t sda_pin;   ///< SDA GPIO pin
         gpio_num_t scl_pin;   ///< SCL GPIO pin
         uint32_t i2c_freq_hz; ///< I²C clock frequency (typically 100000)
+        bool powered;         ///< Sensor powered up long enough ago: skip the power-up wait
     } aht20_config_t;
 
+    /**
+     * Retry policy of aht20_read()
+     *
+     * A read gives up after max_attempts conversions, or earlier when
+     * another conversion would end after budget_ms.
+     */
+    typedef struct
+    {
+        uint8_t max_attempts; ///< Conversions per read (at least 1)
+        uint16_t budget_ms;   ///< Time limit of one aht20_read() call
+    } aht20_retry_policy_t;
+
+    /**
+     * Read counters since aht20_init()
+     */
+    typedef struct
+    {
+        uint32_t reads;       ///< Successful reads
+        uint32_t retries;     ///< Conversions repeated after an error
+        uint32_t crc_errors;  ///< CRC-8 mismatches (each costs a re-read)
+        uint32_t implausible; ///< Values outside the sensor range or stuck bus patterns
+        uint32_t bus_errors;  ///< I²C errors, busy or timeout
+        uint32_t failures;    ///< Reads that gave up
+    } aht20_stats_t;
+
     /**
      * AHT20 driver handle - contains all state
      * Application must allocate this structure (stack or static)
@@ -44,6 +75,9 @@ extern "C"
     typedef struct
     {
         aht20_config_t config;
+        aht20_retry_policy_t retry;
+        aht20_stats_t stats;
+        uint8_t last_frame[AHT20_FRAME_LEN]; ///< Last frame read, also rejected ones
         bool initialized;
         bool calibrated;
     } aht20_handle_t;
@@ -63,15 +97,50 @@ extern "C"
      * Read temperature and humidity from AHT20
      *
      * Triggers measurement and reads results.
-     * Measurement takes approximately 80ms.
+     * Measurement takes approximately 80ms. The result is checked against
+     * its CRC-8 and the sensor range; on error the conversion is repeated
+     * according to the retry policy.
      *
      * @param handle Pointer to initialized driver handle
      * @param temp Pointer to store temperature in Celsius
      * @param humidity Pointer to store relative humidity in percent
-     * @return ESP_OK on success, error code otherwise
+     * @return ESP_OK on success, ESP_ERR_INVALID_CRC or ESP_ERR_INVALID_RESPONSE
+     *         if every attempt returned bad data, other error codes otherwise
      */
     esp_err_t aht20_read(aht20_handle_t *handle, float *temp, float *humidity);
 
+    /**
+     * Start a conversion and return without waiting
+     *
+     * The sensor keeps the result until the next trigger, also while the
+     * ESP32 deep-sleeps; collect it with aht20_read_triggered().
+     *
+     * @param handle Pointer to initialized driver handle
+     * @return ESP_OK on success, error code otherwise
+     */
+    esp_err_t aht20_trigger(aht20_handle_t *handle);
+
+    /**
+     * Read the result of a conversion started by aht20_trigger()
+     *
+     * No new conversion: on any error the caller falls back to aht20_read().
+     *
+     * @param handle Pointer to initialized driver handle
+     * @param temp Pointer to store temperature in Celsius
+     * @param humidity Pointer to store relative humidity in percent
+     * @return ESP_OK on success, ESP_ERR_INVALID_CRC or ESP_ERR_INVALID_RESPONSE
+     *         for a bad result, other error codes otherwise
+     */
+    esp_err_t aht20_read_triggered(aht20_handle_t *handle, float *temp, float *humidity);
+
+    /**
+     * Set the retry policy (defaults: AHT20_DEFAULT_ATTEMPTS, AHT20_DEFAULT_BUDGET_MS)
+     *
+     * @param handle Pointer to initialized driver handle
+     * @param policy Policy to copy
+     */
+    void aht20_set_retry_policy(aht20_handle_t *handle, const aht20_retry_policy_t *policy);
+
     /**
      * Perform soft reset of AHT20 sensor
      *
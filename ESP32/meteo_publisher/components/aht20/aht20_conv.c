@@ -0,0 +1,49 @@
+/**
+ * @file aht20_conv.c
+ * @brief AHT20 measurement frame checking and conversion
+ */
+
+#include "aht20_conv.h"
+
+uint8_t aht20_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+bool aht20_frame_crc_ok(const uint8_t frame[AHT20_FRAME_LEN])
+{
+    return aht20_crc8(frame, AHT20_FRAME_LEN - 1) == frame[AHT20_FRAME_LEN - 1];
+}
+
+void aht20_parse_frame(const uint8_t frame[AHT20_FRAME_LEN], uint32_t *raw_humidity, uint32_t *raw_temp)
+{
+    // Humidity: bytes 1, 2 and the high nibble of 3
+    *raw_humidity = ((uint32_t)frame[1] << 12) |
+                    ((uint32_t)frame[2] << 4) |
+                    ((uint32_t)frame[3] >> 4);
+
+    // Temperature: low nibble of byte 3, bytes 4 and 5
+    *raw_temp = (((uint32_t)frame[3] & 0x0F) << 16) |
+                ((uint32_t)frame[4] << 8) |
+                (uint32_t)frame[5];
+}
+
+void aht20_convert(uint32_t raw_humidity, uint32_t raw_temp, float *temp, float *humidity)
+{
+    *humidity = ((float)raw_humidity / 1048576.0f) * 100.0f;
+    *temp = ((float)raw_temp / 1048576.0f) * 200.0f - 50.0f;
+}
+
+bool aht20_result_valid(uint32_t raw_humidity, float temp)
+{
+    return temp >= -40.0f && temp <= 85.0f && raw_humidity != 0 && raw_humidity != 0xFFFFF;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file aht20_conv.h
+ * @brief AHT20 measurement frame checking and conversion
+ *
+ * Plain C, no ESP-IDF dependencies: the driver and the host replay tool
+ * (host/sensor_replay) run the same conversion on the same frame.
+ * Frame: status, 20-bit humidity, 20-bit temperature (sharing byte 3), CRC-8.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Status + 5 data bytes + CRC
+#define AHT20_FRAME_LEN 7
+
+    /**
+     * CRC-8 of the measurement bytes (polynomial 0x31, initial value 0xFF)
+     */
+    uint8_t aht20_crc8(const uint8_t *data, size_t len);
+
+    /**
+     * True if the CRC byte matches status and data
+     */
+    bool aht20_frame_crc_ok(const uint8_t frame[AHT20_FRAME_LEN]);
+
+    /**
+     * Extract the 20-bit raw humidity and temperature
+     */
+    void aht20_parse_frame(const uint8_t frame[AHT20_FRAME_LEN], uint32_t *raw_humidity, uint32_t *raw_temp);
+
+    /**
+     * Convert raw values: RH = raw / 2^20 * 100 %, T = raw / 2^20 * 200 - 50 °C
+     */
+    void aht20_convert(uint32_t raw_humidity, uint32_t raw_temp, float *temp, float *humidity);
+
+    /**
+     * False outside the sensor range or for all-zero / all-one humidity
+     */
+    bool aht20_result_valid(uint32_t raw_humidity, float temp);
+
+#ifdef __cplusplus
+}
+#endif
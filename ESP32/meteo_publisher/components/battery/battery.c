@@ -0,0 +1,157 @@
+/**
+ * @file battery.c
+ * @brief Battery voltage measurement implementation
+ */
+
+#include "battery.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_log.h"
+#include "soc/soc_caps.h"
+#include <string.h>
+
+static const char *TAG = "BATTERY";
+
+// 0-3.1 V input range at the pin (about 0-6.2 V battery with a 1:1 divider)
+#define BATTERY_ATTEN ADC_ATTEN_DB_12
+
+// Nominal full scale at BATTERY_ATTEN, used without calibration eFuses
+#define BATTERY_NOMINAL_FULL_SCALE_MV 3100
+
+static adc_cali_handle_t battery_create_cali(adc_unit_t unit, adc_channel_t channel)
+{
+    adc_cali_handle_t cali = NULL;
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t curve = {
+        .unit_id = unit,
+        .chan = channel,
+        .atten = BATTERY_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    ret = adc_cali_create_scheme_curve_fitting(&curve, &cali);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    (void)channel;
+    adc_cali_line_fitting_config_t line = {
+        .unit_id = unit,
+        .atten = BATTERY_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    ret = adc_cali_create_scheme_line_fitting(&line, &cali);
+#endif
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "No ADC calibration (%d), using nominal scale", ret);
+        return NULL;
+    }
+    return cali;
+}
+
+esp_err_t battery_init(battery_handle_t *handle, const battery_config_t *config)
+{
+    if (handle == NULL || config == NULL || config->divider_x1000 == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(handle, 0, sizeof(battery_handle_t));
+    memcpy(&handle->config, config, sizeof(battery_config_t));
+    if (handle->config.samples == 0)
+    {
+        handle->config.samples = 1;
+    }
+
+    adc_unit_t unit;
+    esp_err_t ret = adc_oneshot_io_to_channel(config->gpio, &unit, &handle->channel);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "GPIO %d is not an ADC pin", config->gpio);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adc_oneshot_unit_init_cfg_t unit_cfg = {
+        .unit_id = unit,
+    };
+    ret = adc_oneshot_new_unit(&unit_cfg, &handle->unit);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ADC unit init failed: %d", ret);
+        return ret;
+    }
+
+    adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = BATTERY_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    ret = adc_oneshot_config_channel(handle->unit, handle->channel, &chan_cfg);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ADC channel config failed: %d", ret);
+        adc_oneshot_del_unit(handle->unit);
+        return ret;
+    }
+
+    handle->cali = battery_create_cali(unit, handle->channel);
+    handle->initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t battery_read_mv(battery_handle_t *handle, uint32_t *mv)
+{
+    if (handle == NULL || !handle->initialized || mv == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t sum = 0;
+    for (int i = 0; i < handle->config.samples; i++)
+    {
+        int raw;
+        esp_err_t ret = adc_oneshot_read(handle->unit, handle->channel, &raw);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "ADC read failed: %d", ret);
+            return ret;
+        }
+        sum += raw;
+    }
+    int raw = sum / handle->config.samples;
+
+    int pin_mv;
+    if (handle->cali != NULL)
+    {
+        esp_err_t ret = adc_cali_raw_to_voltage(handle->cali, raw, &pin_mv);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+    }
+    else
+    {
+        pin_mv = raw * BATTERY_NOMINAL_FULL_SCALE_MV / ((1 << SOC_ADC_RTC_MAX_BITWIDTH) - 1);
+    }
+
+    *mv = (uint32_t)pin_mv * handle->config.divider_x1000 / 1000;
+    ESP_LOGI(TAG, "Battery: %lu mV (pin %d mV, raw %d)", (unsigned long)*mv, pin_mv, raw);
+    return ESP_OK;
+}
+
+void battery_deinit(battery_handle_t *handle)
+{
+    if (handle == NULL || !handle->initialized)
+    {
+        return;
+    }
+
+    if (handle->cali != NULL)
+    {
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        adc_cali_delete_scheme_curve_fitting(handle->cali);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        adc_cali_delete_scheme_line_fitting(handle->cali);
+#endif
+    }
+    adc_oneshot_del_unit(handle->unit);
+    handle->initialized = false;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file battery.h
+ * @brief Battery voltage measurement through a calibrated ADC channel
+ *
+ * The battery is connected to an ADC pin through a resistor divider.
+ * Readings use the chip's eFuse calibration (curve or line fitting) and
+ * are averaged over several conversions.
+ * All state is stored in battery_handle_t. Uses the ADC oneshot driver,
+ * which allocates its unit and calibration handles on init.
+ */
+
+#pragma once
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Configuration for battery measurement
+     */
+    typedef struct
+    {
+        int gpio;               ///< ADC-capable GPIO at the divider midpoint
+        uint32_t divider_x1000; ///< Battery voltage / pin voltage × 1000 (2000 for 1:1)
+        uint8_t samples;        ///< Conversions averaged per reading
+    } battery_config_t;
+
+    /**
+     * Battery driver handle - contains all state
+     * Application must allocate this structure (stack or static)
+     */
+    typedef struct
+    {
+        battery_config_t config;
+        adc_oneshot_unit_handle_t unit;
+        adc_channel_t channel;
+        adc_cali_handle_t cali; ///< NULL if the chip has no calibration eFuses
+        bool initialized;
+    } battery_handle_t;
+
+    /**
+     * Initialize the ADC unit, channel and calibration
+     *
+     * @param handle Pointer to driver handle (must be allocated by caller)
+     * @param config Pointer to configuration structure
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the GPIO has no ADC channel
+     */
+    esp_err_t battery_init(battery_handle_t *handle, const battery_config_t *config);
+
+    /**
+     * Read the battery voltage
+     *
+     * Without calibration eFuses the nominal ADC transfer function is used
+     * (accuracy of about ±10%).
+     *
+     * @param handle Pointer to initialized driver handle
+     * @param mv Pointer to store the battery voltage in millivolts
+     * @return ESP_OK on success, error code otherwise
+     */
+    esp_err_t battery_read_mv(battery_handle_t *handle, uint32_t *mv);
+
+    /**
+     * Release the ADC unit and calibration handles
+     *
+     * @param handle Pointer to initialized driver handle
+     */
+    void battery_deinit(battery_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
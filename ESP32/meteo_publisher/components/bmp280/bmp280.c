@@ -4,6 +4,10 @@
  */
 
 #include "bmp280.h"
+#include "evlog.h"
+#include "i2c_trace.h"
+#include "sensor_sim.h"
+#include "power_mgmt.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -28,17 +32,34 @@ static const char *TAG = "BMP280";
 #define BMP280_CHIP_ID 0x58
 #define I2C_TIMEOUT_MS 1000
 
+// ctrl_meas mode bits
+#define BMP280_MODE_MASK 0x03
+#define BMP280_MODE_SLEEP 0x00
+#define BMP280_MODE_NORMAL 0x03
+
+// Standby times of config bits 7..5 (t_sb), in 0.5 ms
+static const uint16_t STANDBY_HALF_MS[] = {1, 125, 250, 500, 1000, 2000, 4000, 8000};
+
 /**
  * Write a single byte to BMP280 register
  */
 static esp_err_t bmp280_write_reg(bmp280_handle_t *handle, uint8_t reg, uint8_t data)
 {
     uint8_t write_buf[2] = {reg, data};
-    return i2c_master_write_to_device(
+    power_lock_acquire(POWER_LOCK_I2C);
+    I2C_TRACE_BEGIN(start);
+#ifdef CONFIG_SENSOR_SIMULATED
+    esp_err_t ret = sensor_sim_transfer(handle->config.i2c_addr, write_buf, 2, NULL, 0);
+#else
+    esp_err_t ret = i2c_master_write_to_device(
         handle->config.i2c_port,
         handle->config.i2c_addr,
         write_buf, 2,
         pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+#endif
+    I2C_TRACE_END(start, MEASUREMENT_I2C_BMP280, sizeof(write_buf), ret);
+    power_lock_release(POWER_LOCK_I2C);
+    return ret;
 }
 
 /**
@@ -46,60 +67,80 @@ static esp_err_t bmp280_write_reg(bmp280_handle_t *handle, uint8_t reg, uint8_t
  */
 static esp_err_t bmp280_read_reg(bmp280_handle_t *handle, uint8_t reg, uint8_t *data, size_t len)
 {
-    return i2c_master_write_read_device(
+    power_lock_acquire(POWER_LOCK_I2C);
+    I2C_TRACE_BEGIN(start);
+#ifdef CONFIG_SENSOR_SIMULATED
+    esp_err_t ret = sensor_sim_transfer(handle->config.i2c_addr, &reg, 1, data, len);
+#else
+    esp_err_t ret = i2c_master_write_read_device(
         handle->config.i2c_port,
         handle->config.i2c_addr,
         &reg, 1,
         data, len,
         pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+#endif
+    I2C_TRACE_END(start, MEASUREMENT_I2C_BMP280, 1 + len, ret);
+    power_lock_release(POWER_LOCK_I2C);
+    return ret;
 }
 
 /**
- * Compensate temperature using calibration data
- * Returns temperature in 0.01 degrees Celsius
+ * Longest standby time code not above period_ms
  */
-static int32_t bmp280_compensate_temp(bmp280_handle_t *handle, int32_t adc_T)
+static uint8_t bmp280_standby_code(uint32_t period_ms)
 {
-    int32_t var1, var2;
-    var1 = ((((adc_T >> 3) - ((int32_t)handle->calib.dig_T1 << 1))) *
-            ((int32_t)handle->calib.dig_T2)) >>
-           11;
-    var2 = (((((adc_T >> 4) - ((int32_t)handle->calib.dig_T1)) *
-              ((adc_T >> 4) - ((int32_t)handle->calib.dig_T1))) >>
-             12) *
-            ((int32_t)handle->calib.dig_T3)) >>
-           14;
-    handle->calib.t_fine = var1 + var2;
-    return (handle->calib.t_fine * 5 + 128) >> 8;
+    uint8_t code = 0;
+    for (uint8_t i = 1; i < sizeof(STANDBY_HALF_MS) / sizeof(STANDBY_HALF_MS[0]); i++)
+    {
+        if (STANDBY_HALF_MS[i] <= period_ms * 2)
+        {
+            code = i;
+        }
+    }
+    return code;
 }
 
 /**
- * Compensate pressure using calibration data
- * Returns pressure in Pa * 256
+ * Run in normal mode, keep the sensor running if it already has these settings
  */
-static uint32_t bmp280_compensate_press(bmp280_handle_t *handle, int32_t adc_P)
+static esp_err_t bmp280_start_normal(bmp280_handle_t *handle)
 {
-    int64_t var1, var2, p;
-    var1 = ((int64_t)handle->calib.t_fine) - 128000;
-    var2 = var1 * var1 * (int64_t)handle->calib.dig_P6;
-    var2 = var2 + ((var1 * (int64_t)handle->calib.dig_P5) << 17);
-    var2 = var2 + (((int64_t)handle->calib.dig_P4) << 35);
-    var1 = ((var1 * var1 * (int64_t)handle->calib.dig_P3) >> 8) +
-           ((var1 * (int64_t)handle->calib.dig_P2) << 12);
-    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)handle->calib.dig_P1) >> 33;
-
-    if (var1 == 0)
+    uint8_t t_sb = bmp280_standby_code(handle->config.continuous_ms);
+    uint8_t config_value = (uint8_t)(t_sb << 5) | handle->mode_config.config_value;
+    uint8_t ctrl_meas = (handle->mode_config.ctrl_meas_value & ~BMP280_MODE_MASK) | BMP280_MODE_NORMAL;
+
+    // ctrl_meas and config are adjacent (0xF4, 0xF5)
+    uint8_t regs[2];
+    esp_err_t ret = bmp280_read_reg(handle, BMP280_REG_CTRL_MEAS, regs, sizeof(regs));
+    if (ret != ESP_OK)
     {
-        return 0;
+        return ret;
+    }
+    if (regs[0] == ctrl_meas && regs[1] == config_value)
+    {
+        ESP_LOGI(TAG, "Normal mode running, standby %u.%u ms", STANDBY_HALF_MS[t_sb] / 2, (STANDBY_HALF_MS[t_sb] % 2) * 5);
+        return ESP_OK;
     }
 
-    p = 1048576 - adc_P;
-    p = (((p << 31) - var2) * 3125) / var1;
-    var1 = (((int64_t)handle->calib.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-    var2 = (((int64_t)handle->calib.dig_P8) * p) >> 19;
-    p = ((p + var1 + var2) >> 8) + (((int64_t)handle->calib.dig_P7) << 4);
+    // The config register is only reliably written in sleep mode
+    ret = bmp280_write_reg(handle, BMP280_REG_CTRL_MEAS, ctrl_meas & ~BMP280_MODE_MASK);
+    if (ret == ESP_OK)
+    {
+        ret = bmp280_write_reg(handle, BMP280_REG_CONFIG, config_value);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = bmp280_write_reg(handle, BMP280_REG_CTRL_MEAS, ctrl_meas);
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start normal mode");
+        return ret;
+    }
 
-    return (uint32_t)p;
+    handle->continuous_wait = true;
+    ESP_LOGI(TAG, "Normal mode started, standby %u.%u ms", STANDBY_HALF_MS[t_sb] / 2, (STANDBY_HALF_MS[t_sb] % 2) * 5);
+    return ESP_OK;
 }
 
 esp_err_t bmp280_init(bmp280_handle_t *handle, const bmp280_config_t *config)
@@ -114,6 +155,8 @@ esp_err_t bmp280_init(bmp280_handle_t *handle, const bmp280_config_t *config)
 
     // Copy configuration
     memcpy(&handle->config, config, sizeof(bmp280_config_t));
+    handle->retry.max_attempts = BMP280_DEFAULT_ATTEMPTS;
+    handle->retry.budget_ms = BMP280_DEFAULT_BUDGET_MS;
 
     // Configure mode-specific settings
     switch (config->mode)
@@ -122,21 +165,21 @@ esp_err_t bmp280_init(bmp280_handle_t *handle, const bmp280_config_t *config)
         // Ultra low power: osrs_t=001 (×1), osrs_p=001 (×1), mode=01 (forced)
         handle->mode_config.ctrl_meas_value = 0x25; // 00100101
         handle->mode_config.meas_time_ms = 10;
-        bmp280_write_reg(handle, BMP280_REG_CONFIG, 0x00); // Filter off
+        handle->mode_config.config_value = 0x00; // Filter off
         break;
 
     case BMP280_MODE_HIGH_RESOLUTION:
         // High resolution: osrs_t=010 (×2), osrs_p=101 (×16), mode=01 (forced)
         handle->mode_config.ctrl_meas_value = 0x55; // 01010101
         handle->mode_config.meas_time_ms = 50;
-        bmp280_write_reg(handle, BMP280_REG_CONFIG, 0x00); // Filter off
+        handle->mode_config.config_value = 0x00; // Filter off
         break;
 
     case BMP280_MODE_METEO_ULTRA_PRECISION:
         // Ultra precision: osrs_t=111 (×16), osrs_p=101 (×16), mode=01 (forced)
         handle->mode_config.ctrl_meas_value = 0xB5; // 10110101
         handle->mode_config.meas_time_ms = 100;
-        bmp280_write_reg(handle, BMP280_REG_CONFIG, 0x10); // Filter=16
+        handle->mode_config.config_value = 0x10; // Filter=16
         break;
 
     default:
@@ -188,31 +231,37 @@ esp_err_t bmp280_init(bmp280_handle_t *handle, const bmp280_config_t *config)
     ESP_LOGI(TAG, "BMP280 detected (ID: 0x%02X)", chip_id);
 
     // Read calibration data
-    uint8_t calib_data[24];
-    ret = bmp280_read_reg(handle, BMP280_REG_CALIB, calib_data, 24);
+    ret = bmp280_read_reg(handle, BMP280_REG_CALIB, handle->calib_raw, BMP280_CALIB_LEN);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to read calibration data");
         return ret;
     }
+    bmp280_parse_calib(handle->calib_raw, &handle->calib);
 
-    // Parse calibration coefficients
-    handle->calib.dig_T1 = (calib_data[1] << 8) | calib_data[0];
-    handle->calib.dig_T2 = (calib_data[3] << 8) | calib_data[2];
-    handle->calib.dig_T3 = (calib_data[5] << 8) | calib_data[4];
-    handle->calib.dig_P1 = (calib_data[7] << 8) | calib_data[6];
-    handle->calib.dig_P2 = (calib_data[9] << 8) | calib_data[8];
-    handle->calib.dig_P3 = (calib_data[11] << 8) | calib_data[10];
-    handle->calib.dig_P4 = (calib_data[13] << 8) | calib_data[12];
-    handle->calib.dig_P5 = (calib_data[15] << 8) | calib_data[14];
-    handle->calib.dig_P6 = (calib_data[17] << 8) | calib_data[16];
-    handle->calib.dig_P7 = (calib_data[19] << 8) | calib_data[18];
-    handle->calib.dig_P8 = (calib_data[21] << 8) | calib_data[20];
-    handle->calib.dig_P9 = (calib_data[23] << 8) | calib_data[22];
-
-    // Put sensor in sleep mode initially
-    uint8_t sleep_mode = handle->mode_config.ctrl_meas_value & 0xFC;
-    bmp280_write_reg(handle, BMP280_REG_CTRL_MEAS, sleep_mode);
+    if (config->continuous_ms != 0)
+    {
+        ret = bmp280_start_normal(handle);
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+        handle->continuous = true;
+    }
+    else
+    {
+        // Put sensor in sleep mode first: config writes may be ignored in normal mode
+        uint8_t sleep_mode = (handle->mode_config.ctrl_meas_value & ~BMP280_MODE_MASK) | BMP280_MODE_SLEEP;
+        bmp280_write_reg(handle, BMP280_REG_CTRL_MEAS, sleep_mode);
+
+        // Filter setting: the mode may differ from the previous wake
+        ret = bmp280_write_reg(handle, BMP280_REG_CONFIG, handle->mode_config.config_value);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to write config register");
+            return ret;
+        }
+    }
 
     const char *mode_name =
         (config->mode == BMP280_MODE_WEATHER_MONITORING) ? "Weather monitoring" : (config->mode == BMP280_MODE_HIGH_RESOLUTION) ? "High resolution"
@@ -224,13 +273,34 @@ esp_err_t bmp280_init(bmp280_handle_t *handle, const bmp280_config_t *config)
     return ESP_OK;
 }
 
-esp_err_t bmp280_read(bmp280_handle_t *handle, float *temp, float *press)
+/**
+ * Latest result of normal mode, without triggering
+ */
+static esp_err_t bmp280_read_latest(bmp280_handle_t *handle, int32_t *adc_T, int32_t *adc_P)
 {
-    if (handle == NULL || !handle->initialized || temp == NULL || press == NULL)
+    if (handle->continuous_wait)
     {
-        return ESP_ERR_INVALID_ARG;
+        // First measurement after (re)start
+        vTaskDelay(pdMS_TO_TICKS(handle->mode_config.meas_time_ms));
+        handle->continuous_wait = false;
     }
 
+    esp_err_t ret = bmp280_read_reg(handle, BMP280_REG_PRESS_MSB, handle->last_data, BMP280_DATA_LEN);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to read sensor data");
+        return ret;
+    }
+
+    bmp280_parse_data(handle->last_data, adc_T, adc_P);
+    return ESP_OK;
+}
+
+/**
+ * One forced measurement: trigger, wait for completion, read raw values
+ */
+static esp_err_t bmp280_measure(bmp280_handle_t *handle, int32_t *adc_T, int32_t *adc_P)
+{
     // Trigger forced mode measurement
     esp_err_t ret = bmp280_write_reg(handle, BMP280_REG_CTRL_MEAS,
                                      handle->mode_config.ctrl_meas_value);
@@ -244,36 +314,144 @@ esp_err_t bmp280_read(bmp280_handle_t *handle, float *temp, float *press)
     vTaskDelay(pdMS_TO_TICKS(handle->mode_config.meas_time_ms));
 
     // Check if measurement is done
-    uint8_t status;
+    uint8_t status = 0x08;
     for (int i = 0; i < 10; i++)
     {
-        bmp280_read_reg(handle, BMP280_REG_STATUS, &status, 1);
+        ret = bmp280_read_reg(handle, BMP280_REG_STATUS, &status, 1);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read status");
+            return ret;
+        }
         if ((status & 0x08) == 0)
             break; // measuring bit cleared
         vTaskDelay(pdMS_TO_TICKS(1));
     }
+    if (status & 0x08)
+    {
+        ESP_LOGW(TAG, "Measurement not finished");
+        return ESP_ERR_TIMEOUT;
+    }
 
     // Read sensor data
-    uint8_t data[6];
-    ret = bmp280_read_reg(handle, BMP280_REG_PRESS_MSB, data, 6);
+    ret = bmp280_read_reg(handle, BMP280_REG_PRESS_MSB, handle->last_data, BMP280_DATA_LEN);
     if (ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to read sensor data");
         return ret;
     }
 
-    // Parse ADC values
-    int32_t adc_P = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
-    int32_t adc_T = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+    bmp280_parse_data(handle->last_data, adc_T, adc_P);
+    return ESP_OK;
+}
+
+esp_err_t bmp280_read(bmp280_handle_t *handle, float *temp, float *press)
+{
+    if (handle == NULL || !handle->initialized || temp == NULL || press == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    esp_err_t ret = ESP_FAIL;
+
+    for (uint8_t attempt = 0; attempt < handle->retry.max_attempts; attempt++)
+    {
+        if (attempt > 0)
+        {
+            // Only start another measurement if it ends within the budget
+            uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+            if (elapsed_ms + handle->mode_config.meas_time_ms > handle->retry.budget_ms)
+            {
+                break;
+            }
+            handle->stats.retries++;
+            EVLOG2(EVLOG_BMP280_RETRY, attempt, ret);
+        }
+
+        int32_t adc_T, adc_P;
+        if (handle->continuous && attempt == 0)
+        {
+            ret = bmp280_read_latest(handle, &adc_T, &adc_P);
+        }
+        else
+        {
+            // Forced measurement ends normal mode (restarted by the next bmp280_init())
+            handle->continuous = false;
+            ret = bmp280_measure(handle, &adc_T, &adc_P);
+        }
+        if (ret != ESP_OK)
+        {
+            handle->stats.bus_errors++;
+            continue;
+        }
+
+        // Compensate and convert
+        float t, p;
+        ret = bmp280_convert(handle, adc_T, adc_P, &t, &p);
+        if (ret != ESP_OK)
+        {
+            handle->stats.implausible++;
+            continue;
+        }
+
+        handle->last_adc_T = adc_T;
+        handle->last_adc_P = adc_P;
+        *temp = t;
+        *press = p;
+        handle->stats.reads++;
+
+        EVLOG2(EVLOG_BMP280_READ, evlog_f(*temp), evlog_f(*press));
+        ESP_LOGI(TAG, "Temperature: %.2f°C, Pressure: %.2f Pa", *temp, *press);
+
+        return ESP_OK;
+    }
+
+    handle->stats.failures++;
+    ESP_LOGE(TAG, "Read failed: %s", esp_err_to_name(ret));
+    return ret;
+}
+
+void bmp280_set_retry_policy(bmp280_handle_t *handle, const bmp280_retry_policy_t *policy)
+{
+    if (handle == NULL || policy == NULL)
+    {
+        return;
+    }
+
+    handle->retry = *policy;
+    if (handle->retry.max_attempts == 0)
+    {
+        handle->retry.max_attempts = 1;
+    }
+}
+
+esp_err_t bmp280_convert(bmp280_handle_t *handle, int32_t adc_T, int32_t adc_P,
+                         float *temp, float *press)
+{
+    if (handle == NULL || !handle->initialized || temp == NULL || press == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!bmp280_raw_valid(adc_T, adc_P))
+    {
+        ESP_LOGW(TAG, "Implausible raw values: T=0x%05lX P=0x%05lX", (unsigned long)adc_T, (unsigned long)adc_P);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Temperature first: pressure compensation depends on t_fine
+    int32_t T = bmp280_compensate_temp(&handle->calib, adc_T);
+    uint32_t P = bmp280_compensate_press(&handle->calib, adc_P);
 
-    // Compensate and convert
-    int32_t T = bmp280_compensate_temp(handle, adc_T);
-    uint32_t P = bmp280_compensate_press(handle, adc_P);
+    if (!bmp280_result_valid(T, P))
+    {
+        ESP_LOGW(TAG, "Implausible reading: T=%ld (0.01 C) P=%lu (Pa/256)", (long)T, (unsigned long)P);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
     *temp = T / 100.0f;
     *press = P / 256.0f;
 
-    ESP_LOGI(TAG, "Temperature: %.2f°C, Pressure: %.2f Pa", *temp, *press);
-
     return ESP_OK;
 }
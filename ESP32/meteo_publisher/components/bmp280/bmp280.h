@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "bmp280_conv.h"
 #include "driver/i2c.h"
 #include "esp_err.h"
 #include <stdint.h>
@@ -18,6 +19,10 @@ extern "C"
 {
 #endif
 
+// Default retry policy
+#define BMP280_DEFAULT_ATTEMPTS 3
+#define BMP280_DEFAULT_BUDGET_MS 350
+
     /**
      * Operating modes for BMP280 sensor
      */
@@ -33,42 +38,48 @@ extern "C"
      */
     typedef struct
     {
-        i2c_port_t i2c_port;  ///< I²C port number
-        uint8_t i2c_addr;     ///< I²C device address
-        gpio_num_t sda_pin;   ///< SDA GPIO pin
-        gpio_num_t scl_pin;   ///< SCL GPIO pin
-        uint32_t i2c_freq_hz; ///< I²C clock frequency
-        bmp280_mode_t mode;   ///< Operating mode
+        i2c_port_t i2c_port;    ///< I²C port number
+        uint8_t i2c_addr;       ///< I²C device address
+        gpio_num_t sda_pin;     ///< SDA GPIO pin
+        gpio_num_t scl_pin;     ///< SCL GPIO pin
+        uint32_t i2c_freq_hz;   ///< I²C clock frequency
+        bmp280_mode_t mode;     ///< Operating mode
+        uint32_t continuous_ms; ///< 0: forced measurements; else normal mode, standby up to this
     } bmp280_config_t;
 
     /**
-     * Calibration data structure - internal use
+     * Mode configuration - internal use
      */
     typedef struct
     {
-        uint16_t dig_T1;
-        int16_t dig_T2;
-        int16_t dig_T3;
-        uint16_t dig_P1;
-        int16_t dig_P2;
-        int16_t dig_P3;
-        int16_t dig_P4;
-        int16_t dig_P5;
-        int16_t dig_P6;
-        int16_t dig_P7;
-        int16_t dig_P8;
-        int16_t dig_P9;
-        int32_t t_fine; ///< Fine temperature value (internal)
-    } bmp280_calib_t;
+        uint8_t ctrl_meas_value; ///< Control register value for forced mode
+        uint8_t meas_time_ms;    ///< Typical measurement time in milliseconds
+        uint8_t config_value;    ///< Config register value (IIR filter)
+    } bmp280_mode_config_t;
 
     /**
-     * Mode configuration - internal use
+     * Retry policy of bmp280_read()
+     *
+     * A read gives up after max_attempts measurements, or earlier when
+     * another measurement would end after budget_ms.
      */
     typedef struct
     {
-        uint8_t ctrl_meas_value; ///< Control register value for forced mode
-        uint8_t meas_time_ms;    ///< Typical measurement time in milliseconds
-    } bmp280_mode_config_t;
+        uint8_t max_attempts; ///< Measurements per read (at least 1)
+        uint16_t budget_ms;   ///< Time limit of one bmp280_read() call
+    } bmp280_retry_policy_t;
+
+    /**
+     * Read counters since bmp280_init()
+     */
+    typedef struct
+    {
+        uint32_t reads;       ///< Successful reads
+        uint32_t retries;     ///< Measurements repeated after an error
+        uint32_t implausible; ///< Skipped ADC values or results outside the sensor range
+        uint32_t bus_errors;  ///< I²C errors, measurement not finished
+        uint32_t failures;    ///< Reads that gave up
+    } bmp280_stats_t;
 
     /**
      * BMP280 driver handle - contains all state
@@ -79,12 +90,26 @@ extern "C"
         bmp280_config_t config;
         bmp280_calib_t calib;
         bmp280_mode_config_t mode_config;
+        int32_t last_adc_T; ///< Raw temperature of the last bmp280_read()
+        int32_t last_adc_P; ///< Raw pressure of the last bmp280_read()
+        uint8_t calib_raw[BMP280_CALIB_LEN]; ///< Calibration block as read at bmp280_init()
+        uint8_t last_data[BMP280_DATA_LEN];  ///< Data registers of the last measurement, also rejected ones
+        bmp280_retry_policy_t retry;
+        bmp280_stats_t stats;
+        bool continuous;      ///< Normal mode: reads take the data registers
+        bool continuous_wait; ///< Normal mode just (re)started, first read waits one measurement
         bool initialized;
     } bmp280_handle_t;
 
     /**
      * Initialize BMP280 sensor
      *
+     * With config->continuous_ms the sensor runs in normal mode: it measures
+     * on its own with the longest standby time (0.5 ms..4 s) not above
+     * continuous_ms, also while the ESP32 sleeps. If it already runs with
+     * the same settings it is left alone, so its IIR filter state and the
+     * latest result survive; otherwise it is restarted.
+     *
      * @param handle Pointer to driver handle (must be allocated by caller)
      * @param config Pointer to configuration structure
      * @return ESP_OK on success, error code otherwise
@@ -94,13 +119,45 @@ extern "C"
     /**
      * Read temperature and pressure from BMP280
      *
+     * Raw values are checked for the skipped-measurement value and the
+     * results against the sensor range; on error the measurement is
+     * repeated according to the retry policy.
+     *
+     * In normal mode the first attempt reads the latest result; repeats
+     * are forced measurements, which leave normal mode until the next
+     * bmp280_init().
+     *
      * @param handle Pointer to initialized driver handle
      * @param temp Pointer to store temperature in Celsius
      * @param press Pointer to store pressure in Pascals
-     * @return ESP_OK on success, error code otherwise
+     * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE if every attempt
+     *         returned implausible data, other error codes otherwise
      */
     esp_err_t bmp280_read(bmp280_handle_t *handle, float *temp, float *press);
 
+    /**
+     * Set the retry policy (defaults: BMP280_DEFAULT_ATTEMPTS, BMP280_DEFAULT_BUDGET_MS)
+     *
+     * @param handle Pointer to initialized driver handle
+     * @param policy Policy to copy
+     */
+    void bmp280_set_retry_policy(bmp280_handle_t *handle, const bmp280_retry_policy_t *policy);
+
+    /**
+     * Convert raw ADC values using the handle's calibration data
+     *
+     * For samples read outside the driver (e.g. by the deep-sleep wake stub).
+     *
+     * @param handle Pointer to initialized driver handle
+     * @param adc_T Raw 20-bit temperature value
+     * @param adc_P Raw 20-bit pressure value
+     * @param temp Pointer to store temperature in Celsius
+     * @param press Pointer to store pressure in Pascals
+     * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE for implausible values
+     */
+    esp_err_t bmp280_convert(bmp280_handle_t *handle, int32_t adc_T, int32_t adc_P,
+                             float *temp, float *press);
+
 #ifdef __cplusplus
 }
 #endif
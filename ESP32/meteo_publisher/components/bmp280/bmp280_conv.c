@@ -0,0 +1,83 @@
+/**
+ * @file bmp280_conv.c
+ * @brief BMP280 register parsing and compensation
+ */
+
+#include "bmp280_conv.h"
+
+void bmp280_parse_calib(const uint8_t raw[BMP280_CALIB_LEN], bmp280_calib_t *calib)
+{
+    calib->dig_T1 = (raw[1] << 8) | raw[0];
+    calib->dig_T2 = (raw[3] << 8) | raw[2];
+    calib->dig_T3 = (raw[5] << 8) | raw[4];
+    calib->dig_P1 = (raw[7] << 8) | raw[6];
+    calib->dig_P2 = (raw[9] << 8) | raw[8];
+    calib->dig_P3 = (raw[11] << 8) | raw[10];
+    calib->dig_P4 = (raw[13] << 8) | raw[12];
+    calib->dig_P5 = (raw[15] << 8) | raw[14];
+    calib->dig_P6 = (raw[17] << 8) | raw[16];
+    calib->dig_P7 = (raw[19] << 8) | raw[18];
+    calib->dig_P8 = (raw[21] << 8) | raw[20];
+    calib->dig_P9 = (raw[23] << 8) | raw[22];
+    calib->t_fine = 0;
+}
+
+void bmp280_parse_data(const uint8_t raw[BMP280_DATA_LEN], int32_t *adc_T, int32_t *adc_P)
+{
+    *adc_P = (raw[0] << 12) | (raw[1] << 4) | (raw[2] >> 4);
+    *adc_T = (raw[3] << 12) | (raw[4] << 4) | (raw[5] >> 4);
+}
+
+bool bmp280_raw_valid(int32_t adc_T, int32_t adc_P)
+{
+    // Skipped measurement (sensor reset, oversampling off) or stuck bus
+    return !(adc_T == BMP280_ADC_SKIPPED || adc_P == BMP280_ADC_SKIPPED ||
+             adc_T == 0 || adc_P == 0 || adc_T == 0xFFFFF || adc_P == 0xFFFFF);
+}
+
+int32_t bmp280_compensate_temp(bmp280_calib_t *calib, int32_t adc_T)
+{
+    int32_t var1, var2;
+    var1 = ((((adc_T >> 3) - ((int32_t)calib->dig_T1 << 1))) *
+            ((int32_t)calib->dig_T2)) >>
+           11;
+    var2 = (((((adc_T >> 4) - ((int32_t)calib->dig_T1)) *
+              ((adc_T >> 4) - ((int32_t)calib->dig_T1))) >>
+             12) *
+            ((int32_t)calib->dig_T3)) >>
+           14;
+    calib->t_fine = var1 + var2;
+    return (calib->t_fine * 5 + 128) >> 8;
+}
+
+uint32_t bmp280_compensate_press(const bmp280_calib_t *calib, int32_t adc_P)
+{
+    int64_t var1, var2, p;
+    var1 = ((int64_t)calib->t_fine) - 128000;
+    var2 = var1 * var1 * (int64_t)calib->dig_P6;
+    var2 = var2 + ((var1 * (int64_t)calib->dig_P5) << 17);
+    var2 = var2 + (((int64_t)calib->dig_P4) << 35);
+    var1 = ((var1 * var1 * (int64_t)calib->dig_P3) >> 8) +
+           ((var1 * (int64_t)calib->dig_P2) << 12);
+    var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)calib->dig_P1) >> 33;
+
+    if (var1 == 0)
+    {
+        return 0;
+    }
+
+    p = 1048576 - adc_P;
+    p = (((p << 31) - var2) * 3125) / var1;
+    var1 = (((int64_t)calib->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2 = (((int64_t)calib->dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((int64_t)calib->dig_P7) << 4);
+
+    return (uint32_t)p;
+}
+
+bool bmp280_result_valid(int32_t temp_centi, uint32_t press_q8)
+{
+    // P == 0 means division by zero
+    return temp_centi >= -4000 && temp_centi <= 8500 &&
+           press_q8 >= 30000U * 256U && press_q8 <= 110000U * 256U;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file bmp280_conv.h
+ * @brief BMP280 register parsing and compensation
+ *
+ * Plain C, no ESP-IDF dependencies: the driver and the host replay tool
+ * (host/sensor_replay) run the same conversion on the same register bytes.
+ * Integer compensation from the Bosch datasheet (section 3.11.3).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Calibration block 0x88..0x9F
+#define BMP280_CALIB_LEN 24
+
+// Data registers 0xF7..0xFC: press msb, lsb, xlsb, temp msb, lsb, xlsb
+#define BMP280_DATA_LEN 6
+
+// ADC value of a skipped or not yet completed measurement
+#define BMP280_ADC_SKIPPED 0x80000
+
+    /**
+     * Calibration data structure - internal use
+     */
+    typedef struct
+    {
+        uint16_t dig_T1;
+        int16_t dig_T2;
+        int16_t dig_T3;
+        uint16_t dig_P1;
+        int16_t dig_P2;
+        int16_t dig_P3;
+        int16_t dig_P4;
+        int16_t dig_P5;
+        int16_t dig_P6;
+        int16_t dig_P7;
+        int16_t dig_P8;
+        int16_t dig_P9;
+        int32_t t_fine; ///< Fine temperature value (internal)
+    } bmp280_calib_t;
+
+    /**
+     * Parse the calibration block (little-endian coefficients)
+     */
+    void bmp280_parse_calib(const uint8_t raw[BMP280_CALIB_LEN], bmp280_calib_t *calib);
+
+    /**
+     * Extract the 20-bit ADC values from the data registers
+     */
+    void bmp280_parse_data(const uint8_t raw[BMP280_DATA_LEN], int32_t *adc_T, int32_t *adc_P);
+
+    /**
+     * False for a skipped measurement or a stuck bus (all zeros, all ones)
+     */
+    bool bmp280_raw_valid(int32_t adc_T, int32_t adc_P);
+
+    /**
+     * Compensate temperature; sets calib->t_fine for bmp280_compensate_press()
+     * @return Temperature in 0.01 °C
+     */
+    int32_t bmp280_compensate_temp(bmp280_calib_t *calib, int32_t adc_T);
+
+    /**
+     * Compensate pressure, after bmp280_compensate_temp() of the same sample
+     * @return Pressure in Pa * 256, 0 if the calibration is invalid
+     */
+    uint32_t bmp280_compensate_press(const bmp280_calib_t *calib, int32_t adc_P);
+
+    /**
+     * Result within the operating range of the sensor (-40..85 °C, 300..1100 hPa)
+     */
+    bool bmp280_result_valid(int32_t temp_centi, uint32_t press_q8);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file coap_pub.c
+ * @brief Connectionless CoAP (RFC 7252) uplink over UDP
+ *
+ * Only what a single POST needs: header, token, Uri-Path and
+ * Content-Format options, payload marker. No blockwise transfer,
+ * no observe, no DTLS.
+ */
+
+#include "coap_pub.h"
+#include "evlog.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include "payload.h"
+#include <stdio.h>
+#include <string.h>
+
+#define COAP_HOST CONFIG_COAP_GATEWAY_HOST
+#define COAP_PORT CONFIG_COAP_GATEWAY_PORT
+
+#ifdef CONFIG_COAP_CONFIRMABLE
+#define COAP_ACK_TIMEOUT_MS CONFIG_COAP_ACK_TIMEOUT_MS
+#define COAP_MAX_RETRANSMIT CONFIG_COAP_MAX_RETRANSMIT
+#else
+// Let the Wi-Fi driver transmit the last datagram before deep sleep
+#define COAP_NON_FLUSH_MS 20
+#endif
+
+// Message format (RFC 7252 section 3)
+#define COAP_VERSION 1
+#define COAP_TYPE_CON 0
+#define COAP_TYPE_NON 1
+#define COAP_TYPE_ACK 2
+#define COAP_TYPE_RST 3
+#define COAP_CODE_EMPTY 0x00
+#define COAP_CODE_POST 0x02
+#define COAP_CODE_CLASS(code) ((code) >> 5)
+#define COAP_OPTION_URI_PATH 11
+#define COAP_OPTION_CONTENT_FORMAT 12
+#define COAP_CONTENT_FORMAT_JSON 50
+#define COAP_PAYLOAD_MARKER 0xFF
+#define COAP_TOKEN_LEN 4
+#define COAP_HEADER_LEN 4
+
+static const char *TAG = "COAP";
+
+static int s_sock = -1;
+static struct sockaddr_in s_gateway;
+static uint16_t s_message_id;
+
+// Formatting buffers of coap_pub_send(), static to keep them off the main task stack
+static char s_payload[UPLINK_JSON_MAX_LEN];
+static uint8_t s_message[UPLINK_JSON_MAX_LEN + 96];
+
+/**
+ * Encode an option delta or length nibble and its extended bytes
+ * Returns the nibble; extended bytes are written to ext (up to 2).
+ */
+static uint8_t coap_option_nibble(uint16_t value, uint8_t *ext, size_t *ext_len)
+{
+    if (value < 13)
+    {
+        *ext_len = 0;
+        return value;
+    }
+    if (value < 269)
+    {
+        ext[0] = value - 13;
+        *ext_len = 1;
+        return 13;
+    }
+    value -= 269;
+    ext[0] = value >> 8;
+    ext[1] = value & 0xFF;
+    *ext_len = 2;
+    return 14;
+}
+
+/**
+ * Append one option; options must be added in ascending number order
+ * @return New write position, 0 on overflow
+ */
+static size_t coap_put_option(uint8_t *buf, size_t pos, size_t cap, uint16_t *last_number,
+                              uint16_t number, const void *value, size_t len)
+{
+    uint8_t delta_ext[2], len_ext[2];
+    size_t delta_ext_len, len_ext_len;
+    uint8_t delta_nibble = coap_option_nibble(number - *last_number, delta_ext, &delta_ext_len);
+    uint8_t len_nibble = coap_option_nibble(len, len_ext, &len_ext_len);
+
+    if (pos + 1 + delta_ext_len + len_ext_len + len > cap)
+    {
+        return 0;
+    }
+
+    buf[pos++] = (delta_nibble << 4) | len_nibble;
+    memcpy(&buf[pos], delta_ext, delta_ext_len);
+    pos += delta_ext_len;
+    memcpy(&buf[pos], len_ext, len_ext_len);
+    pos += len_ext_len;
+    memcpy(&buf[pos], value, len);
+    pos += len;
+
+    *last_number = number;
+    return pos;
+}
+
+/**
+ * Build POST /sensors/<node>/environment with a JSON payload
+ * @return Message length, 0 on overflow
+ */
+static size_t coap_build_post(uint8_t *buf, size_t cap, uint8_t type, uint16_t message_id,
+                              const uint8_t *token, const char *device_id,
+                              const char *payload, size_t payload_len)
+{
+    if (cap < COAP_HEADER_LEN + COAP_TOKEN_LEN)
+    {
+        return 0;
+    }
+
+    buf[0] = (COAP_VERSION << 6) | (type << 4) | COAP_TOKEN_LEN;
+    buf[1] = COAP_CODE_POST;
+    buf[2] = message_id >> 8;
+    buf[3] = message_id & 0xFF;
+    memcpy(&buf[COAP_HEADER_LEN], token, COAP_TOKEN_LEN);
+
+    size_t pos = COAP_HEADER_LEN + COAP_TOKEN_LEN;
+    uint16_t last = 0;
+    uint8_t content_format = COAP_CONTENT_FORMAT_JSON;
+
+    pos = coap_put_option(buf, pos, cap, &last, COAP_OPTION_URI_PATH, "sensors", 7);
+    if (pos)
+        pos = coap_put_option(buf, pos, cap, &last, COAP_OPTION_URI_PATH, device_id, strlen(device_id));
+    if (pos)
+        pos = coap_put_option(buf, pos, cap, &last, COAP_OPTION_URI_PATH, "environment", 11);
+    if (pos)
+        pos = coap_put_option(buf, pos, cap, &last, COAP_OPTION_CONTENT_FORMAT, &content_format, 1);
+    if (pos == 0 || pos + 1 + payload_len > cap)
+    {
+        return 0;
+    }
+
+    buf[pos++] = COAP_PAYLOAD_MARKER;
+    memcpy(&buf[pos], payload, payload_len);
+    return pos + payload_len;
+}
+
+#ifdef CONFIG_COAP_CONFIRMABLE
+/**
+ * Wait for the ACK (or RST) matching message_id
+ */
+static esp_err_t coap_wait_ack(uint16_t message_id, const uint8_t *token, uint32_t timeout_ms)
+{
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    uint8_t rx[64];
+    while (1)
+    {
+        int len = recv(s_sock, rx, sizeof(rx), 0);
+        if (len < 0)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (len < COAP_HEADER_LEN || (rx[0] >> 6) != COAP_VERSION)
+        {
+            continue;
+        }
+
+        uint8_t type = (rx[0] >> 4) & 0x03;
+        uint16_t rx_id = ((uint16_t)rx[2] << 8) | rx[3];
+        if (rx_id != message_id)
+        {
+            continue; // Late ACK of an earlier message
+        }
+
+        if (type == COAP_TYPE_RST)
+        {
+            ESP_LOGW(TAG, "Gateway reset message %u", message_id);
+            return ESP_FAIL;
+        }
+        if (type == COAP_TYPE_ACK)
+        {
+            // Piggybacked response echoes our token
+            uint8_t tkl = rx[0] & 0x0F;
+            if (tkl == COAP_TOKEN_LEN && len >= COAP_HEADER_LEN + tkl &&
+                memcmp(&rx[COAP_HEADER_LEN], token, tkl) != 0)
+            {
+                continue;
+            }
+            if (rx[1] == COAP_CODE_EMPTY)
+            {
+                // Separate response: the gateway has the message and answers
+                // later; the measurement is delivered, don't wait for it
+                return ESP_OK;
+            }
+            if (COAP_CODE_CLASS(rx[1]) == 2)
+            {
+                return ESP_OK;
+            }
+            ESP_LOGW(TAG, "Gateway answered %u.%02u", COAP_CODE_CLASS(rx[1]), rx[1] & 0x1F);
+            return ESP_FAIL;
+        }
+    }
+}
+#endif
+
+esp_err_t coap_pub_connect(const char *device_id)
+{
+    (void)device_id;
+
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res = NULL;
+    char port[8];
+    snprintf(port, sizeof(port), "%d", COAP_PORT);
+
+    int err = getaddrinfo(COAP_HOST, port, &hints, &res);
+    if (err != 0 || res == NULL)
+    {
+        ESP_LOGE(TAG, "Cannot resolve gateway %s (%d)", COAP_HOST, err);
+        return ESP_FAIL;
+    }
+    memcpy(&s_gateway, res->ai_addr, sizeof(s_gateway));
+    freeaddrinfo(res);
+
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0)
+    {
+        ESP_LOGE(TAG, "Failed to create socket");
+        return ESP_FAIL;
+    }
+
+    // Random start avoids message id reuse across reboots (deduplication window)
+    s_message_id = (uint16_t)esp_random();
+
+    return ESP_OK;
+}
+
+esp_err_t coap_pub_send(meteo_measurement_t *m)
+{
+    if (s_sock < 0 || m == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t token[COAP_TOKEN_LEN];
+
+    m->transport = coap_transport.name;
+    int payload_len = payload_format_json(m, s_payload, sizeof(s_payload));
+    if (payload_len < 0 || payload_len >= (int)sizeof(s_payload))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint16_t message_id = s_message_id++;
+    esp_fill_random(token, sizeof(token));
+
+#ifdef CONFIG_COAP_CONFIRMABLE
+    uint8_t type = COAP_TYPE_CON;
+#else
+    uint8_t type = COAP_TYPE_NON;
+#endif
+
+    size_t len = coap_build_post(s_message, sizeof(s_message), type, message_id, token,
+                                 m->device_id, s_payload, payload_len);
+    if (len == 0)
+    {
+        ESP_LOGE(TAG, "Message too large");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ESP_LOGI(TAG, "Payload: %s", s_payload);
+
+#ifdef CONFIG_COAP_CONFIRMABLE
+    // Retransmit with exponential back-off (RFC 7252 section 4.2)
+    uint32_t timeout_ms = COAP_ACK_TIMEOUT_MS;
+    for (int attempt = 0; attempt <= COAP_MAX_RETRANSMIT; attempt++)
+    {
+        if (sendto(s_sock, s_message, len, 0, (struct sockaddr *)&s_gateway, sizeof(s_gateway)) < 0)
+        {
+            ESP_LOGE(TAG, "sendto failed");
+            return ESP_FAIL;
+        }
+
+        esp_err_t ret = coap_wait_ack(message_id, token, timeout_ms);
+        if (ret != ESP_ERR_TIMEOUT)
+        {
+            EVLOG2(EVLOG_COAP_SENT, message_id, attempt + 1);
+            ESP_LOGI(TAG, "Message %u %s after %d attempt(s)", message_id,
+                     ret == ESP_OK ? "acknowledged" : "rejected", attempt + 1);
+            return ret;
+        }
+        timeout_ms *= 2;
+    }
+
+    ESP_LOGW(TAG, "No ACK for message %u", message_id);
+    return ESP_ERR_TIMEOUT;
+#else
+    if (sendto(s_sock, s_message, len, 0, (struct sockaddr *)&s_gateway, sizeof(s_gateway)) < 0)
+    {
+        ESP_LOGE(TAG, "sendto failed");
+        return ESP_FAIL;
+    }
+    EVLOG2(EVLOG_COAP_SENT, message_id, 1);
+    ESP_LOGI(TAG, "Sent message %u (%u bytes)", message_id, (unsigned)len);
+    return ESP_OK;
+#endif
+}
+
+void coap_pub_disconnect(void)
+{
+    if (s_sock >= 0)
+    {
+#ifndef CONFIG_COAP_CONFIRMABLE
+        vTaskDelay(pdMS_TO_TICKS(COAP_NON_FLUSH_MS));
+#endif
+        close(s_sock);
+        s_sock = -1;
+    }
+}
+
+const uplink_transport_t coap_transport = {
+    .name = "coap",
+    .connect = coap_pub_connect,
+    .send = coap_pub_send,
+    .disconnect = coap_pub_disconnect,
+};
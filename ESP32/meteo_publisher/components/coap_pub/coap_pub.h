@@ -0,0 +1,32 @@
+#pragma once
+
+#include "esp_err.h"
+#include "uplink.h"
+
+/**
+ * CoAP uplink: the measurement is POSTed as a single UDP datagram to
+ * coap://<gateway>/sensors/<node>/environment. Non-confirmable by default;
+ * with CONFIG_COAP_CONFIRMABLE the node waits for the piggybacked ACK
+ * (one round trip). orangepi/meteo_subscriber/coap_gateway.py republishes
+ * into the MQTT topic tree.
+ */
+extern const uplink_transport_t coap_transport;
+
+/**
+ * Resolve the gateway and open the UDP socket
+ * @param device_id Node name used in the Uri-Path
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t coap_pub_connect(const char *device_id);
+
+/**
+ * Send one measurement as a CoAP POST
+ * @param m Measurement (m->transport is set to "coap")
+ * @return ESP_OK when sent (and acknowledged if confirmable)
+ */
+esp_err_t coap_pub_send(meteo_measurement_t *m);
+
+/**
+ * Close the UDP socket
+ */
+void coap_pub_disconnect(void);
@@ -4,6 +4,8 @@
  */
 
 #include "dht22.h"
+#include "evlog.h"
+#include "power_mgmt.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -68,14 +70,17 @@ esp_err_t dht22_init(dht22_handle_t *handle, const dht22_config_t *config)
     return ESP_OK;
 }
 
-esp_err_t dht22_read(dht22_handle_t *handle, float *temp, float *humidity)
+/**
+ * Read one frame; bit lengths are counted in 1 us busy-wait steps
+ */
+static esp_err_t dht22_read_frame(dht22_handle_t *handle, float *temp, float *humidity)
 {
     if (handle == NULL || !handle->initialized || temp == NULL || humidity == NULL)
     {
         return ESP_ERR_INVALID_ARG;
     }
 
-    uint8_t data[5] = {0};
+    uint8_t data[DHT22_FRAME_LEN] = {0};
     gpio_num_t gpio = handle->config.gpio_pin;
 
     // Disable interrupts during timing-critical section
@@ -142,43 +147,40 @@ esp_err_t dht22_read(dht22_handle_t *handle, float *temp, float *humidity)
         return ESP_ERR_TIMEOUT;
     }
 
+    memcpy(handle->last_frame, data, DHT22_FRAME_LEN);
+
     // Verify checksum
-    uint8_t checksum = (data[0] + data[1] + data[2] + data[3]) & 0xFF;
-    if (data[4] != checksum)
+    if (!dht22_frame_checksum_ok(data))
     {
-        ESP_LOGE(TAG, "Checksum error: expected 0x%02X, got 0x%02X", checksum, data[4]);
+        ESP_LOGE(TAG, "Checksum error: expected 0x%02X, got 0x%02X",
+                 (data[0] + data[1] + data[2] + data[3]) & 0xFF, data[4]);
         return ESP_ERR_INVALID_CRC;
     }
 
-    // Parse data
-    uint16_t rh_raw = (data[0] << 8) | data[1];
-    uint16_t temp_raw = (data[2] << 8) | data[3];
-
-    float raw_humidity = rh_raw / 10.0f;
-    float raw_temp = temp_raw / 10.0f;
-
-    // Handle negative temperatures
-    if (temp_raw & 0x8000)
-    {
-        raw_temp = -(temp_raw & 0x7FFF) / 10.0f;
-    }
+    float raw_temp, raw_humidity;
+    dht22_convert(data, &raw_temp, &raw_humidity);
 
     // Sanity check: DHT22 range is -40 to 80°C, 0-100% RH
-    if (raw_temp < -40.0f || raw_temp > 80.0f)
+    if (!dht22_result_valid(raw_temp, raw_humidity))
     {
-        ESP_LOGE(TAG, "Temperature out of range: %.1f°C", raw_temp);
-        return ESP_ERR_INVALID_RESPONSE;
-    }
-    if (raw_humidity < 0.0f || raw_humidity > 100.0f)
-    {
-        ESP_LOGE(TAG, "Humidity out of range: %.1f%%", raw_humidity);
+        ESP_LOGE(TAG, "Out of range: %.1f°C, %.1f%%", raw_temp, raw_humidity);
         return ESP_ERR_INVALID_RESPONSE;
     }
 
     *temp = raw_temp;
     *humidity = raw_humidity;
 
+    EVLOG2(EVLOG_DHT22_READ, evlog_f(*temp), evlog_f(*humidity));
     ESP_LOGI(TAG, "Temperature: %.1f°C, Humidity: %.1f%%", *temp, *humidity);
 
     return ESP_OK;
 }
+
+esp_err_t dht22_read(dht22_handle_t *handle, float *temp, float *humidity)
+{
+    // A scaled-down CPU clock would stretch the busy-wait steps
+    power_lock_acquire(POWER_LOCK_BITBANG);
+    esp_err_t ret = dht22_read_frame(handle, temp, humidity);
+    power_lock_release(POWER_LOCK_BITBANG);
+    return ret;
+}
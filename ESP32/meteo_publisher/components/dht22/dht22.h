@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "dht22_conv.h"
 #include "driver/gpio.h"
 #include "esp_err.h"
 #include <stdint.h>
@@ -34,6 +35,7 @@ extern "C"
     typedef struct
     {
         dht22_config_t config;
+        uint8_t last_frame[DHT22_FRAME_LEN]; ///< Last complete frame, also rejected ones
         bool initialized;
     } dht22_handle_t;
 
@@ -0,0 +1,31 @@
+/**
+ * @file dht22_conv.c
+ * @brief DHT22 frame checking and conversion
+ */
+
+#include "dht22_conv.h"
+
+bool dht22_frame_checksum_ok(const uint8_t frame[DHT22_FRAME_LEN])
+{
+    return frame[4] == ((frame[0] + frame[1] + frame[2] + frame[3]) & 0xFF);
+}
+
+void dht22_convert(const uint8_t frame[DHT22_FRAME_LEN], float *temp, float *humidity)
+{
+    uint16_t rh_raw = (frame[0] << 8) | frame[1];
+    uint16_t temp_raw = (frame[2] << 8) | frame[3];
+
+    *humidity = rh_raw / 10.0f;
+    *temp = temp_raw / 10.0f;
+
+    // Handle negative temperatures
+    if (temp_raw & 0x8000)
+    {
+        *temp = -(temp_raw & 0x7FFF) / 10.0f;
+    }
+}
+
+bool dht22_result_valid(float temp, float humidity)
+{
+    return temp >= -40.0f && temp <= 80.0f && humidity >= 0.0f && humidity <= 100.0f;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file dht22_conv.h
+ * @brief DHT22 frame checking and conversion
+ *
+ * Plain C, no ESP-IDF dependencies: the driver and the host replay tool
+ * (host/sensor_replay) run the same conversion on the same frame.
+ * Frame: humidity and temperature in 0.1 units (temperature sign in the
+ * top bit), then the 8-bit sum of the four data bytes.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// 4 data bytes + checksum
+#define DHT22_FRAME_LEN 5
+
+    /**
+     * True if the checksum byte matches the data bytes
+     */
+    bool dht22_frame_checksum_ok(const uint8_t frame[DHT22_FRAME_LEN]);
+
+    /**
+     * Convert a frame to °C and % RH
+     */
+    void dht22_convert(const uint8_t frame[DHT22_FRAME_LEN], float *temp, float *humidity);
+
+    /**
+     * False outside the sensor range (-40..80 °C, 0..100 % RH)
+     */
+    bool dht22_result_valid(float temp, float humidity);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file espnow_arq.c
+ * @brief Stop-and-wait retransmission and duplicate suppression
+ */
+
+#include "espnow_arq.h"
+#include <string.h>
+
+int espnow_arq_send(const espnow_arq_ops_t *ops, const uint8_t *frame, size_t len,
+                    uint16_t seq, uint32_t timeout_ms, int max_retries)
+{
+    for (int attempt = 1; attempt <= max_retries + 1; attempt++)
+    {
+        if (!ops->tx(ops->ctx, frame, len))
+        {
+            continue;
+        }
+        if (ops->wait_ack(ops->ctx, seq, timeout_ms))
+        {
+            return attempt;
+        }
+    }
+    return 0;
+}
+
+void espnow_dedup_init(espnow_dedup_t *dedup)
+{
+    memset(dedup, 0, sizeof(*dedup));
+}
+
+bool espnow_dedup_check(espnow_dedup_t *dedup, const uint8_t mac[6], uint16_t seq)
+{
+    espnow_dedup_entry_t *slot = &dedup->entries[0];
+    dedup->clock++;
+
+    for (int i = 0; i < ESPNOW_DEDUP_NODES; i++)
+    {
+        espnow_dedup_entry_t *e = &dedup->entries[i];
+        if (e->valid && memcmp(e->mac, mac, 6) == 0)
+        {
+            bool duplicate = e->seq == seq;
+            e->seq = seq;
+            e->last_used = dedup->clock;
+            return duplicate;
+        }
+
+        // Remember a free or the least recently used entry for a new sender
+        if (slot->valid && (!e->valid || e->last_used < slot->last_used))
+        {
+            slot = e;
+        }
+    }
+
+    memcpy(slot->mac, mac, 6);
+    slot->seq = seq;
+    slot->last_used = dedup->clock;
+    slot->valid = true;
+    return false;
+}
+
+void espnow_dedup_forget(espnow_dedup_t *dedup, const uint8_t mac[6])
+{
+    for (int i = 0; i < ESPNOW_DEDUP_NODES; i++)
+    {
+        espnow_dedup_entry_t *e = &dedup->entries[i];
+        if (e->valid && memcmp(e->mac, mac, 6) == 0)
+        {
+            e->valid = false;
+            return;
+        }
+    }
+}
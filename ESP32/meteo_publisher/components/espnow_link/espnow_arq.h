@@ -0,0 +1,106 @@
+/**
+ * @file espnow_arq.h
+ * @brief Stop-and-wait retransmission and duplicate suppression
+ *
+ * Radio access is abstracted behind espnow_arq_ops_t so the same logic
+ * runs on the ESP32 (esp_now_send + ACK queue) and in the host loopback
+ * simulation (host/espnow_loopback.cpp).
+ *
+ * A node sends one DATA frame at a time and waits for the gateway's ACK
+ * carrying the same sequence number. When an ACK is lost the node
+ * retransmits the same frame; the gateway acknowledges it again but
+ * forwards it only once (espnow_dedup_check()). A frame the gateway could
+ * not forward is not acknowledged and is dropped from the table
+ * (espnow_dedup_forget()), so its retransmission is forwarded again.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ESPNOW_DEDUP_NODES 16
+
+    /**
+     * Radio operations used by espnow_arq_send()
+     */
+    typedef struct
+    {
+        /**
+         * Transmit a frame
+         * @return true if the frame was handed to the radio
+         */
+        bool (*tx)(void *ctx, const uint8_t *frame, size_t len);
+
+        /**
+         * Wait for the ACK of seq; ACKs of other sequence numbers are dropped
+         * @return true if the matching ACK arrived within timeout_ms
+         */
+        bool (*wait_ack)(void *ctx, uint16_t seq, uint32_t timeout_ms);
+
+        void *ctx;
+    } espnow_arq_ops_t;
+
+    /**
+     * Send a frame and wait for its ACK, retransmitting on timeout
+     *
+     * @param ops Radio operations
+     * @param frame Encoded DATA frame
+     * @param len Frame length
+     * @param seq Sequence number encoded in the frame
+     * @param timeout_ms ACK timeout per attempt
+     * @param max_retries Retransmissions after the first attempt
+     * @return Number of attempts used (>= 1), 0 if no ACK was received
+     */
+    int espnow_arq_send(const espnow_arq_ops_t *ops, const uint8_t *frame, size_t len,
+                        uint16_t seq, uint32_t timeout_ms, int max_retries);
+
+    typedef struct
+    {
+        uint8_t mac[6];
+        uint16_t seq;
+        uint32_t last_used;
+        bool valid;
+    } espnow_dedup_entry_t;
+
+    /**
+     * Last sequence number seen per sender, least recently used replaced
+     */
+    typedef struct
+    {
+        espnow_dedup_entry_t entries[ESPNOW_DEDUP_NODES];
+        uint32_t clock;
+    } espnow_dedup_t;
+
+    /**
+     * Reset the duplicate table
+     */
+    void espnow_dedup_init(espnow_dedup_t *dedup);
+
+    /**
+     * Record a received DATA frame
+     *
+     * Senders transmit one frame at a time, so a retransmission always
+     * repeats the last sequence number seen from that sender.
+     *
+     * @return true if the frame is a retransmission of the last one
+     */
+    bool espnow_dedup_check(espnow_dedup_t *dedup, const uint8_t mac[6], uint16_t seq);
+
+    /**
+     * Forget the last sequence number of a sender
+     *
+     * Called when the frame just recorded could not be forwarded, so its
+     * retransmission is not taken for a duplicate.
+     */
+    void espnow_dedup_forget(espnow_dedup_t *dedup, const uint8_t mac[6]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,370 @@
+/**
+ * @file espnow_frame.c
+ * @brief ESP-NOW frame encoding and decoding
+ */
+
+#include "espnow_frame.h"
+#include <string.h>
+
+// Offsets in the header
+#define HDR_MAGIC 0
+#define HDR_VERSION 1
+#define HDR_TYPE 2
+#define HDR_SEQ 4
+#define HDR_CRC 6
+
+// Fixed part of the DATA body after the two strings
+#define DATA_FIXED_LEN (8 + 4 * 3 + 4 * 7)
+
+static uint16_t crc16_ccitt(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void put_f32(uint8_t *p, float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put_u32(p, v);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static float get_f32(const uint8_t *p)
+{
+    uint32_t v = get_u32(p);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static void put_header(uint8_t *buf, espnow_frame_type_t type, uint16_t seq)
+{
+    buf[HDR_MAGIC] = ESPNOW_FRAME_MAGIC;
+    buf[HDR_VERSION] = ESPNOW_FRAME_VERSION;
+    buf[HDR_TYPE] = type;
+    buf[HDR_TYPE + 1] = 0;
+    put_u16(&buf[HDR_SEQ], seq);
+    put_u16(&buf[HDR_CRC], 0);
+}
+
+static void seal(uint8_t *buf, size_t len)
+{
+    put_u16(&buf[HDR_CRC], crc16_ccitt(buf, len));
+}
+
+static size_t bounded_len(const char *s, size_t max)
+{
+    size_t len = 0;
+    while (len < max && s[len] != '\0')
+    {
+        len++;
+    }
+    return len;
+}
+
+/**
+ * Append a length-prefixed string (without terminator)
+ */
+static size_t put_string(uint8_t *buf, size_t pos, const char *s, size_t max)
+{
+    size_t len = bounded_len(s, max - 1);
+    buf[pos++] = (uint8_t)len;
+    memcpy(&buf[pos], s, len);
+    return pos + len;
+}
+
+static size_t get_string(const uint8_t *buf, size_t pos, size_t len, char *s, size_t max)
+{
+    if (pos >= len)
+    {
+        return 0;
+    }
+    size_t n = buf[pos++];
+    if (n >= max || pos + n > len)
+    {
+        return 0;
+    }
+    memcpy(s, &buf[pos], n);
+    s[n] = '\0';
+    return pos + n;
+}
+
+/**
+ * Append an optional field, returns the new position (unchanged if it does not fit)
+ */
+static size_t put_field(uint8_t *buf, size_t pos, size_t cap, uint8_t tag,
+                        const uint8_t *value, uint8_t len)
+{
+    if (pos + 2 + len > cap)
+    {
+        return pos;
+    }
+    buf[pos++] = tag;
+    buf[pos++] = len;
+    memcpy(&buf[pos], value, len);
+    return pos + len;
+}
+
+/**
+ * Parse the optional fields after the fixed part
+ */
+static bool get_fields(const uint8_t *buf, size_t pos, size_t len, meteo_measurement_t *m)
+{
+    while (pos < len)
+    {
+        if (pos + 2 > len || pos + 2 + buf[pos + 1] > len)
+        {
+            return false;
+        }
+        uint8_t tag = buf[pos];
+        uint8_t n = buf[pos + 1];
+        const uint8_t *value = &buf[pos + 2];
+
+        switch (tag)
+        {
+        case ESPNOW_FIELD_BMP_PROFILE:
+            if (n >= 5)
+            {
+                m->bmp_profile = value[0];
+                m->bmp_noise_pa = get_f32(&value[1]);
+            }
+            break;
+        case ESPNOW_FIELD_BATTERY:
+            if (n >= 3)
+            {
+                m->battery_mv = get_u16(&value[0]);
+                m->power_tier = value[2];
+            }
+            break;
+        case ESPNOW_FIELD_HEALTH:
+            if (n >= 15)
+            {
+                m->health.reset_reason = value[0];
+                m->health.wake_cause = value[1];
+                m->health.wifi_reason = value[2];
+                m->health.failed_publishes = get_u16(&value[3]);
+                m->health.wifi_disconnects = get_u16(&value[5]);
+                m->health.sensor_failures = get_u16(&value[7]);
+                m->health.brownouts = get_u16(&value[9]);
+                m->health.panics = get_u16(&value[11]);
+                m->health.watchdogs = get_u16(&value[13]);
+            }
+            break;
+        case ESPNOW_FIELD_MEMORY:
+            if (n >= 26)
+            {
+                m->memory.min_free_heap = get_u32(&value[0]);
+                m->memory.largest_block = get_u32(&value[4]);
+                m->memory.free_internal = get_u32(&value[8]);
+                m->memory.free_psram = get_u32(&value[12]);
+                m->memory.stack_main = get_u16(&value[16]);
+                m->memory.stack_wifi = get_u16(&value[18]);
+                m->memory.stack_tcpip = get_u16(&value[20]);
+                m->memory.stack_event = get_u16(&value[22]);
+                m->memory.stack_mqtt = get_u16(&value[24]);
+            }
+            break;
+        default:
+            break; // Newer sender
+        }
+        pos += 2 + n;
+    }
+    return true;
+}
+
+size_t espnow_frame_encode_data(const meteo_measurement_t *m, uint16_t seq,
+                                uint8_t *buf, size_t cap)
+{
+    size_t need = ESPNOW_FRAME_HEADER_LEN + 1 + bounded_len(m->device_id, MEASUREMENT_DEVICE_ID_LEN - 1) +
+                  1 + bounded_len(m->fw, MEASUREMENT_FW_LEN - 1) + DATA_FIXED_LEN;
+    if (cap < need)
+    {
+        return 0;
+    }
+
+    put_header(buf, ESPNOW_FRAME_DATA, seq);
+
+    size_t pos = ESPNOW_FRAME_HEADER_LEN;
+    pos = put_string(buf, pos, m->device_id, MEASUREMENT_DEVICE_ID_LEN);
+    pos = put_string(buf, pos, m->fw, MEASUREMENT_FW_LEN);
+
+    put_u64(&buf[pos], (uint64_t)m->ts_device);
+    pos += 8;
+    put_u32(&buf[pos], m->sample_age_s);
+    pos += 4;
+    put_u32(&buf[pos], m->last_awake_ms);
+    pos += 4;
+    put_u32(&buf[pos], m->free_heap);
+    pos += 4;
+
+    const float values[] = {m->altitude_m, m->dht_temp, m->dht_rh, m->aht20_temp,
+                            m->aht20_rh, m->bmp_temp, m->bmp_press};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        put_f32(&buf[pos], values[i]);
+        pos += 4;
+    }
+
+    if (m->bmp_profile != MEASUREMENT_PROFILE_UNKNOWN)
+    {
+        uint8_t field[5] = {m->bmp_profile};
+        put_f32(&field[1], m->bmp_noise_pa);
+        pos = put_field(buf, pos, cap, ESPNOW_FIELD_BMP_PROFILE, field, sizeof(field));
+    }
+
+    if (m->battery_mv != 0)
+    {
+        uint8_t field[3];
+        put_u16(&field[0], m->battery_mv);
+        field[2] = m->power_tier;
+        pos = put_field(buf, pos, cap, ESPNOW_FIELD_BATTERY, field, sizeof(field));
+    }
+
+    if (m->health.reset_reason != 0)
+    {
+        const measurement_health_t *h = &m->health;
+        uint8_t field[15] = {h->reset_reason, h->wake_cause, h->wifi_reason};
+        put_u16(&field[3], h->failed_publishes);
+        put_u16(&field[5], h->wifi_disconnects);
+        put_u16(&field[7], h->sensor_failures);
+        put_u16(&field[9], h->brownouts);
+        put_u16(&field[11], h->panics);
+        put_u16(&field[13], h->watchdogs);
+        pos = put_field(buf, pos, cap, ESPNOW_FIELD_HEALTH, field, sizeof(field));
+    }
+
+    if (m->memory.min_free_heap != 0)
+    {
+        const measurement_memory_t *mem = &m->memory;
+        uint8_t field[26];
+        put_u32(&field[0], mem->min_free_heap);
+        put_u32(&field[4], mem->largest_block);
+        put_u32(&field[8], mem->free_internal);
+        put_u32(&field[12], mem->free_psram);
+        put_u16(&field[16], mem->stack_main);
+        put_u16(&field[18], mem->stack_wifi);
+        put_u16(&field[20], mem->stack_tcpip);
+        put_u16(&field[22], mem->stack_event);
+        put_u16(&field[24], mem->stack_mqtt);
+        pos = put_field(buf, pos, cap, ESPNOW_FIELD_MEMORY, field, sizeof(field));
+    }
+
+    seal(buf, pos);
+    return pos;
+}
+
+size_t espnow_frame_encode_ack(uint16_t seq, uint8_t *buf, size_t cap)
+{
+    if (cap < ESPNOW_FRAME_HEADER_LEN)
+    {
+        return 0;
+    }
+
+    put_header(buf, ESPNOW_FRAME_ACK, seq);
+    seal(buf, ESPNOW_FRAME_HEADER_LEN);
+    return ESPNOW_FRAME_HEADER_LEN;
+}
+
+bool espnow_frame_decode(const uint8_t *buf, size_t len, espnow_frame_t *frame)
+{
+    if (len < ESPNOW_FRAME_HEADER_LEN || len > ESPNOW_FRAME_MAX_LEN ||
+        buf[HDR_MAGIC] != ESPNOW_FRAME_MAGIC || buf[HDR_VERSION] != ESPNOW_FRAME_VERSION)
+    {
+        return false;
+    }
+
+    // CRC is computed with its own field zeroed
+    uint8_t copy[ESPNOW_FRAME_MAX_LEN];
+    memcpy(copy, buf, len);
+    put_u16(&copy[HDR_CRC], 0);
+    if (crc16_ccitt(copy, len) != get_u16(&buf[HDR_CRC]))
+    {
+        return false;
+    }
+
+    frame->type = (espnow_frame_type_t)buf[HDR_TYPE];
+    frame->seq = get_u16(&buf[HDR_SEQ]);
+
+    if (frame->type == ESPNOW_FRAME_ACK)
+    {
+        return len == ESPNOW_FRAME_HEADER_LEN;
+    }
+    if (frame->type != ESPNOW_FRAME_DATA)
+    {
+        return false;
+    }
+
+    meteo_measurement_t *m = &frame->measurement;
+    measurement_init(m);
+
+    size_t pos = ESPNOW_FRAME_HEADER_LEN;
+    pos = get_string(buf, pos, len, m->device_id, sizeof(m->device_id));
+    if (pos)
+        pos = get_string(buf, pos, len, m->fw, sizeof(m->fw));
+    if (pos == 0 || pos + DATA_FIXED_LEN > len)
+    {
+        return false;
+    }
+
+    m->ts_device = (int64_t)get_u64(&buf[pos]);
+    pos += 8;
+    m->sample_age_s = get_u32(&buf[pos]);
+    pos += 4;
+    m->last_awake_ms = get_u32(&buf[pos]);
+    pos += 4;
+    m->free_heap = get_u32(&buf[pos]);
+    pos += 4;
+
+    float *values[] = {&m->altitude_m, &m->dht_temp, &m->dht_rh, &m->aht20_temp,
+                       &m->aht20_rh, &m->bmp_temp, &m->bmp_press};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        *values[i] = get_f32(&buf[pos]);
+        pos += 4;
+    }
+
+    return get_fields(buf, pos, len, m);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file espnow_frame.h
+ * @brief ESP-NOW frame format shared by sensor nodes and the gateway
+ *
+ * Plain C, no ESP-IDF dependencies: host/espnow_loopback links the same
+ * code. All multi-byte fields are little-endian.
+ *
+ * Header (8 bytes):
+ *   magic (0x4D) | version | type | reserved | seq (u16) | crc16 (u16)
+ *
+ * DATA body: compact binary measurement (well below the 250-byte ESP-NOW
+ * limit, the JSON payload would not fit), followed by optional fields as
+ * tag | length | value. Receivers skip unknown tags, so fields can be added
+ * without a version change. ACK frames have no body.
+ * The CRC-16/CCITT covers the whole frame with the crc field set to zero.
+ */
+
+#pragma once
+
+#include "measurement.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ESPNOW_FRAME_MAGIC 0x4D
+#define ESPNOW_FRAME_VERSION 1
+#define ESPNOW_FRAME_HEADER_LEN 8
+#define ESPNOW_FRAME_MAX_LEN 250 ///< ESP_NOW_MAX_DATA_LEN
+
+    /**
+     * Tags of the optional DATA fields - append only
+     */
+    typedef enum
+    {
+        ESPNOW_FIELD_BMP_PROFILE = 1, ///< u8 profile, f32 noise (Pa)
+        ESPNOW_FIELD_BATTERY = 2,     ///< u16 voltage (mV), u8 tier
+        ESPNOW_FIELD_HEALTH = 3,      ///< u8 reset, wake, Wi-Fi reason; u16 × 6 counters (measurement_health_t order)
+        ESPNOW_FIELD_MEMORY = 4,      ///< u32 × 4 heap, u16 × 5 stacks (measurement_memory_t order)
+    } espnow_field_tag_t;
+
+    typedef enum
+    {
+        ESPNOW_FRAME_DATA = 1, ///< Measurement, node -> gateway
+        ESPNOW_FRAME_ACK = 2,  ///< Acknowledgement, gateway -> node
+    } espnow_frame_type_t;
+
+    /**
+     * Decoded frame
+     */
+    typedef struct
+    {
+        espnow_frame_type_t type;
+        uint16_t seq;
+        meteo_measurement_t measurement; ///< Valid for DATA frames
+    } espnow_frame_t;
+
+    /**
+     * Encode a DATA frame
+     *
+     * @param m Measurement (transport and rssi are not sent)
+     * @param seq Sequence number
+     * @param buf Output buffer (ESPNOW_FRAME_MAX_LEN is always enough)
+     * @param cap Size of buf
+     * @return Frame length, 0 if buf is too small
+     */
+    size_t espnow_frame_encode_data(const meteo_measurement_t *m, uint16_t seq,
+                                    uint8_t *buf, size_t cap);
+
+    /**
+     * Encode an ACK frame
+     *
+     * @return Frame length, 0 if buf is too small
+     */
+    size_t espnow_frame_encode_ack(uint16_t seq, uint8_t *buf, size_t cap);
+
+    /**
+     * Decode and validate a frame (magic, version, CRC, lengths)
+     *
+     * @param buf Received bytes
+     * @param len Number of bytes
+     * @param frame Decoded frame
+     * @return true if the frame is valid
+     */
+    bool espnow_frame_decode(const uint8_t *buf, size_t len, espnow_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,190 @@
+/**
+ * @file espnow_gateway.c
+ * @brief ESP-NOW to MQTT gateway role
+ */
+
+#include "espnow_gateway.h"
+
+#ifdef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+
+#include "espnow_arq.h"
+#include "espnow_frame.h"
+#include "evlog.h"
+#include "memstats.h"
+#include "mqtt_pub.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <string.h>
+
+#define GATEWAY_RX_QUEUE_LEN 8
+#define GATEWAY_CONNECT_RETRY_MS 5000
+
+// Memory telemetry interval: the gateway never sleeps, leaks add up
+#define GATEWAY_MEMSTATS_PERIOD_MS (10 * 60 * 1000)
+
+static const char *TAG = "ESPNOW_GW";
+
+typedef struct
+{
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[ESPNOW_FRAME_MAX_LEN];
+} gateway_rx_t;
+
+static QueueHandle_t s_rx_queue;
+static StaticQueue_t s_rx_queue_buf;
+static uint8_t s_rx_queue_storage[GATEWAY_RX_QUEUE_LEN * sizeof(gateway_rx_t)];
+static espnow_dedup_t s_dedup;
+
+// Frames lost to a full RX queue while a publish waits for its PUBACK;
+// they are not acknowledged, so the node retransmits them
+static volatile uint32_t s_rx_dropped;
+
+// Runs in the Wi-Fi task: copy the frame and return
+static void gateway_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (len <= 0 || len > ESPNOW_FRAME_MAX_LEN)
+    {
+        return;
+    }
+
+    gateway_rx_t rx;
+    memcpy(rx.mac, info->src_addr, ESP_NOW_ETH_ALEN);
+    rx.rssi = info->rx_ctrl->rssi;
+    rx.len = len;
+    memcpy(rx.data, data, len);
+
+    if (xQueueSend(s_rx_queue, &rx, 0) != pdTRUE)
+    {
+        s_rx_dropped++;
+    }
+}
+
+/**
+ * Acknowledge a frame; the sender is only a peer while the ACK is sent,
+ * so any number of nodes fits in the ESP-NOW peer table
+ */
+static void gateway_send_ack(const uint8_t *mac, uint16_t seq)
+{
+    uint8_t ack[ESPNOW_FRAME_HEADER_LEN];
+    size_t len = espnow_frame_encode_ack(seq, ack, sizeof(ack));
+
+    esp_now_peer_info_t peer = {
+        .channel = 0, // Current channel
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, mac, ESP_NOW_ETH_ALEN);
+
+    bool added = esp_now_add_peer(&peer) == ESP_OK;
+    esp_now_send(mac, ack, len);
+    if (added)
+    {
+        esp_now_del_peer(mac);
+    }
+}
+
+static void gateway_handle(const gateway_rx_t *rx)
+{
+    static espnow_frame_t frame;
+    if (!espnow_frame_decode(rx->data, rx->len, &frame) || frame.type != ESPNOW_FRAME_DATA)
+    {
+        ESP_LOGW(TAG, "Invalid frame from " MACSTR, MAC2STR(rx->mac));
+        return;
+    }
+
+    bool duplicate = espnow_dedup_check(&s_dedup, rx->mac, frame.seq);
+    if (duplicate)
+    {
+        ESP_LOGI(TAG, "Retransmission seq %u from %s dropped", frame.seq,
+                 frame.measurement.device_id);
+    }
+    else
+    {
+        frame.measurement.rssi = rx->rssi;
+        frame.measurement.transport = "espnow";
+        ESP_LOGI(TAG, "Forwarding seq %u from %s (" MACSTR ", %d dBm)", frame.seq,
+                 frame.measurement.device_id, MAC2STR(rx->mac), rx->rssi);
+
+        // ACK only what the broker acknowledged: without it the node
+        // retransmits and finally keeps the measurement in its outbox
+        esp_err_t err = mqtt_pub_send(&frame.measurement);
+        if (err != ESP_OK)
+        {
+            espnow_dedup_forget(&s_dedup, rx->mac);
+            EVLOG2(EVLOG_ESPNOW_FORWARD_FAILED, frame.seq, err);
+            ESP_LOGW(TAG, "Publish of seq %u from %s failed: %s, not acknowledged", frame.seq,
+                     frame.measurement.device_id, esp_err_to_name(err));
+            return;
+        }
+    }
+
+    EVLOG3(EVLOG_ESPNOW_FORWARDED, frame.seq, (int32_t)rx->rssi, duplicate);
+    gateway_send_ack(rx->mac, frame.seq);
+}
+
+void espnow_gateway_run(void)
+{
+    s_rx_queue = xQueueCreateStatic(GATEWAY_RX_QUEUE_LEN, sizeof(gateway_rx_t),
+                                    s_rx_queue_storage, &s_rx_queue_buf);
+    espnow_dedup_init(&s_dedup);
+
+    // Mains powered: keep the receiver on
+    esp_wifi_set_ps(WIFI_PS_NONE);
+
+    // One long-lived MQTT session; once up, esp-mqtt reconnects on its own
+    while (mqtt_pub_connect(CONFIG_NODE_NAME) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Broker not reachable, retrying in %d s", GATEWAY_CONNECT_RETRY_MS / 1000);
+        vTaskDelay(pdMS_TO_TICKS(GATEWAY_CONNECT_RETRY_MS));
+    }
+
+    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(gateway_recv_cb));
+
+    uint8_t mac[6];
+    uint8_t channel;
+    wifi_second_chan_t second;
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+    esp_wifi_get_channel(&channel, &second);
+    ESP_LOGI(TAG, "Gateway " MACSTR " listening on channel %u", MAC2STR(mac), channel);
+    ESP_LOGI(TAG, "Nodes: CONFIG_ESPNOW_GATEWAY_MAC=\"" MACSTR "\" CONFIG_ESPNOW_CHANNEL=%u",
+             MAC2STR(mac), channel);
+
+    static gateway_rx_t rx;
+    TickType_t last_memstats = xTaskGetTickCount();
+    uint32_t rx_dropped_reported = 0;
+    while (1)
+    {
+        if (xQueueReceive(s_rx_queue, &rx, pdMS_TO_TICKS(GATEWAY_MEMSTATS_PERIOD_MS)) == pdTRUE)
+        {
+            gateway_handle(&rx);
+        }
+
+        // Only the receive callback writes the counter: report the difference
+        uint32_t dropped = s_rx_dropped;
+        if (dropped != rx_dropped_reported)
+        {
+            EVLOG1(EVLOG_ESPNOW_RX_DROPPED, dropped - rx_dropped_reported);
+            ESP_LOGW(TAG, "RX queue full, %u frames dropped",
+                     (unsigned)(dropped - rx_dropped_reported));
+            rx_dropped_reported = dropped;
+        }
+
+        if (xTaskGetTickCount() - last_memstats >= pdMS_TO_TICKS(GATEWAY_MEMSTATS_PERIOD_MS))
+        {
+            measurement_memory_t mem;
+            memstats_sample(&mem);
+            memstats_log(&mem);
+            last_memstats = xTaskGetTickCount();
+        }
+    }
+}
+
+#endif // CONFIG_METEO_ROLE_ESPNOW_GATEWAY
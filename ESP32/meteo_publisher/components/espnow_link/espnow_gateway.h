@@ -0,0 +1,15 @@
+#pragma once
+
+#include "sdkconfig.h"
+
+/**
+ * ESP-NOW gateway role: receives measurement frames from sensor nodes,
+ * acknowledges them, drops retransmissions and republishes each
+ * measurement to sensors/<node>/environment over MQTT with the frame's
+ * RSSI as seen by the gateway.
+ *
+ * Wi-Fi must already be connected (wifi_init_and_connect()): ESP-NOW runs
+ * on the access point's channel, which the nodes must be configured with.
+ * Never returns.
+ */
+void espnow_gateway_run(void);
@@ -0,0 +1,200 @@
+/**
+ * @file espnow_pub.c
+ * @brief ESP-NOW uplink for battery nodes
+ */
+
+#include "espnow_pub.h"
+
+#ifdef CONFIG_UPLINK_TRANSPORT_ESPNOW
+
+#include "espnow_arq.h"
+#include "espnow_frame.h"
+#include "evlog.h"
+#include "nvs_lazy.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ESPNOW_ACK_QUEUE_LEN 4
+
+static const char *TAG = "ESPNOW";
+
+static uint8_t s_gateway_mac[ESP_NOW_ETH_ALEN];
+static QueueHandle_t s_ack_queue;
+static StaticQueue_t s_ack_queue_buf;
+static uint8_t s_ack_queue_storage[ESPNOW_ACK_QUEUE_LEN * sizeof(uint16_t)];
+static bool s_started;
+
+// Keeps counting across deep sleep so the gateway can tell retransmissions
+// from new frames
+RTC_DATA_ATTR static uint16_t s_seq;
+
+static void espnow_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    espnow_frame_t frame;
+    if (memcmp(info->src_addr, s_gateway_mac, ESP_NOW_ETH_ALEN) != 0 ||
+        !espnow_frame_decode(data, len, &frame) || frame.type != ESPNOW_FRAME_ACK)
+    {
+        return;
+    }
+    xQueueSend(s_ack_queue, &frame.seq, 0);
+}
+
+static bool espnow_tx(void *ctx, const uint8_t *frame, size_t len)
+{
+    (void)ctx;
+    return esp_now_send(s_gateway_mac, frame, len) == ESP_OK;
+}
+
+static bool espnow_wait_ack(void *ctx, uint16_t seq, uint32_t timeout_ms)
+{
+    (void)ctx;
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    uint16_t acked;
+
+    while (1)
+    {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = deadline > now ? deadline - now : 0;
+        if (xQueueReceive(s_ack_queue, &acked, wait) != pdTRUE)
+        {
+            return false;
+        }
+        if (acked == seq)
+        {
+            return true;
+        }
+        // Late ACK of an earlier attempt: keep waiting
+    }
+}
+
+static const espnow_arq_ops_t s_arq_ops = {
+    .tx = espnow_tx,
+    .wait_ack = espnow_wait_ack,
+    .ctx = NULL,
+};
+
+esp_err_t espnow_pub_connect(const char *device_id)
+{
+    (void)device_id;
+
+    if (sscanf(CONFIG_ESPNOW_GATEWAY_MAC, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &s_gateway_mac[0], &s_gateway_mac[1], &s_gateway_mac[2],
+               &s_gateway_mac[3], &s_gateway_mac[4], &s_gateway_mac[5]) != 6)
+    {
+        ESP_LOGE(TAG, "Invalid gateway MAC '%s'", CONFIG_ESPNOW_GATEWAY_MAC);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_ack_queue == NULL)
+    {
+        s_ack_queue = xQueueCreateStatic(ESPNOW_ACK_QUEUE_LEN, sizeof(uint16_t),
+                                         s_ack_queue_storage, &s_ack_queue_buf);
+    }
+    xQueueReset(s_ack_queue);
+
+    // PHY calibration data lives in NVS
+#if CONFIG_ESP_WIFI_NVS_ENABLED || CONFIG_ESP_PHY_CALIBRATION_AND_DATA_STORAGE
+    ESP_ERROR_CHECK(nvs_lazy_init());
+#endif
+
+    // Station mode without association: only the radio is brought up
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    esp_err_t ret = esp_wifi_init(&cfg);
+    if (ret == ESP_OK)
+        ret = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    if (ret == ESP_OK)
+        ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (ret == ESP_OK)
+        ret = esp_wifi_start();
+    if (ret == ESP_OK)
+        ret = esp_wifi_set_channel(CONFIG_ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    if (ret == ESP_OK)
+        ret = esp_now_init();
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Radio start failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_started = true;
+
+    esp_now_register_recv_cb(espnow_recv_cb);
+
+    esp_now_peer_info_t peer = {
+        .channel = CONFIG_ESPNOW_CHANNEL,
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, s_gateway_mac, ESP_NOW_ETH_ALEN);
+    ret = esp_now_add_peer(&peer);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to add gateway peer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_seq == 0)
+    {
+        // Cold boot: random start so a reboot is not mistaken for a retransmission
+        s_seq = (uint16_t)esp_random() | 1;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t espnow_pub_send(meteo_measurement_t *m)
+{
+    if (!s_started || m == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t frame[ESPNOW_FRAME_MAX_LEN];
+    uint16_t seq = s_seq++;
+
+    m->transport = espnow_transport.name;
+    size_t len = espnow_frame_encode_data(m, seq, frame, sizeof(frame));
+    if (len == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    int attempts = espnow_arq_send(&s_arq_ops, frame, len, seq,
+                                   CONFIG_ESPNOW_ACK_TIMEOUT_MS, CONFIG_ESPNOW_MAX_RETRIES);
+    if (attempts == 0)
+    {
+        ESP_LOGW(TAG, "No ACK for seq %u", seq);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    EVLOG2(EVLOG_ESPNOW_SENT, seq, attempts);
+    ESP_LOGI(TAG, "Frame seq %u (%u bytes) acknowledged after %d attempt(s)",
+             seq, (unsigned)len, attempts);
+    return ESP_OK;
+}
+
+void espnow_pub_disconnect(void)
+{
+    if (s_started)
+    {
+        esp_now_deinit();
+        esp_wifi_stop();
+        s_started = false;
+    }
+}
+
+const uplink_transport_t espnow_transport = {
+    .name = "espnow",
+    .connect = espnow_pub_connect,
+    .send = espnow_pub_send,
+    .disconnect = espnow_pub_disconnect,
+};
+
+#endif // CONFIG_UPLINK_TRANSPORT_ESPNOW
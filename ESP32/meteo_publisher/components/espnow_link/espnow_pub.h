@@ -0,0 +1,33 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "uplink.h"
+
+/**
+ * ESP-NOW uplink: the node does not associate with the access point.
+ * Measurements are sent as binary frames (espnow_frame.h) straight to a
+ * gateway node on CONFIG_ESPNOW_CHANNEL, which acknowledges them and
+ * forwards them to MQTT (espnow_gateway.h).
+ */
+extern const uplink_transport_t espnow_transport;
+
+/**
+ * Start the radio in station mode on the gateway's channel and
+ * register the gateway as ESP-NOW peer
+ * @param device_id Node name (sent in every frame)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t espnow_pub_connect(const char *device_id);
+
+/**
+ * Send one measurement and wait for the gateway's ACK
+ * @param m Measurement (m->transport is set to "espnow")
+ * @return ESP_OK when acknowledged, ESP_ERR_TIMEOUT after all retries
+ */
+esp_err_t espnow_pub_send(meteo_measurement_t *m);
+
+/**
+ * Stop ESP-NOW and the radio
+ */
+void espnow_pub_disconnect(void);
@@ -0,0 +1,86 @@
+/**
+ * @file evlog.c
+ * @brief Binary event log implementation
+ */
+
+#include "evlog.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+// Survives deep sleep and software resets; validated by magic after power-on
+static RTC_NOINIT_ATTR evlog_ring_t s_ring;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void evlog_reset(void)
+{
+    memset(&s_ring, 0, sizeof(s_ring));
+    s_ring.magic = EVLOG_MAGIC;
+    s_ring.version = EVLOG_FORMAT_VERSION;
+    s_ring.rec_size = sizeof(evlog_record_t);
+    s_ring.capacity = EVLOG_RING_SIZE;
+}
+
+void evlog_init(uint32_t reset_reason)
+{
+    if (s_ring.magic != EVLOG_MAGIC ||
+        s_ring.version != EVLOG_FORMAT_VERSION ||
+        s_ring.rec_size != sizeof(evlog_record_t) ||
+        s_ring.capacity != EVLOG_RING_SIZE ||
+        s_ring.head >= EVLOG_RING_SIZE ||
+        s_ring.count > EVLOG_RING_SIZE)
+    {
+        evlog_reset();
+    }
+
+    s_ring.wake++;
+    evlog_write(EVLOG_BOOT, 2, s_ring.wake, reset_reason, 0, 0);
+}
+
+void evlog_write(uint16_t id, uint8_t nargs,
+                 uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    uint32_t ts = esp_log_timestamp();
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+
+    evlog_record_t *rec = &s_ring.records[s_ring.head];
+    rec->ts_ms = ts;
+    rec->id = id;
+    rec->wake = (uint8_t)s_ring.wake;
+    rec->nargs = nargs > EVLOG_MAX_ARGS ? EVLOG_MAX_ARGS : nargs;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->args[3] = a3;
+
+    s_ring.head = (s_ring.head + 1) % EVLOG_RING_SIZE;
+    if (s_ring.count < EVLOG_RING_SIZE)
+    {
+        s_ring.count++;
+    }
+    else
+    {
+        s_ring.dropped++;
+    }
+
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+const evlog_ring_t *evlog_get_ring(size_t *len)
+{
+    if (len != NULL)
+    {
+        *len = sizeof(s_ring);
+    }
+    return &s_ring;
+}
+
+void evlog_clear(void)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    s_ring.head = 0;
+    s_ring.count = 0;
+    s_ring.dropped = 0;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
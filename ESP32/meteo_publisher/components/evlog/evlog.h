@@ -0,0 +1,130 @@
+/**
+ * @file evlog.h
+ * @brief Deferred binary event log kept in RTC memory
+ *
+ * Records compact binary events (id + up to four 32-bit arguments) into a
+ * ring buffer that survives deep sleep and software resets. Nothing is
+ * formatted on the device: the ring is uploaded over MQTT on request and
+ * rendered on the host by tools/evlog_decode.py using evlog_events.h.
+ *
+ * When CONFIG_EVLOG_ENABLED is not set, the EVLOGn() macros compile to
+ * nothing and their arguments are not evaluated.
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EVLOG_MAGIC 0x45564C47 // "EVLG"
+#define EVLOG_FORMAT_VERSION 1
+#define EVLOG_MAX_ARGS 4
+
+#ifdef CONFIG_EVLOG_RING_SIZE
+#define EVLOG_RING_SIZE CONFIG_EVLOG_RING_SIZE
+#else
+#define EVLOG_RING_SIZE 64
+#endif
+
+    /**
+     * Event identifiers - generated from evlog_events.h
+     */
+    typedef enum
+    {
+#define EVLOG_EVENT(id, fmt) id,
+#include "evlog_events.h"
+#undef EVLOG_EVENT
+        EVLOG_EVENT_COUNT
+    } evlog_event_t;
+
+    /**
+     * One log record (24 bytes, little endian)
+     */
+    typedef struct
+    {
+        uint32_t ts_ms;                ///< esp_log_timestamp() when recorded
+        uint16_t id;                   ///< evlog_event_t
+        uint8_t wake;                  ///< Low 8 bits of the wake counter
+        uint8_t nargs;                 ///< Number of valid entries in args
+        uint32_t args[EVLOG_MAX_ARGS]; ///< Raw argument words
+    } evlog_record_t;
+
+    /**
+     * Ring buffer as stored in RTC memory and uploaded verbatim
+     */
+    typedef struct
+    {
+        uint32_t magic;    ///< EVLOG_MAGIC when contents are valid
+        uint8_t version;   ///< EVLOG_FORMAT_VERSION
+        uint8_t rec_size;  ///< sizeof(evlog_record_t)
+        uint16_t capacity; ///< Number of record slots
+        uint16_t head;     ///< Next slot to write
+        uint16_t count;    ///< Number of valid records
+        uint32_t wake;     ///< Wake counter (incremented by evlog_init)
+        uint32_t dropped;  ///< Records overwritten before upload
+        evlog_record_t records[EVLOG_RING_SIZE];
+    } evlog_ring_t;
+
+    /**
+     * Validate the RTC ring (clearing it after power-on) and log EVLOG_BOOT
+     *
+     * @param reset_reason Value of esp_reset_reason() for the boot event
+     */
+    void evlog_init(uint32_t reset_reason);
+
+    /**
+     * Append one record to the ring
+     *
+     * Safe to call from any task. Prefer the EVLOGn() macros.
+     */
+    void evlog_write(uint16_t id, uint8_t nargs,
+                     uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+    /**
+     * Get the ring for upload
+     *
+     * @param len Receives the number of bytes to upload
+     * @return Pointer to the ring in RTC memory
+     */
+    const evlog_ring_t *evlog_get_ring(size_t *len);
+
+    /**
+     * Drop all records (after a successful upload)
+     */
+    void evlog_clear(void);
+
+    /**
+     * Store a float argument as its raw bit pattern
+     */
+    static inline uint32_t evlog_f(float value)
+    {
+        uint32_t word;
+        memcpy(&word, &value, sizeof(word));
+        return word;
+    }
+
+#ifdef CONFIG_EVLOG_ENABLED
+#define EVLOG0(id) evlog_write((id), 0, 0, 0, 0, 0)
+#define EVLOG1(id, a0) evlog_write((id), 1, (uint32_t)(a0), 0, 0, 0)
+#define EVLOG2(id, a0, a1) evlog_write((id), 2, (uint32_t)(a0), (uint32_t)(a1), 0, 0)
+#define EVLOG3(id, a0, a1, a2) evlog_write((id), 3, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), 0)
+#define EVLOG4(id, a0, a1, a2, a3) evlog_write((id), 4, (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3))
+#else
+// sizeof() marks the arguments as used without evaluating them
+#define EVLOG0(id) ((void)0)
+#define EVLOG1(id, a0) ((void)sizeof(a0))
+#define EVLOG2(id, a0, a1) ((void)sizeof(a0), (void)sizeof(a1))
+#define EVLOG3(id, a0, a1, a2) ((void)sizeof(a0), (void)sizeof(a1), (void)sizeof(a2))
+#define EVLOG4(id, a0, a1, a2, a3) ((void)sizeof(a0), (void)sizeof(a1), (void)sizeof(a2), (void)sizeof(a3))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
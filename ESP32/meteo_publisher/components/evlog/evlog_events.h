@@ -0,0 +1,54 @@
+/**
+ * @file evlog_events.h
+ * @brief Event table for the binary event log
+ *
+ * Each entry declares an event id and the printf-style format used to
+ * render its arguments on the host (tools/evlog_decode.py parses this file).
+ * Arguments are stored as raw 32-bit words: %f reinterprets the word as a
+ * float, %d as a signed and %u/%x as an unsigned integer.
+ *
+ * Ids are positional - only ever append new events at the end, otherwise
+ * logs captured with older firmware decode with the wrong format.
+ *
+ * No include guard: this file is expanded with different EVLOG_EVENT
+ * definitions by evlog.h.
+ */
+
+EVLOG_EVENT(EVLOG_BOOT, "Boot wake=%u reset_reason=%u")
+EVLOG_EVENT(EVLOG_BMP280_READ, "BMP280 Temperature: %.2f C, Pressure: %.2f Pa")
+EVLOG_EVENT(EVLOG_AHT20_READ, "AHT20 Temperature: %.2f C, Humidity: %.2f %%")
+EVLOG_EVENT(EVLOG_DHT22_READ, "DHT22 Temperature: %.1f C, Humidity: %.1f %%")
+EVLOG_EVENT(EVLOG_WIFI_CONNECTED, "Wi-Fi connected")
+EVLOG_EVENT(EVLOG_WIFI_RSSI, "RSSI: %d dBm")
+EVLOG_EVENT(EVLOG_APP_ALTITUDE, "Altitude: %.1f m, Free heap: %u bytes")
+EVLOG_EVENT(EVLOG_MQTT_PUBLISHED, "MQTT published msg_id=%d payload_len=%u")
+EVLOG_EVENT(EVLOG_MQTT_LOG_UPLOAD, "MQTT log upload msg_id=%d bytes=%u")
+EVLOG_EVENT(EVLOG_APP_SLEEP, "Sleeping %u ms")
+EVLOG_EVENT(EVLOG_COAP_SENT, "CoAP message_id=%u sent, attempts=%u")
+EVLOG_EVENT(EVLOG_ESPNOW_SENT, "ESP-NOW seq=%u acknowledged, attempts=%u")
+EVLOG_EVENT(EVLOG_ESPNOW_FORWARDED, "ESP-NOW gateway forwarded seq=%u rssi=%d duplicate=%u")
+EVLOG_EVENT(EVLOG_GOVERNOR_PROFILE, "Oversampling profile=%u variability=%.2f Pa battery=%u mV")
+EVLOG_EVENT(EVLOG_POWER_TIER, "Battery %u mV tier=%u batched=%u")
+EVLOG_EVENT(EVLOG_AHT20_RETRY, "AHT20 retry attempt=%u after err=0x%x")
+EVLOG_EVENT(EVLOG_BMP280_RETRY, "BMP280 retry attempt=%u after err=0x%x")
+EVLOG_EVENT(EVLOG_AHT20_STATS, "AHT20 reads=%u retries=%u crc_errors=%u failures=%u")
+EVLOG_EVENT(EVLOG_BMP280_STATS, "BMP280 reads=%u retries=%u implausible=%u failures=%u")
+EVLOG_EVENT(EVLOG_I2C_BUS_RECOVERY, "I2C bus recovery clocks=%u released=%u")
+EVLOG_EVENT(EVLOG_I2C_PROBE, "I2C probe addr=0x%02x err=0x%x")
+EVLOG_EVENT(EVLOG_WIFI_DISCONNECTED, "Wi-Fi disconnected reason=%u")
+EVLOG_EVENT(EVLOG_HEALTH, "Health reset=%u wake=%u failed_publishes=%u sensor_failures=%u")
+EVLOG_EVENT(EVLOG_MEMSTATS_HEAP, "Heap min_free=%u largest=%u internal=%u psram=%u")
+EVLOG_EVENT(EVLOG_MEMSTATS_STACK, "Unused stack main=%u wifi=%u tcpip=%u mqtt=%u")
+EVLOG_EVENT(EVLOG_HEAP_AUDIT, "Heap audit phase=%u allocs=%u bytes=%u other_allocs=%u")
+EVLOG_EVENT(EVLOG_OUTBOX_STORED, "Outbox stored seq=%u pending=%u dropped=%u")
+EVLOG_EVENT(EVLOG_OUTBOX_REPLAYED, "Outbox replayed %u, pending=%u dropped=%u")
+EVLOG_EVENT(EVLOG_MQTT_BATCH_PUBLISHED, "MQTT batch published msg_id=%d samples=%u bytes=%u")
+EVLOG_EVENT(EVLOG_CONFIG_APPLIED, "Config version=%u applied interval=%u ms bmp_profile=%u")
+EVLOG_EVENT(EVLOG_CONFIG_REJECTED, "Config version=%u rejected")
+EVLOG_EVENT(EVLOG_POWER_LOCKS, "PM full clock held i2c=%u ms radio=%u ms bitbang=%u ms")
+EVLOG_EVENT(EVLOG_WIFI_TX_POWER, "Wi-Fi TX power %d -> %d (0.25 dBm) worst rssi=%d")
+EVLOG_EVENT(EVLOG_TIME_SYNC, "SNTP offset %u s drift=%d ms")
+EVLOG_EVENT(EVLOG_I2C_TRACE, "I2C device=%u transactions=%u busy=%u us errors=%u")
+EVLOG_EVENT(EVLOG_RTC_STATE_RESET, "RTC state %08x reset reason=%u")
+EVLOG_EVENT(EVLOG_ESPNOW_FORWARD_FAILED, "ESP-NOW gateway publish failed seq=%u err=0x%x")
+EVLOG_EVENT(EVLOG_ESPNOW_RX_DROPPED, "ESP-NOW gateway RX queue full, dropped=%u")
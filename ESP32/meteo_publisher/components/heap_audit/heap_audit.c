@@ -0,0 +1,116 @@
+/**
+ * @file heap_audit.c
+ * @brief Heap allocation counter implementation
+ */
+
+#include "heap_audit.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef CONFIG_HEAP_AUDIT_ENABLED
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+static const char *TAG = "HEAP_AUDIT";
+
+static const char *const PHASE_NAMES[] = {"measure", "publish"};
+
+#ifdef CONFIG_HEAP_AUDIT_ENABLED
+static heap_audit_counts_t s_counts;
+static TaskHandle_t s_task;       // Task whose allocations are counted in allocs/frees/bytes
+static volatile bool s_zero_heap; // A zero-heap phase is open in s_task
+
+// The hooks run inside the allocator, possibly from interrupts or with the
+// flash cache disabled: IRAM only, no locks, no logging.
+static IRAM_ATTR bool in_audited_task(void)
+{
+    return !xPortInIsrContext() && xTaskGetCurrentTaskHandle() == s_task;
+}
+
+IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (!in_audited_task())
+    {
+        __atomic_fetch_add(&s_counts.other_allocs, 1, __ATOMIC_RELAXED);
+        return;
+    }
+#ifdef CONFIG_HEAP_AUDIT_STRICT
+    if (s_zero_heap)
+    {
+        esp_system_abort("heap allocation in a zero-heap phase");
+    }
+#endif
+    __atomic_fetch_add(&s_counts.allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s_counts.bytes, (uint32_t)size, __ATOMIC_RELAXED);
+}
+
+IRAM_ATTR void esp_heap_trace_free_hook(void *ptr)
+{
+    if (ptr != NULL && in_audited_task())
+    {
+        __atomic_fetch_add(&s_counts.frees, 1, __ATOMIC_RELAXED);
+    }
+}
+#endif
+
+void heap_audit_begin(heap_audit_phase_t phase, heap_audit_counts_t *start)
+{
+#ifdef CONFIG_HEAP_AUDIT_ENABLED
+    // Counts of a previous task are meaningless for the new one
+    if (s_task != xTaskGetCurrentTaskHandle())
+    {
+        s_task = xTaskGetCurrentTaskHandle();
+        memset(&s_counts, 0, sizeof(s_counts));
+    }
+    *start = s_counts;
+    s_zero_heap = phase == HEAP_AUDIT_PHASE_MEASURE;
+#else
+    (void)phase;
+    memset(start, 0, sizeof(*start));
+#endif
+}
+
+uint32_t heap_audit_end(heap_audit_phase_t phase, heap_audit_counts_t *start)
+{
+#ifdef CONFIG_HEAP_AUDIT_ENABLED
+    s_zero_heap = false;
+
+    heap_audit_counts_t now = s_counts;
+    start->allocs = now.allocs - start->allocs;
+    start->frees = now.frees - start->frees;
+    start->bytes = now.bytes - start->bytes;
+    start->other_allocs = now.other_allocs - start->other_allocs;
+
+    EVLOG4(EVLOG_HEAP_AUDIT, phase, start->allocs, start->bytes, start->other_allocs);
+    if (phase == HEAP_AUDIT_PHASE_MEASURE && start->allocs != 0)
+    {
+        ESP_LOGW(TAG, "Phase %s allocated %lu times (%lu bytes), expected none",
+                 PHASE_NAMES[phase], (unsigned long)start->allocs, (unsigned long)start->bytes);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Phase %s: %lu allocs (%lu bytes), %lu frees, %lu allocs by other tasks",
+                 PHASE_NAMES[phase], (unsigned long)start->allocs, (unsigned long)start->bytes,
+                 (unsigned long)start->frees, (unsigned long)start->other_allocs);
+    }
+    return start->allocs;
+#else
+    (void)phase;
+    (void)PHASE_NAMES;
+    (void)TAG;
+    memset(start, 0, sizeof(*start));
+    return 0;
+#endif
+}
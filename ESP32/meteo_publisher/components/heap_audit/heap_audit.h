@@ -0,0 +1,64 @@
+/**
+ * @file heap_audit.h
+ * @brief Heap allocation counter for phases of the wake
+ *
+ * Counts heap allocations and frees through the ESP-IDF heap hooks
+ * (CONFIG_HEAP_USE_HOOKS) so a phase of the wake can be checked for heap
+ * use. Allocations of the task that began the phase are counted apart from
+ * those of other tasks (Wi-Fi, lwIP, esp-mqtt) and interrupts.
+ * With CONFIG_HEAP_AUDIT_STRICT the first allocation of the auditing task
+ * in a zero-heap phase aborts, so the panic backtrace names the caller.
+ * Without CONFIG_HEAP_AUDIT_ENABLED all counts are 0.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Phases checked by the application
+     */
+    typedef enum
+    {
+        HEAP_AUDIT_PHASE_MEASURE = 0, ///< Sensor reads and measurement assembly, must not allocate
+        HEAP_AUDIT_PHASE_PUBLISH = 1, ///< Uplink session, reported only
+    } heap_audit_phase_t;
+
+    /**
+     * Heap use of a phase
+     */
+    typedef struct
+    {
+        uint32_t allocs;       ///< Allocations by the auditing task
+        uint32_t frees;        ///< Frees by the auditing task
+        uint32_t bytes;        ///< Bytes requested by those allocations
+        uint32_t other_allocs; ///< Allocations by other tasks and interrupts
+    } heap_audit_counts_t;
+
+    /**
+     * Begin a phase in the calling task
+     *
+     * @param phase Phase that starts
+     * @param start Filled with the counters at the start of the phase
+     */
+    void heap_audit_begin(heap_audit_phase_t phase, heap_audit_counts_t *start);
+
+    /**
+     * End a phase: compute and log its heap use
+     *
+     * @param phase Phase that ends
+     * @param start Counters from heap_audit_begin(), replaced by the use of the phase
+     * @return Allocations by the auditing task in the phase
+     */
+    uint32_t heap_audit_end(heap_audit_phase_t phase, heap_audit_counts_t *start);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,168 @@
+/**
+ * @file i2c_bus.c
+ * @brief Shared I²C master bus implementation
+ */
+
+#include "i2c_bus.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "evlog.h"
+#include "power_mgmt.h"
+#include "sensor_sim.h"
+
+static const char *TAG = "I2C_BUS";
+
+// Half period of the recovery clock (100 kHz)
+#define RECOVERY_HALF_PERIOD_US 5
+
+// A slave shifts out at most 8 data bits and waits for the ACK clock
+#define RECOVERY_MAX_PULSES 9
+
+// Command link for START, address, STOP
+#define PROBE_LINK_SIZE I2C_LINK_RECOMMENDED_SIZE(1)
+
+esp_err_t i2c_bus_recover(gpio_num_t sda_pin, gpio_num_t scl_pin, uint8_t *pulses)
+{
+    uint8_t count = 0;
+    if (pulses != NULL)
+    {
+        *pulses = 0;
+    }
+
+    // Open drain with pull-ups: the master only ever pulls lines low
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << sda_pin) | (1ULL << scl_pin),
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    gpio_set_level(sda_pin, 1);
+    gpio_set_level(scl_pin, 1);
+    esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+
+    if (gpio_get_level(scl_pin) == 0)
+    {
+        ESP_LOGE(TAG, "SCL held low, bus cannot be recovered");
+        EVLOG2(EVLOG_I2C_BUS_RECOVERY, 0, 0);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (gpio_get_level(sda_pin) == 1)
+    {
+        return ESP_OK; // Bus idle
+    }
+
+    // Clock until the slave releases SDA
+    while (count < RECOVERY_MAX_PULSES && gpio_get_level(sda_pin) == 0)
+    {
+        gpio_set_level(scl_pin, 0);
+        esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(scl_pin, 1);
+        esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+        count++;
+    }
+
+    // STOP: SDA rises while SCL is high
+    gpio_set_level(scl_pin, 0);
+    gpio_set_level(sda_pin, 0);
+    esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(scl_pin, 1);
+    esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(sda_pin, 1);
+    esp_rom_delay_us(RECOVERY_HALF_PERIOD_US);
+
+    bool released = gpio_get_level(sda_pin) == 1;
+    if (pulses != NULL)
+    {
+        *pulses = count;
+    }
+
+    EVLOG2(EVLOG_I2C_BUS_RECOVERY, count, released);
+    if (!released)
+    {
+        ESP_LOGE(TAG, "SDA still low after %u clocks", count);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    ESP_LOGW(TAG, "SDA was held low, released after %u clocks", count);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *config)
+{
+    if (config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#ifndef CONFIG_SENSOR_SIMULATED
+    // The pins are routed back to the controller by i2c_param_config()
+    i2c_bus_recover(config->sda_pin, config->scl_pin, NULL);
+#endif
+
+    i2c_config_t i2c_conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = config->sda_pin,
+        .scl_io_num = config->scl_pin,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = config->freq_hz,
+    };
+
+    esp_err_t ret = i2c_param_config(config->port, &i2c_conf);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "I2C config failed: %d", ret);
+        return ret;
+    }
+
+    ret = i2c_driver_install(config->port, i2c_conf.mode, 0, 0, 0);
+    if (ret == ESP_ERR_INVALID_STATE || ret == ESP_FAIL)
+    {
+        ret = ESP_OK; // Already installed
+    }
+    else if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "I2C driver install failed: %d", ret);
+    }
+    return ret;
+}
+
+esp_err_t i2c_bus_probe(i2c_port_t port, uint8_t addr, uint32_t timeout_ms)
+{
+#ifdef CONFIG_SENSOR_SIMULATED
+    (void)port;
+    (void)timeout_ms;
+    esp_err_t sim = sensor_sim_transfer(addr, NULL, 0, NULL, 0);
+    EVLOG2(EVLOG_I2C_PROBE, addr, sim);
+    return sim == ESP_OK ? ESP_OK : ESP_ERR_NOT_FOUND;
+#else
+    uint8_t link[PROBE_LINK_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(link, sizeof(link));
+    if (cmd == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_stop(cmd);
+    power_lock_acquire(POWER_LOCK_I2C);
+    esp_err_t ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(timeout_ms));
+    power_lock_release(POWER_LOCK_I2C);
+    i2c_cmd_link_delete_static(cmd);
+
+    EVLOG2(EVLOG_I2C_PROBE, addr, ret);
+    if (ret == ESP_FAIL)
+    {
+        return ESP_ERR_NOT_FOUND; // No ACK
+    }
+    return ret;
+#endif
+}
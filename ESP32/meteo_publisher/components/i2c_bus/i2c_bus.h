@@ -0,0 +1,78 @@
+/**
+ * @file i2c_bus.h
+ * @brief Shared I²C master bus: line recovery, driver install and device probing
+ *
+ * A slave reset in the middle of a read (brown-out, deep sleep entered
+ * during a transfer) can keep SDA low forever. i2c_bus_init() checks the
+ * idle lines first and clocks SCL up to nine times until the slave has
+ * shifted out its byte and releases SDA, then sends a STOP.
+ * i2c_bus_probe() addresses a device without a payload and a short
+ * timeout, so absent sensors are found in milliseconds.
+ * The sensor drivers reuse the installed driver. No heap allocation.
+ */
+
+#pragma once
+
+#include "driver/i2c.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Default timeout of i2c_bus_probe()
+#define I2C_BUS_PROBE_TIMEOUT_MS 10
+
+    /**
+     * Configuration of the bus
+     */
+    typedef struct
+    {
+        i2c_port_t port;
+        gpio_num_t sda_pin;
+        gpio_num_t scl_pin;
+        uint32_t freq_hz;
+    } i2c_bus_config_t;
+
+    /**
+     * Release a bus held low by a slave (9-clock bus clear, then STOP)
+     *
+     * Must be called before the I²C driver owns the pins.
+     *
+     * @param sda_pin SDA GPIO
+     * @param scl_pin SCL GPIO
+     * @param pulses Pointer to store the SCL pulses needed (may be NULL)
+     * @return ESP_OK if both lines are high afterwards,
+     *         ESP_ERR_INVALID_STATE if SCL is held low (cannot be cleared by the master),
+     *         ESP_ERR_TIMEOUT if SDA is still low after nine pulses
+     */
+    esp_err_t i2c_bus_recover(gpio_num_t sda_pin, gpio_num_t scl_pin, uint8_t *pulses);
+
+    /**
+     * Recover the lines if needed and install the master driver
+     *
+     * An already installed driver is reused. A failed recovery is logged
+     * but the driver is still installed: devices may answer anyway.
+     *
+     * @param config Pointer to bus configuration
+     * @return ESP_OK if the driver is ready, error code otherwise
+     */
+    esp_err_t i2c_bus_init(const i2c_bus_config_t *config);
+
+    /**
+     * Check whether a device acknowledges its address
+     *
+     * @param port I²C port with installed driver
+     * @param addr 7-bit device address
+     * @param timeout_ms Transaction timeout
+     * @return ESP_OK if acknowledged, ESP_ERR_NOT_FOUND if not,
+     *         ESP_ERR_TIMEOUT if the bus is busy or stuck
+     */
+    esp_err_t i2c_bus_probe(i2c_port_t port, uint8_t addr, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
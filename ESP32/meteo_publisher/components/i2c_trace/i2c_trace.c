@@ -0,0 +1,138 @@
+/**
+ * @file i2c_trace.c
+ * @brief I²C transaction tracer implementation
+ */
+
+#include "i2c_trace.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "I2C_TRACE";
+
+#ifdef CONFIG_I2C_TRACE_ENABLED
+
+static measurement_i2c_t s_trace;
+
+static void add_u16(uint16_t *counter)
+{
+    if (*counter < UINT16_MAX)
+    {
+        (*counter)++;
+    }
+}
+
+static void add_u32(uint32_t *counter, uint32_t value)
+{
+    *counter = value > UINT32_MAX - *counter ? UINT32_MAX : *counter + value;
+}
+
+/**
+ * Histogram bucket: below 250 us, below 500 us, ... , 16 ms and more
+ */
+static size_t latency_bucket(uint32_t elapsed_us)
+{
+    size_t bucket = 0;
+    uint32_t limit = MEASUREMENT_I2C_BUCKET0_US;
+    while (bucket < MEASUREMENT_I2C_BUCKETS - 1 && elapsed_us >= limit)
+    {
+        limit <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void i2c_trace_record(measurement_i2c_device_t device, size_t bytes, esp_err_t ret, uint32_t elapsed_us)
+{
+    if (device >= MEASUREMENT_I2C_DEVICES)
+    {
+        return;
+    }
+
+    measurement_i2c_stats_t *s = &s_trace.device[device];
+    add_u32(&s->transactions, 1);
+    add_u32(&s->bytes, (uint32_t)bytes);
+    add_u32(&s->busy_us, elapsed_us);
+    if (elapsed_us > s->max_us)
+    {
+        s->max_us = elapsed_us;
+    }
+    add_u16(&s->hist[latency_bucket(elapsed_us)]);
+
+    // Legacy driver: ESP_FAIL is a missing ACK, ESP_ERR_TIMEOUT a busy or stuck bus
+    if (ret == ESP_FAIL)
+    {
+        add_u16(&s->nacks);
+    }
+    else if (ret == ESP_ERR_TIMEOUT)
+    {
+        add_u16(&s->timeouts);
+    }
+}
+
+void i2c_trace_summary(measurement_i2c_t *summary)
+{
+    if (summary != NULL)
+    {
+        *summary = s_trace;
+    }
+}
+
+void i2c_trace_dump(void)
+{
+    for (uint8_t d = 0; d < MEASUREMENT_I2C_DEVICES; d++)
+    {
+        const measurement_i2c_stats_t *s = &s_trace.device[d];
+        if (s->transactions == 0)
+        {
+            continue;
+        }
+
+        EVLOG4(EVLOG_I2C_TRACE, d, s->transactions, s->busy_us, s->nacks + s->timeouts);
+        ESP_LOGI(TAG, "%s: %lu transactions, %lu bytes, %u NACK, %u timeout, busy %lu us, max %lu us",
+                 measurement_i2c_device_name(d), (unsigned long)s->transactions, (unsigned long)s->bytes,
+                 s->nacks, s->timeouts, (unsigned long)s->busy_us, (unsigned long)s->max_us);
+
+        char hist[96];
+        int n = 0;
+        uint32_t limit = MEASUREMENT_I2C_BUCKET0_US;
+        for (size_t b = 0; b < MEASUREMENT_I2C_BUCKETS && n < (int)sizeof(hist); b++, limit <<= 1)
+        {
+            if (b < MEASUREMENT_I2C_BUCKETS - 1)
+            {
+                n += snprintf(hist + n, sizeof(hist) - n, " <%lu:%u", (unsigned long)limit, s->hist[b]);
+            }
+            else
+            {
+                n += snprintf(hist + n, sizeof(hist) - n, " >=%lu:%u", (unsigned long)(limit >> 1), s->hist[b]);
+            }
+        }
+        ESP_LOGI(TAG, "%s latency (us):%s", measurement_i2c_device_name(d), hist);
+    }
+}
+
+#else
+
+void i2c_trace_record(measurement_i2c_device_t device, size_t bytes, esp_err_t ret, uint32_t elapsed_us)
+{
+    (void)device;
+    (void)bytes;
+    (void)ret;
+    (void)elapsed_us;
+}
+
+void i2c_trace_summary(measurement_i2c_t *summary)
+{
+    if (summary != NULL)
+    {
+        memset(summary, 0, sizeof(*summary));
+    }
+}
+
+void i2c_trace_dump(void)
+{
+    ESP_LOGD(TAG, "Tracing disabled");
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file i2c_trace.h
+ * @brief I²C transaction tracer of the sensor drivers
+ *
+ * The register access helpers of the BMP280 and AHT20 drivers wrap each
+ * bus transaction in I2C_TRACE_BEGIN()/I2C_TRACE_END(). With
+ * CONFIG_I2C_TRACE_ENABLED every transaction adds to the counters of its
+ * device: bytes, NACKs, timeouts, total and longest latency and a latency
+ * histogram. Counters start at zero on every boot, so they cover one wake.
+ *
+ * Without CONFIG_I2C_TRACE_ENABLED the macros compile to nothing and their
+ * arguments are not evaluated. Only the main task may trace: no locking.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "measurement.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_I2C_TRACE_ENABLED
+#include "esp_timer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifdef CONFIG_I2C_TRACE_ENABLED
+#define I2C_TRACE_BEGIN(start) const int64_t start = esp_timer_get_time()
+#define I2C_TRACE_END(start, device, bytes, ret) \
+    i2c_trace_record((device), (bytes), (ret), (uint32_t)(esp_timer_get_time() - (start)))
+#else
+#define I2C_TRACE_BEGIN(start)
+#define I2C_TRACE_END(start, device, bytes, ret) \
+    do                                           \
+    {                                            \
+    } while (0)
+#endif
+
+    /**
+     * Add one transaction to the counters of a device
+     *
+     * @param device measurement_i2c_device_t
+     * @param bytes Bytes written and read, register address included
+     * @param ret Result of the transaction (ESP_FAIL: NACK)
+     * @param elapsed_us Latency of the transaction
+     */
+    void i2c_trace_record(measurement_i2c_device_t device, size_t bytes, esp_err_t ret, uint32_t elapsed_us);
+
+    /**
+     * Copy the counters of this wake, e.g. into the payload
+     *
+     * @param summary Pointer to store the counters (all zero when not traced)
+     */
+    void i2c_trace_summary(measurement_i2c_t *summary);
+
+    /**
+     * Print the counters and histograms of every traced device (console and event log)
+     */
+    void i2c_trace_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file memstats.c
+ * @brief Heap and task stack telemetry implementation
+ */
+
+#include "memstats.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "evlog.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "MEMSTATS";
+
+/**
+ * Unused stack bytes of a task (ESP-IDF stacks are counted in bytes), 0 if not running
+ */
+static uint16_t stack_unused(const char *task_name)
+{
+    TaskHandle_t task = xTaskGetHandle(task_name);
+    if (task == NULL)
+    {
+        return 0;
+    }
+
+    UBaseType_t unused = uxTaskGetStackHighWaterMark(task);
+    return unused > UINT16_MAX ? UINT16_MAX : (uint16_t)unused;
+}
+
+void memstats_sample(measurement_memory_t *mem)
+{
+    if (mem == NULL)
+    {
+        return;
+    }
+
+    mem->min_free_heap = esp_get_minimum_free_heap_size();
+    mem->largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    mem->free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    mem->free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    // Task names given by ESP-IDF and esp-mqtt
+    mem->stack_main = stack_unused("main");
+    mem->stack_wifi = stack_unused("wifi");
+    mem->stack_tcpip = stack_unused("tiT");
+    mem->stack_event = stack_unused("sys_evt");
+    mem->stack_mqtt = stack_unused("mqtt_task");
+}
+
+void memstats_log(const measurement_memory_t *mem)
+{
+    EVLOG4(EVLOG_MEMSTATS_HEAP, mem->min_free_heap, mem->largest_block, mem->free_internal, mem->free_psram);
+    EVLOG4(EVLOG_MEMSTATS_STACK, mem->stack_main, mem->stack_wifi, mem->stack_tcpip, mem->stack_mqtt);
+    ESP_LOGI(TAG, "Heap: min free %lu, largest block %lu, internal %lu, PSRAM %lu",
+             (unsigned long)mem->min_free_heap, (unsigned long)mem->largest_block,
+             (unsigned long)mem->free_internal, (unsigned long)mem->free_psram);
+    ESP_LOGI(TAG, "Unused stack: main %u, wifi %u, tcpip %u, event %u, mqtt %u",
+             mem->stack_main, mem->stack_wifi, mem->stack_tcpip, mem->stack_event, mem->stack_mqtt);
+}
@@ -0,0 +1,39 @@
+/**
+ * @file memstats.h
+ * @brief Heap and task stack telemetry
+ *
+ * Samples the minimum-ever free heap, the largest free block, internal vs
+ * PSRAM free memory and the stack high-water marks of the system tasks a
+ * wake runs (main, Wi-Fi, lwIP, event loop, esp-mqtt). Call it at the
+ * peak of the wake, with the uplink session open, to size stacks and
+ * buffers; log it periodically in long-running roles to spot leaks.
+ * Sensor drivers run in the main task and have no stack of their own.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include "measurement.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Sample heap and stack use now
+     *
+     * @param mem Pointer to store the sample
+     */
+    void memstats_sample(measurement_memory_t *mem);
+
+    /**
+     * Log a sample (console and event log)
+     *
+     * @param mem Sample from memstats_sample()
+     */
+    void memstats_log(const measurement_memory_t *mem);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,71 +1,368 @@
 #include "mqtt_pub.h"
+#include "evlog.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "mqtt_client.h"
+#include "payload.h"
+#include "runtime_config.h"
+#include "tscodec.h"
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
-#include <math.h>
 
 #define MQTT_URI CONFIG_MQTT_BROKER_URI
 #define MQTT_USER CONFIG_MQTT_USERNAME
 #define MQTT_PASS CONFIG_MQTT_PASSWORD
 
+#define MQTT_TOPIC_LEN 128
+
+#define MQTT_PUBACK_QUEUE_LEN 4
+#define MQTT_SESSION_LOST -1 // Queued instead of a msg_id when the connection drops
+
+// Session state, set by the event handler
+#define MQTT_CONNECTED_BIT BIT0
+#define MQTT_DISCONNECTED_BIT BIT1
+
+// Longest PUBLISH: fixed header (1 + 2 length bytes), topic length,
+// packet id, topic and payload
+#define MQTT_TX_BUFFER_SIZE (UPLINK_JSON_MAX_LEN + MQTT_TOPIC_LEN + 7)
+
 static const char *TAG = "MQTT";
 
-void mqtt_publish_measurement(const char *device_id, const char *fw,
-                              float dht_temp, float dht_rh,
-                              float aht20_temp, float aht20_rh,
-                              float bmp_temp, float bmp_press,
-                              int8_t rssi, float altitude_m,
-                              uint32_t free_heap)
+// Client and node of the current publish session
+static esp_mqtt_client_handle_t s_client;
+static char s_device_id[MEASUREMENT_DEVICE_ID_LEN];
+static EventGroupHandle_t s_events;
+static StaticEventGroup_t s_events_buf;
+
+// Message ids of PUBACKs received, for mqtt_wait_puback()
+static QueueHandle_t s_puback_queue;
+static StaticQueue_t s_puback_queue_buf;
+static uint8_t s_puback_queue_storage[MQTT_PUBACK_QUEUE_LEN * sizeof(int)];
+
+// Formatting buffers of mqtt_pub_send(), static to keep them off the main task stack
+static char s_payload[UPLINK_JSON_MAX_LEN];
+static char s_topic[MQTT_TOPIC_LEN];
+
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+// Retained request set by the operator, e.g.
+//   mosquitto_pub -r -t sensors/<node>/log/request -m 1
+static char s_log_request_topic[MQTT_TOPIC_LEN];
+static volatile bool s_log_upload_requested;
+static volatile int s_log_upload_msg_id = -1;
+#endif
+
+#ifdef CONFIG_REMOTE_CONFIG_ENABLED
+// Retained configuration, delivered by the broker on subscribe: no extra
+// round trip, and applied after the session (runtime_config.h)
+static char s_config_topic[MQTT_TOPIC_LEN];
+static char s_config_msg[RUNTIME_CONFIG_MSG_MAX_LEN];
+static volatile size_t s_config_len;
+#endif
+
+#ifdef CONFIG_BENCH_PUBLISH_LATENCY
+// Measurement whose PUBACK ends the benchmark, and when CONNACK arrived
+static volatile int s_bench_msg_id = -1;
+static int64_t s_bench_connack_us;
+#endif
+
+#if defined(CONFIG_EVLOG_MQTT_UPLOAD) || defined(CONFIG_REMOTE_CONFIG_ENABLED)
+static bool topic_is(esp_mqtt_event_handle_t event, const char *topic)
+{
+    return event->topic_len == (int)strlen(topic) && strncmp(event->topic, topic, event->topic_len) == 0;
+}
+#endif
+
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
+                               int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = event_data;
+    int lost = MQTT_SESSION_LOST;
+
+    switch ((esp_mqtt_event_id_t)event_id)
+    {
+    case MQTT_EVENT_CONNECTED:
+        xEventGroupClearBits(s_events, MQTT_DISCONNECTED_BIT);
+        xEventGroupSetBits(s_events, MQTT_CONNECTED_BIT);
+#ifdef CONFIG_BENCH_PUBLISH_LATENCY
+        s_bench_connack_us = esp_timer_get_time();
+#endif
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+        esp_mqtt_client_subscribe(event->client, s_log_request_topic, 0);
+#endif
+#ifdef CONFIG_REMOTE_CONFIG_ENABLED
+        esp_mqtt_client_subscribe(event->client, s_config_topic, 0);
+#endif
+        break;
+
+    case MQTT_EVENT_DISCONNECTED:
+        // Also after a failed connect attempt; a waiting send gives up at once
+        xEventGroupClearBits(s_events, MQTT_CONNECTED_BIT);
+        xEventGroupSetBits(s_events, MQTT_DISCONNECTED_BIT);
+        xQueueSend(s_puback_queue, &lost, 0);
+        break;
+
+    case MQTT_EVENT_DATA:
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+        // Empty retained payload means the request was already served
+        if (topic_is(event, s_log_request_topic) && event->data_len > 0)
+        {
+            s_log_upload_requested = true;
+        }
+#endif
+#ifdef CONFIG_REMOTE_CONFIG_ENABLED
+        // Only complete messages; fragments (longer than the receive buffer) are ignored
+        if (topic_is(event, s_config_topic) && event->data_len > 0 &&
+            event->data_len == event->total_data_len && event->data_len <= (int)sizeof(s_config_msg))
+        {
+            memcpy(s_config_msg, event->data, event->data_len);
+            s_config_len = event->data_len;
+        }
+#endif
+        break;
+
+    case MQTT_EVENT_PUBLISHED:
+        xQueueSend(s_puback_queue, &event->msg_id, 0);
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+        if (event->msg_id == s_log_upload_msg_id)
+        {
+            evlog_clear();
+            s_log_upload_msg_id = -1;
+            ESP_LOGI(TAG, "Event log uploaded");
+        }
+#endif
+#ifdef CONFIG_BENCH_PUBLISH_LATENCY
+        if (event->msg_id == s_bench_msg_id)
+        {
+            // Plain printf, kept with logging disabled: parsed by host/qemu_bench
+            printf("BENCH connack_us=%lld puback_us=%lld\n",
+                   (long long)s_bench_connack_us, (long long)esp_timer_get_time());
+            s_bench_msg_id = -1;
+        }
+#endif
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Wait for the PUBACK of a QoS 1 publish
+ *
+ * esp-mqtt also returns a msg_id for a message it only queued while
+ * disconnected: such a message counts as not delivered.
+ * @param msg_id Return value of esp_mqtt_client_publish()
+ * @return ESP_OK once the broker acknowledged it, error code otherwise
+ */
+static esp_err_t mqtt_wait_puback(int msg_id)
+{
+    if (msg_id < 0)
+    {
+        return ESP_FAIL;
+    }
+    if ((xEventGroupGetBits(s_events) & MQTT_CONNECTED_BIT) == 0)
+    {
+        ESP_LOGW(TAG, "Not connected, msg %d only queued", msg_id);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_MQTT_PUBACK_TIMEOUT_MS);
+    int acked;
+    while (1)
+    {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = deadline > now ? deadline - now : 0;
+        if (xQueueReceive(s_puback_queue, &acked, wait) != pdTRUE)
+        {
+            ESP_LOGW(TAG, "No PUBACK for msg %d", msg_id);
+            return ESP_ERR_TIMEOUT;
+        }
+        if (acked == msg_id)
+        {
+            return ESP_OK;
+        }
+        if (acked == MQTT_SESSION_LOST)
+        {
+            ESP_LOGW(TAG, "Connection lost before the PUBACK of msg %d", msg_id);
+            return ESP_FAIL;
+        }
+        // PUBACK of another message (event log upload): keep waiting
+    }
+}
+
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+/**
+ * Publish the binary event log and clear the retained request
+ */
+static void mqtt_upload_event_log(esp_mqtt_client_handle_t client, const char *device_id)
+{
+    char topic[MQTT_TOPIC_LEN];
+    size_t len;
+    const evlog_ring_t *ring = evlog_get_ring(&len);
+
+    snprintf(topic, sizeof(topic), "sensors/%s/log", device_id);
+
+    int msg_id = esp_mqtt_client_publish(client, topic, (const char *)ring, len, 1, 0);
+    s_log_upload_msg_id = msg_id;
+    EVLOG2(EVLOG_MQTT_LOG_UPLOAD, msg_id, len);
+
+    // Empty retained message removes the request from the broker
+    esp_mqtt_client_publish(client, s_log_request_topic, "", 0, 1, 1);
+    s_log_upload_requested = false;
+}
+#endif
+
+esp_err_t mqtt_pub_connect(const char *device_id)
 {
     esp_mqtt_client_config_t cfg = {
         .broker.address.uri = MQTT_URI,
         .credentials.username = MQTT_USER,
         .credentials.authentication.password = MQTT_PASS,
+        .buffer.size = CONFIG_MQTT_RX_BUFFER_SIZE,
+        .buffer.out_size = MQTT_TX_BUFFER_SIZE,
     };
 
-    esp_mqtt_client_handle_t client = esp_mqtt_client_init(&cfg);
-    esp_mqtt_client_start(client);
+    snprintf(s_device_id, sizeof(s_device_id), "%s", device_id);
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+    snprintf(s_log_request_topic, sizeof(s_log_request_topic), "sensors/%s/log/request", device_id);
+    s_log_upload_requested = false;
+#endif
+#ifdef CONFIG_REMOTE_CONFIG_ENABLED
+    snprintf(s_config_topic, sizeof(s_config_topic), "sensors/%s/config", device_id);
+    s_config_len = 0;
+#endif
+
+    if (s_events == NULL)
+    {
+        s_events = xEventGroupCreateStatic(&s_events_buf);
+        s_puback_queue = xQueueCreateStatic(MQTT_PUBACK_QUEUE_LEN, sizeof(int),
+                                            s_puback_queue_storage, &s_puback_queue_buf);
+    }
+    xEventGroupClearBits(s_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT);
+    xQueueReset(s_puback_queue);
+
+    s_client = esp_mqtt_client_init(&cfg);
+    if (s_client == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create MQTT client");
+        return ESP_FAIL;
+    }
+    esp_mqtt_client_register_event(s_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    esp_mqtt_client_start(s_client);
+
+    // CONNACK, or the first failed attempt (refused, unreachable, rejected)
+    EventBits_t bits = xEventGroupWaitBits(s_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT,
+                                           pdFALSE, pdFALSE, pdMS_TO_TICKS(CONFIG_MQTT_CONNECT_TIMEOUT_MS));
+    if ((bits & MQTT_CONNECTED_BIT) == 0)
+    {
+        ESP_LOGW(TAG, "No CONNACK from %s", MQTT_URI);
+        esp_mqtt_client_stop(s_client);
+        esp_mqtt_client_destroy(s_client);
+        s_client = NULL;
+        return (bits & MQTT_DISCONNECTED_BIT) != 0 ? ESP_FAIL : ESP_ERR_TIMEOUT;
+    }
 
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    return ESP_OK;
+}
+
+esp_err_t mqtt_pub_send(meteo_measurement_t *m)
+{
+    if (s_client == NULL || m == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (m->transport == NULL)
+    {
+        m->transport = mqtt_transport.name;
+    }
+    payload_format_topic(m->device_id, s_topic, sizeof(s_topic));
+    int payload_len = payload_format_json(m, s_payload, sizeof(s_payload));
+    if (payload_len < 0 || payload_len >= (int)sizeof(s_payload))
+    {
+        ESP_LOGE(TAG, "Payload does not fit %u bytes", (unsigned)sizeof(s_payload));
+        return ESP_ERR_INVALID_SIZE;
+    }
 
-    char payload[512];
-    char topic[128];
-    int64_t ts = time(NULL);
+    ESP_LOGI(TAG, "Payload: %s", s_payload);
 
-    snprintf(topic, sizeof(topic), "sensors/%s/environment", device_id);
+    int msg_id = esp_mqtt_client_publish(s_client, s_topic, s_payload, payload_len, 1, 0);
+#ifdef CONFIG_BENCH_PUBLISH_LATENCY
+    s_bench_msg_id = msg_id;
+#endif
+    EVLOG2(EVLOG_MQTT_PUBLISHED, msg_id, payload_len);
+    esp_err_t ret = mqtt_wait_puback(msg_id);
+    if (ret == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Published to %s", s_topic);
+    }
 
-    // Replace NaN and invalid values with null for valid JSON
-    char altitude_str[32];
-    if (isnan(altitude_m) || altitude_m < -500.0f || altitude_m > 10000.0f)
+#ifdef CONFIG_EVLOG_MQTT_UPLOAD
+    if (s_log_upload_requested)
     {
-        snprintf(altitude_str, sizeof(altitude_str), "null");
+        mqtt_upload_event_log(s_client, s_device_id);
     }
-    else
+#endif
+
+    return ret;
+}
+
+esp_err_t mqtt_pub_send_batch(const meteo_measurement_t *m, size_t count)
+{
+    if (s_client == NULL || m == NULL || count == 0)
     {
-        snprintf(altitude_str, sizeof(altitude_str), "%.1f", altitude_m);
+        return ESP_ERR_INVALID_STATE;
     }
 
-    snprintf(payload, sizeof(payload),
-             "{"
-             "\"device_id\":\"%s\","
-             "\"fw\":\"%s\","
-             "\"ts_device\":%lld,"
-             "\"rssi\":%d,"
-             "\"altitude_m\":%s,"
-             "\"free_heap\":%lu,"
-             "\"dht22\":{\"temperature_c\":%.2f,\"humidity_percent\":%.2f},"
-             "\"aht20\":{\"temperature_c\":%.2f,\"humidity_percent\":%.2f},"
-             "\"bmp280\":{\"temperature_c\":%.2f,\"pressure_pa\":%.2f}"
-             "}",
-             device_id, fw, ts, rssi, altitude_str, free_heap, dht_temp, dht_rh, aht20_temp, aht20_rh, bmp_temp, bmp_press);
+    // Binary batch in the JSON buffer: far smaller than one JSON payload per sample
+    size_t len = tscodec_encode(m, count, time(NULL), (uint8_t *)s_payload, sizeof(s_payload));
+    if (len == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    snprintf(s_topic, sizeof(s_topic), "sensors/%s/batch", m[0].device_id);
 
-    ESP_LOGI(TAG, "Payload: %s", payload);
+    int msg_id = esp_mqtt_client_publish(s_client, s_topic, s_payload, (int)len, 1, 0);
+    EVLOG3(EVLOG_MQTT_BATCH_PUBLISHED, msg_id, count, len);
+    esp_err_t ret = mqtt_wait_puback(msg_id);
+    if (ret == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Published %u measurements in %u bytes to %s", (unsigned)count, (unsigned)len, s_topic);
+    }
+    return ret;
+}
 
-    esp_mqtt_client_publish(client, topic, payload, 0, 1, 0);
-    ESP_LOGI(TAG, "Published to %s", topic);
+void mqtt_pub_disconnect(void)
+{
+    if (s_client == NULL)
+    {
+        return;
+    }
 
     vTaskDelay(pdMS_TO_TICKS(1000));
-    esp_mqtt_client_stop(client);
-    esp_mqtt_client_destroy(client);
+    esp_mqtt_client_stop(s_client);
+    esp_mqtt_client_destroy(s_client);
+    s_client = NULL;
+
+#ifdef CONFIG_REMOTE_CONFIG_ENABLED
+    // MQTT task stopped: the message can no longer change under us
+    if (s_config_len != 0)
+    {
+        runtime_config_apply(s_config_msg, s_config_len);
+        s_config_len = 0;
+    }
+#endif
 }
+
+const uplink_transport_t mqtt_transport = {
+    .name = "mqtt",
+    .connect = mqtt_pub_connect,
+    .send = mqtt_pub_send,
+    .send_batch = mqtt_pub_send_batch,
+    .disconnect = mqtt_pub_disconnect,
+};
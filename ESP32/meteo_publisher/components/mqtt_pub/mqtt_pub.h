@@ -1,10 +1,42 @@
 #pragma once
 
-#include <stdint.h>
-
-void mqtt_publish_measurement(const char *device_id, const char *fw,
-                              float dht_temp, float dht_rh,
-                              float aht20_temp, float aht20_rh,
-                              float bmp_temp, float bmp_press,
-                              int8_t rssi, float altitude_m,
-                              uint32_t free_heap);
+#include "esp_err.h"
+#include "uplink.h"
+
+/**
+ * MQTT uplink: one TCP + MQTT session per wake, QoS 1 publish
+ * to sensors/<node>/environment (batches to sensors/<node>/batch)
+ */
+extern const uplink_transport_t mqtt_transport;
+
+/**
+ * Open a publish session: connect to the broker and wait for its CONNACK
+ * (CONFIG_MQTT_CONNECT_TIMEOUT_MS)
+ * @param device_id Node name used in topics
+ * @return ESP_OK when connected, ESP_ERR_TIMEOUT without CONNACK, error
+ *         code otherwise; the client is released on failure
+ */
+esp_err_t mqtt_pub_connect(const char *device_id);
+
+/**
+ * Publish one measurement in the open session
+ * @param m Measurement (m->transport is set to "mqtt" unless already set
+ *          by a forwarding gateway)
+ * @return ESP_OK once the broker acknowledged it (PUBACK within
+ *         CONFIG_MQTT_PUBACK_TIMEOUT_MS), error code otherwise
+ */
+esp_err_t mqtt_pub_send(meteo_measurement_t *m);
+
+/**
+ * Publish measurements of this node as one tscodec batch to sensors/<node>/batch
+ * @param m Measurements, oldest first
+ * @param count Number of measurements
+ * @return ESP_OK once the broker acknowledged it, ESP_ERR_INVALID_SIZE if
+ *         the batch does not fit the payload buffer, error code otherwise
+ */
+esp_err_t mqtt_pub_send_batch(const meteo_measurement_t *m, size_t count);
+
+/**
+ * Wait for outstanding acknowledgements and close the session
+ */
+void mqtt_pub_disconnect(void);
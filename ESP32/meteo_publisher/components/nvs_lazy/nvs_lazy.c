@@ -0,0 +1,43 @@
+/**
+ * @file nvs_lazy.c
+ * @brief On-demand NVS initialization
+ */
+
+#include "nvs_lazy.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include <stdbool.h>
+
+static const char *TAG = "NVS";
+
+static bool s_initialized;
+
+esp_err_t nvs_lazy_init(void)
+{
+    if (s_initialized)
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(TAG, "NVS partition needs erase (%s)", esp_err_to_name(ret));
+        ret = nvs_flash_erase();
+        if (ret == ESP_OK)
+        {
+            ret = nvs_flash_init();
+        }
+    }
+
+    if (ret == ESP_OK)
+    {
+        s_initialized = true;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "NVS init failed: %s", esp_err_to_name(ret));
+    }
+
+    return ret;
+}
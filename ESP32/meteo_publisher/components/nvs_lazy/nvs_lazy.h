@@ -0,0 +1,31 @@
+/**
+ * @file nvs_lazy.h
+ * @brief On-demand NVS initialization
+ *
+ * NVS is no longer initialized unconditionally at the top of app_main.
+ * Every module that needs it calls nvs_lazy_init() first, so wakes that
+ * never touch NVS skip the page scan entirely.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Initialize the default NVS partition if not done yet
+     *
+     * Erases and re-initializes the partition when it has no free pages or
+     * was written by a newer NVS version. Cheap after the first call.
+     *
+     * @return ESP_OK on success, error code otherwise
+     */
+    esp_err_t nvs_lazy_init(void);
+
+#ifdef __cplusplus
+}
+#endif
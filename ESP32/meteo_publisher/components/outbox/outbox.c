@@ -0,0 +1,444 @@
+/**
+ * @file outbox.c
+ * @brief Flash-backed store-and-forward queue implementation
+ */
+
+#include "outbox.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "espnow_frame.h"
+#include "evlog.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "OUTBOX";
+
+#define OUTBOX_PARTITION_LABEL "outbox"
+#define OUTBOX_PARTITION_SUBTYPE 0x40 // Custom data subtype, see partitions.csv
+
+#define SECTOR_SIZE 4096
+#define SECTOR_MAGIC 0x3158424F // "OBX1"
+#define SECTOR_HEADER_LEN 8
+
+#define RECORD_HEADER_LEN 8
+#define RECORD_FREE 0xFF  // Erased flash, end of the written part of a sector
+#define RECORD_VALID 0xFE // Written, not sent
+#define RECORD_SENT 0xFC  // Sent (bits cleared in place, no erase needed)
+
+#define STATE_MAGIC 0x4F425858 // "OBXX"
+
+/**
+ * First bytes of every sector
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t gen; ///< Incremented for every sector opened; orders the ring
+} sector_header_t;
+
+/**
+ * Header of a record, followed by an ESP-NOW DATA frame padded to 4 bytes
+ */
+typedef struct
+{
+    uint8_t state; ///< RECORD_*
+    int8_t rssi;   ///< Not part of the frame
+    uint16_t len;  ///< Frame length
+    uint32_t seq;  ///< Measurement sequence number
+} record_header_t;
+
+/**
+ * Log positions and counters, kept in RTC slow memory across deep sleep
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t next_seq;
+    uint32_t head_gen; ///< Generation of the head sector, 0 while the log is empty
+    uint32_t pending;
+    uint32_t dropped;
+    uint16_t head_sector; ///< Where the next record is appended
+    uint16_t head_pos;
+    uint16_t tail_sector; ///< Oldest record not sent (if pending != 0)
+    uint16_t tail_pos;
+} outbox_state_t;
+
+RTC_DATA_ATTR static outbox_state_t s_state;
+
+static const esp_partition_t *s_part;
+static uint16_t s_sectors;
+
+// Record being written or replayed
+static uint8_t s_record[RECORD_HEADER_LEN + ESPNOW_FRAME_MAX_LEN + 3];
+static espnow_frame_t s_frame;
+
+static uint32_t record_size(uint16_t len)
+{
+    return RECORD_HEADER_LEN + ((len + 3u) & ~3u);
+}
+
+static uint32_t offset_of(uint16_t sector, uint16_t pos)
+{
+    return (uint32_t)sector * SECTOR_SIZE + pos;
+}
+
+/**
+ * Read the record header at a position
+ * @return false at the end of the written part of the sector (free or torn)
+ */
+static bool read_record(uint16_t sector, uint16_t pos, record_header_t *h)
+{
+    if (pos + RECORD_HEADER_LEN > SECTOR_SIZE ||
+        esp_partition_read(s_part, offset_of(sector, pos), h, sizeof(*h)) != ESP_OK)
+    {
+        return false;
+    }
+    return (h->state == RECORD_VALID || h->state == RECORD_SENT) &&
+           h->len > 0 && h->len <= ESPNOW_FRAME_MAX_LEN &&
+           pos + record_size(h->len) <= SECTOR_SIZE;
+}
+
+static bool read_sector_header(uint16_t sector, sector_header_t *h)
+{
+    return esp_partition_read(s_part, offset_of(sector, 0), h, sizeof(*h)) == ESP_OK &&
+           h->magic == SECTOR_MAGIC;
+}
+
+/**
+ * Move a position to the next record not sent, from the position itself on
+ * @return false if there is none up to the head
+ */
+static bool find_unsent(uint16_t *sector, uint16_t *pos, record_header_t *h)
+{
+    for (;;)
+    {
+        while (read_record(*sector, *pos, h))
+        {
+            if (h->state == RECORD_VALID)
+            {
+                return true;
+            }
+            *pos += record_size(h->len);
+        }
+        if (*sector == s_state.head_sector)
+        {
+            return false;
+        }
+        *sector = (*sector + 1) % s_sectors;
+        *pos = SECTOR_HEADER_LEN;
+    }
+}
+
+/**
+ * Rebuild the RTC state from the partition after a power-on
+ */
+static void scan(void)
+{
+    memset(&s_state, 0, sizeof(s_state));
+    s_state.magic = STATE_MAGIC;
+
+    // The newest sector holds the head
+    sector_header_t sh;
+    for (uint16_t i = 0; i < s_sectors; i++)
+    {
+        if (read_sector_header(i, &sh) && sh.gen > s_state.head_gen)
+        {
+            s_state.head_gen = sh.gen;
+            s_state.head_sector = i;
+        }
+    }
+
+    uint32_t max_seq = 0;
+    if (s_state.head_gen != 0)
+    {
+        // Older sectors precede it in the ring with consecutive generations
+        uint16_t sector = s_state.head_sector;
+        uint32_t gen = s_state.head_gen;
+        for (uint16_t i = 1; i < s_sectors; i++)
+        {
+            uint16_t prev = (sector + s_sectors - 1) % s_sectors;
+            if (!read_sector_header(prev, &sh) || sh.gen != gen - 1)
+            {
+                break;
+            }
+            sector = prev;
+            gen--;
+        }
+
+        for (;;)
+        {
+            uint16_t pos = SECTOR_HEADER_LEN;
+            record_header_t h;
+            while (read_record(sector, pos, &h))
+            {
+                if (h.seq > max_seq)
+                {
+                    max_seq = h.seq;
+                }
+                if (h.state == RECORD_VALID)
+                {
+                    if (s_state.pending == 0)
+                    {
+                        s_state.tail_sector = sector;
+                        s_state.tail_pos = pos;
+                    }
+                    s_state.pending++;
+                }
+                pos += record_size(h.len);
+            }
+
+            if (sector == s_state.head_sector)
+            {
+                // Append after the last record, unless a torn write left garbage there
+                uint8_t next[RECORD_HEADER_LEN];
+                s_state.head_pos = pos;
+                if (pos + RECORD_HEADER_LEN <= SECTOR_SIZE &&
+                    esp_partition_read(s_part, offset_of(sector, pos), next, sizeof(next)) == ESP_OK)
+                {
+                    for (size_t i = 0; i < sizeof(next); i++)
+                    {
+                        if (next[i] != 0xFF)
+                        {
+                            s_state.head_pos = SECTOR_SIZE;
+                            break;
+                        }
+                    }
+                }
+                break;
+            }
+            sector = (sector + 1) % s_sectors;
+        }
+    }
+
+    s_state.next_seq = max_seq + 1;
+    ESP_LOGI(TAG, "Scanned %u sectors: %lu pending, next seq %lu", s_sectors,
+             (unsigned long)s_state.pending, (unsigned long)s_state.next_seq);
+}
+
+/**
+ * Find the partition and load the state (scan after power-on)
+ */
+static bool outbox_ready(void)
+{
+    if (s_part != NULL)
+    {
+        return true;
+    }
+
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                      (esp_partition_subtype_t)OUTBOX_PARTITION_SUBTYPE,
+                                      OUTBOX_PARTITION_LABEL);
+    if (s_part == NULL || s_part->size < 2 * SECTOR_SIZE || s_part->encrypted)
+    {
+        // Records are updated in place, which encrypted partitions do not allow
+        ESP_LOGE(TAG, "No usable \"%s\" partition", OUTBOX_PARTITION_LABEL);
+        s_part = NULL;
+        return false;
+    }
+    s_sectors = s_part->size / SECTOR_SIZE;
+
+    if (s_state.magic != STATE_MAGIC)
+    {
+        scan();
+    }
+    return true;
+}
+
+/**
+ * Drop the records not sent in a sector about to be erased (ring full)
+ */
+static void drop_sector(uint16_t sector)
+{
+    uint32_t dropped = 0;
+    uint16_t pos = s_state.tail_pos;
+    record_header_t h;
+    while (read_record(sector, pos, &h))
+    {
+        if (h.state == RECORD_VALID)
+        {
+            dropped++;
+        }
+        pos += record_size(h.len);
+    }
+
+    s_state.dropped += dropped;
+    s_state.pending = dropped < s_state.pending ? s_state.pending - dropped : 0;
+    s_state.tail_sector = (sector + 1) % s_sectors;
+    s_state.tail_pos = SECTOR_HEADER_LEN;
+    ESP_LOGW(TAG, "Outbox full, dropped %lu oldest measurements", (unsigned long)dropped);
+}
+
+/**
+ * Erase the next sector of the ring and make it the head
+ */
+static esp_err_t open_sector(void)
+{
+    uint16_t sector = s_state.head_gen == 0 ? 0 : (s_state.head_sector + 1) % s_sectors;
+    if (s_state.pending != 0 && s_state.tail_sector == sector)
+    {
+        drop_sector(sector);
+    }
+
+    // Sectors behind the tail only hold sent records
+    esp_err_t ret = esp_partition_erase_range(s_part, offset_of(sector, 0), SECTOR_SIZE);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    sector_header_t sh = {.magic = SECTOR_MAGIC, .gen = s_state.head_gen + 1};
+    ret = esp_partition_write(s_part, offset_of(sector, 0), &sh, sizeof(sh));
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    s_state.head_gen = sh.gen;
+    s_state.head_sector = sector;
+    s_state.head_pos = SECTOR_HEADER_LEN;
+    return ESP_OK;
+}
+
+uint32_t outbox_next_seq(void)
+{
+    if (s_state.magic != STATE_MAGIC && !outbox_ready())
+    {
+        // No partition: numbering still survives deep sleep
+        memset(&s_state, 0, sizeof(s_state));
+        s_state.magic = STATE_MAGIC;
+        s_state.next_seq = 1;
+    }
+
+    uint32_t seq = s_state.next_seq++;
+    if (s_state.next_seq == 0)
+    {
+        s_state.next_seq = 1;
+    }
+    return seq;
+}
+
+uint32_t outbox_pending(void)
+{
+    return s_state.magic == STATE_MAGIC ? s_state.pending : 0;
+}
+
+uint32_t outbox_dropped(void)
+{
+    return s_state.magic == STATE_MAGIC ? s_state.dropped : 0;
+}
+
+esp_err_t outbox_store(const meteo_measurement_t *m)
+{
+    if (m == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!outbox_ready())
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t len = espnow_frame_encode_data(m, (uint16_t)m->seq, &s_record[RECORD_HEADER_LEN],
+                                          ESPNOW_FRAME_MAX_LEN);
+    if (len == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t size = record_size(len);
+    if (s_state.head_gen == 0 || s_state.head_pos + size > SECTOR_SIZE)
+    {
+        esp_err_t ret = open_sector();
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Sector erase failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    record_header_t h = {.state = RECORD_VALID, .rssi = m->rssi, .len = (uint16_t)len, .seq = m->seq};
+    memcpy(s_record, &h, sizeof(h));
+    memset(&s_record[RECORD_HEADER_LEN + len], 0xFF, size - RECORD_HEADER_LEN - len);
+
+    esp_err_t ret = esp_partition_write(s_part, offset_of(s_state.head_sector, s_state.head_pos), s_record, size);
+    if (ret != ESP_OK)
+    {
+        // Skip the rest of the sector, the write may have left partial data
+        s_state.head_pos = SECTOR_SIZE;
+        ESP_LOGE(TAG, "Write failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (s_state.pending == 0)
+    {
+        s_state.tail_sector = s_state.head_sector;
+        s_state.tail_pos = s_state.head_pos;
+    }
+    s_state.head_pos += size;
+    s_state.pending++;
+
+    EVLOG3(EVLOG_OUTBOX_STORED, m->seq, s_state.pending, s_state.dropped);
+    ESP_LOGI(TAG, "Stored seq %lu (%u bytes), %lu pending", (unsigned long)m->seq, (unsigned)len,
+             (unsigned long)s_state.pending);
+    return ESP_OK;
+}
+
+size_t outbox_replay(const uplink_transport_t *uplink, size_t max, uint32_t interval_ms)
+{
+    if (uplink == NULL || outbox_pending() == 0 || !outbox_ready())
+    {
+        return 0;
+    }
+
+    size_t sent = 0;
+    time_t now = time(NULL);
+    while (sent < max && s_state.pending > 0)
+    {
+        record_header_t h;
+        if (!find_unsent(&s_state.tail_sector, &s_state.tail_pos, &h))
+        {
+            s_state.pending = 0; // Counter out of step with the flash
+            break;
+        }
+
+        uint32_t offset = offset_of(s_state.tail_sector, s_state.tail_pos);
+        bool valid = esp_partition_read(s_part, offset + RECORD_HEADER_LEN, s_record, h.len) == ESP_OK &&
+                     espnow_frame_decode(s_record, h.len, &s_frame);
+        if (valid)
+        {
+            meteo_measurement_t *m = &s_frame.measurement;
+            m->seq = h.seq;
+            m->rssi = h.rssi;
+            m->transport = NULL;
+            m->sample_age_s = now > m->ts_device ? (uint32_t)(now - m->ts_device) : 0;
+
+            if (sent > 0 && interval_ms > 0)
+            {
+                vTaskDelay(pdMS_TO_TICKS(interval_ms));
+            }
+            if (uplink->send(m) != ESP_OK)
+            {
+                break; // Not acknowledged: stays pending
+            }
+            sent++;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Corrupt record seq %lu skipped", (unsigned long)h.seq);
+            s_state.dropped++;
+        }
+
+        uint8_t state = RECORD_SENT;
+        esp_partition_write(s_part, offset, &state, sizeof(state));
+        s_state.tail_pos += record_size(h.len);
+        s_state.pending--;
+    }
+
+    EVLOG3(EVLOG_OUTBOX_REPLAYED, sent, s_state.pending, s_state.dropped);
+    ESP_LOGI(TAG, "Replayed %u measurements, %lu pending", (unsigned)sent, (unsigned long)s_state.pending);
+    return sent;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file outbox.h
+ * @brief Flash-backed store-and-forward queue for measurements
+ *
+ * Measurements that could not be published are appended to a log in the
+ * "outbox" data partition and replayed, oldest first, in the next session
+ * that connects. The log is a ring of flash sectors written in order, so
+ * every sector is erased equally often. Replay is strictly in order: the
+ * sent records always form a prefix of the log, and sectors behind it are
+ * reclaimed by erasing them when the ring comes round. When an outage
+ * fills the whole ring, the oldest sector is dropped.
+ *
+ * Records are ESP-NOW DATA frames (versioned, CRC-checked, compact) behind
+ * a small header with the record state and the measurement sequence
+ * number. Positions and counters are cached in RTC memory; the partition
+ * is only scanned after a power-on. Wakes with an empty outbox do not
+ * touch the flash.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "measurement.h"
+#include "uplink.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Sequence number for a new measurement of this node
+     *
+     * Increments on every call and survives deep sleep and, through the
+     * records in flash, power cycles. Never returns 0.
+     */
+    uint32_t outbox_next_seq(void);
+
+    /**
+     * Append a measurement that could not be published
+     *
+     * @param m Measurement with its sequence number set
+     * @return ESP_OK on success, error code otherwise
+     */
+    esp_err_t outbox_store(const meteo_measurement_t *m);
+
+    /**
+     * Number of stored measurements not sent yet
+     */
+    uint32_t outbox_pending(void);
+
+    /**
+     * Measurements lost to a full outbox since power-on
+     */
+    uint32_t outbox_dropped(void);
+
+    /**
+     * Send stored measurements in the open session, oldest first
+     *
+     * A record is marked sent only when uplink->send() returns ESP_OK,
+     * which for MQTT means its PUBACK arrived. Stops at the first send
+     * error; that measurement and the rest are kept for the next session.
+     *
+     * @param uplink Transport with an open session
+     * @param max Maximum number of measurements to send
+     * @param interval_ms Pause between two measurements (limits the rate)
+     * @return Number of measurements sent
+     */
+    size_t outbox_replay(const uplink_transport_t *uplink, size_t max, uint32_t interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
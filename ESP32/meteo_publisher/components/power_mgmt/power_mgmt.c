@@ -0,0 +1,138 @@
+/**
+ * @file power_mgmt.c
+ * @brief Clock scaling and light sleep implementation
+ */
+
+#include "power_mgmt.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "evlog.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef CONFIG_POWER_MGMT_ENABLED
+
+static const char *TAG = "PM";
+
+#ifdef CONFIG_POWER_MGMT_LIGHT_SLEEP
+#define LIGHT_SLEEP true
+#else
+#define LIGHT_SLEEP false
+#endif
+
+/**
+ * One lock and how long it was held this wake
+ */
+typedef struct
+{
+    const char *name;
+    esp_pm_lock_type_t type;
+    esp_pm_lock_handle_t handle;
+    uint32_t depth;
+    int64_t since_us;
+    int64_t held_us;
+} lock_entry_t;
+
+static lock_entry_t s_locks[POWER_LOCK_COUNT] = {
+    [POWER_LOCK_I2C] = {.name = "i2c", .type = ESP_PM_APB_FREQ_MAX},
+    [POWER_LOCK_RADIO] = {.name = "radio", .type = ESP_PM_CPU_FREQ_MAX},
+    [POWER_LOCK_BITBANG] = {.name = "bitbang", .type = ESP_PM_CPU_FREQ_MAX},
+};
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t power_mgmt_init(void)
+{
+    esp_pm_config_t config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_POWER_MGMT_MIN_FREQ_MHZ,
+        .light_sleep_enable = LIGHT_SLEEP,
+    };
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < POWER_LOCK_COUNT; i++)
+    {
+        err = esp_pm_lock_create(s_locks[i].type, 0, s_locks[i].name, &s_locks[i].handle);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Cannot create lock %s: %s", s_locks[i].name, esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "CPU %d-%d MHz, light sleep %s", CONFIG_POWER_MGMT_MIN_FREQ_MHZ,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, LIGHT_SLEEP ? "on" : "off");
+    return ESP_OK;
+}
+
+void power_lock_acquire(power_lock_t lock)
+{
+    lock_entry_t *entry = &s_locks[lock];
+    if (entry->handle == NULL)
+    {
+        return; // Not initialized (gateway) or creation failed
+    }
+
+    esp_pm_lock_acquire(entry->handle);
+    portENTER_CRITICAL(&s_mux);
+    if (entry->depth++ == 0)
+    {
+        entry->since_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void power_lock_release(power_lock_t lock)
+{
+    lock_entry_t *entry = &s_locks[lock];
+    if (entry->handle == NULL || entry->depth == 0)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    if (--entry->depth == 0)
+    {
+        entry->held_us += esp_timer_get_time() - entry->since_us;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    esp_pm_lock_release(entry->handle);
+}
+
+void power_mgmt_report(void)
+{
+    uint32_t held_ms[POWER_LOCK_COUNT];
+    for (int i = 0; i < POWER_LOCK_COUNT; i++)
+    {
+        held_ms[i] = (uint32_t)(s_locks[i].held_us / 1000);
+    }
+
+    EVLOG3(EVLOG_POWER_LOCKS, held_ms[POWER_LOCK_I2C], held_ms[POWER_LOCK_RADIO], held_ms[POWER_LOCK_BITBANG]);
+    ESP_LOGI(TAG, "Full clock held: i2c %lu ms, radio %lu ms, bitbang %lu ms of %lu ms awake",
+             (unsigned long)held_ms[POWER_LOCK_I2C], (unsigned long)held_ms[POWER_LOCK_RADIO],
+             (unsigned long)held_ms[POWER_LOCK_BITBANG], (unsigned long)(esp_timer_get_time() / 1000));
+#ifdef CONFIG_PM_PROFILING
+    // Time per power mode (including light sleep) and per lock since boot
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+#else
+
+esp_err_t power_mgmt_init(void)
+{
+    return ESP_OK;
+}
+
+void power_mgmt_report(void)
+{
+}
+
+#endif
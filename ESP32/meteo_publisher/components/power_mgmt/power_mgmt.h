@@ -0,0 +1,78 @@
+/**
+ * @file power_mgmt.h
+ * @brief Clock scaling and automatic light sleep during the waits of a wake
+ *
+ * Most of a wake is spent in vTaskDelay: BMP280 and AHT20 conversions, LED
+ * blinks, MQTT waits. With CONFIG_POWER_MGMT_ENABLED the CPU runs at
+ * CONFIG_POWER_MGMT_MIN_FREQ_MHZ while it waits and, with tickless idle,
+ * the chip light-sleeps until the next task is due.
+ *
+ * Activities that need the full clock hold a lock for as long as they
+ * run: single I2C transfers (not the conversion wait between them), the
+ * DHT22 bit-banging, and the radio from Wi-Fi connect to the end of the
+ * uplink session. Held times are reported before deep sleep.
+ *
+ * Without CONFIG_POWER_MGMT_ENABLED the lock functions compile to nothing.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        POWER_LOCK_I2C = 0, ///< APB clock at maximum (I2C timing), no light sleep
+        POWER_LOCK_RADIO,   ///< CPU at maximum (TLS, lwIP, Wi-Fi events), no light sleep
+        POWER_LOCK_BITBANG, ///< CPU at maximum (busy-wait timing of the DHT22)
+        POWER_LOCK_COUNT,
+    } power_lock_t;
+
+    /**
+     * Configure frequency scaling and light sleep, create the locks
+     *
+     * Call once at the start of a sensor node wake. Not for the ESP-NOW
+     * gateway, which must keep its radio listening.
+     *
+     * @return ESP_OK (also when disabled), error code of esp_pm otherwise
+     */
+    esp_err_t power_mgmt_init(void);
+
+    /**
+     * Log and record (EVLOG_POWER_LOCKS) how long each lock was held this wake
+     *
+     * With CONFIG_PM_PROFILING also prints the time spent in each
+     * power mode, including light sleep.
+     */
+    void power_mgmt_report(void);
+
+#ifdef CONFIG_POWER_MGMT_ENABLED
+    /**
+     * Hold the full clock for an activity; nests
+     */
+    void power_lock_acquire(power_lock_t lock);
+
+    /**
+     * Release a lock taken with power_lock_acquire()
+     */
+    void power_lock_release(power_lock_t lock);
+#else
+    static inline void power_lock_acquire(power_lock_t lock)
+    {
+        (void)lock;
+    }
+
+    static inline void power_lock_release(power_lock_t lock)
+    {
+        (void)lock;
+    }
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,149 @@
+/**
+ * @file rtc_store.c
+ * @brief RTC state record implementation
+ */
+
+#include "rtc_store.h"
+#include "esp_app_desc.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "evlog.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "RTC_STORE";
+
+// Records opened in this boot; the main firmware has fewer than ten
+#define MAX_RECORDS 16
+
+/**
+ * Why a record was not kept (EVLOG_RTC_STATE_RESET)
+ */
+typedef enum
+{
+    RESET_NONE = 0,
+    RESET_BUILD = 1,  ///< Written by another firmware
+    RESET_LAYOUT = 2, ///< Version or size changed
+    RESET_CRC = 3,    ///< Contents corrupted or not sealed before a reset
+} reset_reason_t;
+
+typedef struct
+{
+    rtc_store_hdr_t *hdr;
+    const void *data;
+} record_t;
+
+static record_t s_records[MAX_RECORDS];
+static size_t s_count;
+
+static uint32_t record_crc(const rtc_store_hdr_t *hdr, const void *data)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(rtc_store_hdr_t, crc));
+    return esp_rom_crc32_le(crc, (const uint8_t *)data, hdr->size);
+}
+
+/**
+ * Tags are written as hex with the first character in the top byte
+ */
+static void tag_name(uint32_t tag, char name[5])
+{
+    for (int i = 0; i < 4; i++)
+    {
+        name[i] = (char)(tag >> (24 - 8 * i));
+    }
+    name[4] = '\0';
+}
+
+uint32_t rtc_store_build_id(void)
+{
+    const esp_app_desc_t *app = esp_app_get_description();
+    uint32_t id;
+    memcpy(&id, app->app_elf_sha256, sizeof(id));
+    return id;
+}
+
+bool rtc_store_open(rtc_store_hdr_t *hdr, void *data, size_t size, uint32_t tag, uint16_t version)
+{
+    for (size_t i = 0; i < s_count; i++)
+    {
+        if (s_records[i].hdr == hdr)
+        {
+            return true;
+        }
+    }
+
+    uint32_t build = rtc_store_build_id();
+    reset_reason_t reason = RESET_NONE;
+    bool kept = false;
+    if (hdr->tag == tag)
+    {
+        if (hdr->build != build)
+        {
+            reason = RESET_BUILD;
+        }
+        else if (hdr->version != version || hdr->size != size)
+        {
+            reason = RESET_LAYOUT;
+        }
+        else if (hdr->crc != record_crc(hdr, data))
+        {
+            reason = RESET_CRC;
+        }
+        else
+        {
+            kept = true;
+        }
+    }
+
+    char name[5];
+    tag_name(tag, name);
+    if (!kept)
+    {
+        // Power-on (no tag) is the normal case and not logged
+        if (reason == RESET_CRC)
+        {
+            ESP_LOGW(TAG, "%s: CRC mismatch, state reset", name);
+        }
+        else if (reason != RESET_NONE)
+        {
+            ESP_LOGI(TAG, "%s: %s changed, state reset", name,
+                     reason == RESET_BUILD ? "firmware" : "layout");
+        }
+        if (reason != RESET_NONE)
+        {
+            EVLOG2(EVLOG_RTC_STATE_RESET, tag, reason);
+        }
+
+        memset(data, 0, size);
+        hdr->tag = tag;
+        hdr->build = build;
+        hdr->version = version;
+        hdr->size = (uint16_t)size;
+        hdr->crc = record_crc(hdr, data);
+    }
+
+    if (s_count < MAX_RECORDS)
+    {
+        s_records[s_count].hdr = hdr;
+        s_records[s_count].data = data;
+        s_count++;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "%s: more than %d records, changes are not kept", name, MAX_RECORDS);
+    }
+    return kept;
+}
+
+void rtc_store_commit(rtc_store_hdr_t *hdr, const void *data)
+{
+    hdr->crc = record_crc(hdr, data);
+}
+
+void rtc_store_commit_all(void)
+{
+    for (size_t i = 0; i < s_count; i++)
+    {
+        rtc_store_commit(s_records[i].hdr, s_records[i].data);
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file rtc_store.h
+ * @brief Typed state records in RTC memory with version, build and CRC check
+ *
+ * A record is a header followed by the state struct of one module, declared
+ * as a static RTC_DATA_ATTR variable (kept across deep sleep) or
+ * RTC_NOINIT_ATTR (also kept across software resets). rtc_store_open()
+ * checks it once per boot: tag, layout version, size, the firmware that
+ * wrote it and the CRC. On any mismatch (power-on, corruption, a firmware
+ * update, a changed layout) the state is zeroed and the caller sets its
+ * defaults. After that the module works on the struct directly.
+ *
+ * A module seals its record with rtc_store_commit() after each change, so
+ * the record stays valid if the wake ends in a panic, a watchdog reset or
+ * esp_restart() instead of deep sleep. A reset between a change and its
+ * commit leaves a stale CRC and the record starts over, like after
+ * power-on. rtc_store_commit_all() before deep sleep seals any record
+ * changed without a commit. No heap allocation.
+ *
+ * C components use RTC_STORE_RECORD() and RTC_STORE_OPEN(), C++ code the
+ * RtcState template in main/RtcState.hpp.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Record header, checked by rtc_store_open()
+     */
+    typedef struct
+    {
+        uint32_t tag;     ///< Record identifier, four ASCII characters
+        uint32_t build;   ///< rtc_store_build_id() of the firmware that wrote it
+        uint16_t version; ///< Layout version of the state struct
+        uint16_t size;    ///< Size of the state struct
+        uint32_t crc;     ///< CRC-32 of the fields above and the state
+    } rtc_store_hdr_t;
+
+/**
+ * Record type holding a state struct, e.g.
+ *   RTC_DATA_ATTR static RTC_STORE_RECORD(time_state_t) s_state;
+ */
+#define RTC_STORE_RECORD(type) \
+    struct                     \
+    {                          \
+        rtc_store_hdr_t hdr;   \
+        type data;             \
+    }
+
+/**
+ * Open a record declared with RTC_STORE_RECORD()
+ */
+#define RTC_STORE_OPEN(record, tag, version) \
+    rtc_store_open(&(record).hdr, &(record).data, sizeof((record).data), (tag), (version))
+
+/**
+ * Seal a record declared with RTC_STORE_RECORD() after a change
+ */
+#define RTC_STORE_COMMIT(record) rtc_store_commit(&(record).hdr, &(record).data)
+
+    /**
+     * Check a record and register it for rtc_store_commit_all()
+     *
+     * Further calls in the same boot return true at once. The state struct
+     * must be smaller than 64 KB.
+     *
+     * @param hdr Record header
+     * @param data State struct following the header
+     * @param size Size of the state struct
+     * @param tag Record identifier
+     * @param version Layout version; increment when the struct changes
+     * @return true if the state was kept, false if it was zeroed
+     */
+    bool rtc_store_open(rtc_store_hdr_t *hdr, void *data, size_t size, uint32_t tag, uint16_t version);
+
+    /**
+     * Seal one record after a change: CRC over the header and the state
+     * (the size recorded by rtc_store_open())
+     *
+     * @param hdr Record header
+     * @param data State struct following the header
+     */
+    void rtc_store_commit(rtc_store_hdr_t *hdr, const void *data);
+
+    /**
+     * Seal all records opened in this boot; call right before deep sleep
+     */
+    void rtc_store_commit_all(void);
+
+    /**
+     * Identifier of the running firmware (from the ELF SHA-256)
+     */
+    uint32_t rtc_store_build_id(void);
+
+#ifdef __cplusplus
+}
+#endif
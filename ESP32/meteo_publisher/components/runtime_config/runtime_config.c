@@ -0,0 +1,289 @@
+/**
+ * @file runtime_config.c
+ * @brief Runtime configuration implementation
+ */
+
+#include "runtime_config.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include "measurement.h"
+#include "nvs.h"
+#include "nvs_lazy.h"
+#include "rtc_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CONFIG";
+
+#define STATE_TAG 0x47464352 // "RCFG"
+#define STATE_VERSION 1
+
+static const char *NVS_NAMESPACE = "config";
+static const char *NVS_KEY = "runtime";
+
+#define INTERVAL_MIN_MS 1000
+#define INTERVAL_MAX_MS 86400000
+#define THRESHOLD_MIN_MV 2500
+#define THRESHOLD_MAX_MV 5000
+
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+#define BATCH_CAPACITY CONFIG_POWER_BATCH_SIZE
+#else
+#define BATCH_CAPACITY 1
+#endif
+
+// Kept in RTC slow memory across deep sleep
+RTC_DATA_ATTR static RTC_STORE_RECORD(runtime_config_t) s_state;
+
+static void set_defaults(runtime_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->interval_ms = CONFIG_PUBLISH_INTERVAL;
+    config->bmp_profile = MEASUREMENT_PROFILE_UNKNOWN;
+    config->batch_size = BATCH_CAPACITY;
+    config->led = true;
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+    config->saver_mv = CONFIG_POWER_SAVER_MV;
+    config->low_mv = CONFIG_POWER_LOW_MV;
+    config->hibernate_mv = CONFIG_POWER_HIBERNATE_MV;
+#endif
+}
+
+/**
+ * Configuration stored by an earlier apply; defaults if none or if it was
+ * written by a firmware with a different layout
+ */
+static void load_persistent(runtime_config_t *config)
+{
+    set_defaults(config);
+    if (nvs_lazy_init() != ESP_OK)
+    {
+        return;
+    }
+
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // Never written
+    }
+    runtime_config_t stored;
+    size_t len = sizeof(stored);
+    if (nvs_get_blob(nvs, NVS_KEY, &stored, &len) == ESP_OK && len == sizeof(stored))
+    {
+        *config = stored;
+    }
+    nvs_close(nvs);
+}
+
+const runtime_config_t *runtime_config_get(void)
+{
+    if (!RTC_STORE_OPEN(s_state, STATE_TAG, STATE_VERSION))
+    {
+        load_persistent(&s_state.data);
+        RTC_STORE_COMMIT(s_state);
+        ESP_LOGI(TAG, "Version %lu, interval %lu ms", (unsigned long)s_state.data.version,
+                 (unsigned long)s_state.data.interval_ms);
+    }
+    return &s_state.data;
+}
+
+/**
+ * Start of the value of a top-level key, NULL if the key is absent
+ */
+static const char *find_value(const char *json, const char *key)
+{
+    char quoted[24];
+    snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+
+    const char *p = strstr(json, quoted);
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    p += strlen(quoted);
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    {
+        p++;
+    }
+    if (*p != ':')
+    {
+        return NULL;
+    }
+    p++;
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Integer value of a key within [min, max]
+ * @return false if present but not a number in range
+ */
+static bool get_uint(const char *json, const char *key, uint32_t min, uint32_t max, uint32_t *value)
+{
+    const char *p = find_value(json, key);
+    if (p == NULL)
+    {
+        return true;
+    }
+    char *end;
+    unsigned long v = strtoul(p, &end, 10);
+    if (end == p || *p == '-' || v < min || v > max)
+    {
+        ESP_LOGW(TAG, "Invalid %s", key);
+        return false;
+    }
+    *value = (uint32_t)v;
+    return true;
+}
+
+static bool get_bool(const char *json, const char *key, bool *value)
+{
+    const char *p = find_value(json, key);
+    if (p == NULL)
+    {
+        return true;
+    }
+    if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0)
+    {
+        *value = *p == 't';
+        return true;
+    }
+    ESP_LOGW(TAG, "Invalid %s", key);
+    return false;
+}
+
+/**
+ * BMP280 profile: "auto" or a measurement_profile_name()
+ */
+static bool get_profile(const char *json, const char *key, uint8_t *profile)
+{
+    const char *p = find_value(json, key);
+    if (p == NULL)
+    {
+        return true;
+    }
+    if (strncmp(p, "\"auto\"", 6) == 0)
+    {
+        *profile = MEASUREMENT_PROFILE_UNKNOWN;
+        return true;
+    }
+    for (uint8_t candidate = MEASUREMENT_PROFILE_LOW; candidate <= MEASUREMENT_PROFILE_ULTRA; candidate++)
+    {
+        const char *name = measurement_profile_name(candidate);
+        size_t len = strlen(name);
+        if (*p == '"' && strncmp(p + 1, name, len) == 0 && p[len + 1] == '"')
+        {
+            *profile = candidate;
+            return true;
+        }
+    }
+    ESP_LOGW(TAG, "Invalid %s", key);
+    return false;
+}
+
+/**
+ * Parse a complete configuration message
+ * @return false if a value is invalid
+ */
+static bool parse(const char *json, runtime_config_t *config)
+{
+    uint32_t version = 0, interval_ms = CONFIG_PUBLISH_INTERVAL, batch = BATCH_CAPACITY;
+    uint32_t saver_mv = config->saver_mv, low_mv = config->low_mv, hibernate_mv = config->hibernate_mv;
+
+    if (!get_uint(json, "ver", 1, UINT32_MAX, &version) ||
+        !get_uint(json, "interval_ms", INTERVAL_MIN_MS, INTERVAL_MAX_MS, &interval_ms) ||
+        !get_uint(json, "batch", 1, BATCH_CAPACITY, &batch) ||
+        !get_profile(json, "bmp", &config->bmp_profile) ||
+        !get_bool(json, "led", &config->led))
+    {
+        return false;
+    }
+
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+    if (!get_uint(json, "saver_mv", THRESHOLD_MIN_MV, THRESHOLD_MAX_MV, &saver_mv) ||
+        !get_uint(json, "low_mv", THRESHOLD_MIN_MV, THRESHOLD_MAX_MV, &low_mv) ||
+        !get_uint(json, "hibernate_mv", THRESHOLD_MIN_MV, THRESHOLD_MAX_MV, &hibernate_mv))
+    {
+        return false;
+    }
+    if (!(saver_mv > low_mv && low_mv > hibernate_mv))
+    {
+        ESP_LOGW(TAG, "Thresholds must fall: saver %lu, low %lu, hibernate %lu mV",
+                 (unsigned long)saver_mv, (unsigned long)low_mv, (unsigned long)hibernate_mv);
+        return false;
+    }
+#endif
+
+    config->version = version;
+    config->interval_ms = interval_ms;
+    config->batch_size = (uint8_t)batch;
+    config->saver_mv = (uint16_t)saver_mv;
+    config->low_mv = (uint16_t)low_mv;
+    config->hibernate_mv = (uint16_t)hibernate_mv;
+    return true;
+}
+
+esp_err_t runtime_config_apply(const char *msg, size_t len)
+{
+    static char json[RUNTIME_CONFIG_MSG_MAX_LEN + 1];
+
+    if (msg == NULL || len == 0 || len > RUNTIME_CONFIG_MSG_MAX_LEN)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(json, msg, len);
+    json[len] = '\0';
+
+    // The retained message arrives on every wake: compare before parsing it all
+    uint32_t version = 0;
+    get_uint(json, "ver", 1, UINT32_MAX, &version);
+    if (version != 0 && version == runtime_config_get()->version)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    runtime_config_t config;
+    set_defaults(&config);
+    if (version == 0 || !parse(json, &config))
+    {
+        EVLOG1(EVLOG_CONFIG_REJECTED, version);
+        ESP_LOGW(TAG, "Configuration %lu rejected", (unsigned long)version);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_lazy_init();
+    if (err == ESP_OK)
+    {
+        err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs, NVS_KEY, &config, sizeof(config));
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        // Not cached either: RTC and NVS must not disagree after a power cycle
+        ESP_LOGE(TAG, "Cannot store configuration %lu: %s", (unsigned long)version, esp_err_to_name(err));
+        return err;
+    }
+
+    s_state.data = config;
+    RTC_STORE_COMMIT(s_state);
+    EVLOG3(EVLOG_CONFIG_APPLIED, config.version, config.interval_ms, config.bmp_profile);
+    ESP_LOGI(TAG, "Configuration %lu applied: interval %lu ms, bmp %s, batch %u, led %d",
+             (unsigned long)config.version, (unsigned long)config.interval_ms,
+             config.bmp_profile != MEASUREMENT_PROFILE_UNKNOWN ? measurement_profile_name(config.bmp_profile) : "auto",
+             config.batch_size, config.led);
+    return ESP_OK;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file runtime_config.h
+ * @brief Settings the backend can change without reflashing
+ *
+ * Publish interval, BMP280 profile, low-tier batch size, battery tier
+ * thresholds and LED signalling start at their Kconfig values. A flat JSON
+ * message retained on sensors/<node>/config replaces them, e.g.
+ *
+ *   {"ver":3,"interval_ms":300000,"bmp":"high","batch":6,"led":false}
+ *
+ * Keys left out take the Kconfig value, so every message is a complete
+ * configuration. "ver" is required and must change for a message to be
+ * applied; the applied version is reported as "cfg" in the payload.
+ *
+ * The configuration is stored in NVS (namespace "config") and cached in
+ * RTC memory, so wakes read NVS only after a power-on and write it only
+ * when a new version arrives.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Longest configuration message accepted
+#define RUNTIME_CONFIG_MSG_MAX_LEN 256
+
+    typedef struct
+    {
+        uint32_t version;      ///< Applied message version, 0 = Kconfig values
+        uint32_t interval_ms;  ///< Deep sleep between wakes in the normal tier (CONFIG_PUBLISH_INTERVAL)
+        uint8_t bmp_profile;   ///< measurement_profile_t to force, MEASUREMENT_PROFILE_UNKNOWN = governor decides
+        uint8_t batch_size;    ///< Measurements per uplink in the low tier (1..CONFIG_POWER_BATCH_SIZE)
+        bool led;              ///< LED signalling in the normal tier
+        uint16_t saver_mv;     ///< Tier thresholds (CONFIG_POWER_*_MV), 0 without the scheduler
+        uint16_t low_mv;
+        uint16_t hibernate_mv;
+    } runtime_config_t;
+
+    /**
+     * Configuration of this wake
+     *
+     * The first call loads it from RTC memory, after a power-on from NVS;
+     * Kconfig values if nothing was ever applied. Never NULL.
+     */
+    const runtime_config_t *runtime_config_get(void);
+
+    /**
+     * Apply a configuration message received from the backend
+     *
+     * Takes effect from the next wake on: this wake already runs with the
+     * previous values.
+     *
+     * @param msg JSON message (not NUL-terminated)
+     * @param len Length of msg
+     * @return ESP_OK if applied and stored, ESP_ERR_NOT_FOUND if the version
+     *         is already applied, ESP_ERR_INVALID_ARG if the message is
+     *         malformed or a value is out of range (nothing changes),
+     *         error code of NVS otherwise
+     */
+    esp_err_t runtime_config_apply(const char *msg, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
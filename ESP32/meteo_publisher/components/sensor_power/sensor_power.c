@@ -0,0 +1,218 @@
+/**
+ * @file sensor_power.c
+ * @brief Sensor power gating implementation
+ */
+
+#include "sensor_power.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_SENSOR_POWER_GATING
+
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
+#include <stddef.h>
+#include <stdint.h>
+
+static const char *TAG = "SENSOR_POWER";
+
+#if defined(CONFIG_BMP280_POWER_GPIO) && CONFIG_BMP280_POWER_GPIO >= 0
+#define BMP280_RAIL_GPIO CONFIG_BMP280_POWER_GPIO
+#define BMP280_RAIL_WARMUP_MS CONFIG_BMP280_WARMUP_MS
+#else
+#define BMP280_RAIL_GPIO -1
+#define BMP280_RAIL_WARMUP_MS 0
+#endif
+
+#if defined(CONFIG_AHT20_POWER_GPIO) && CONFIG_AHT20_POWER_GPIO >= 0
+#define AHT20_RAIL_GPIO CONFIG_AHT20_POWER_GPIO
+#define AHT20_RAIL_WARMUP_MS CONFIG_AHT20_WARMUP_MS
+#else
+#define AHT20_RAIL_GPIO -1
+#define AHT20_RAIL_WARMUP_MS 0
+#endif
+
+#if defined(CONFIG_DHT22_POWER_GPIO) && CONFIG_DHT22_POWER_GPIO >= 0
+#define DHT22_RAIL_GPIO CONFIG_DHT22_POWER_GPIO
+#define DHT22_RAIL_WARMUP_MS CONFIG_DHT22_WARMUP_MS
+#else
+#define DHT22_RAIL_GPIO -1
+#define DHT22_RAIL_WARMUP_MS 0
+#endif
+
+// SDA and SCL float in deep sleep only if no powered sensor is left on the bus
+#if (BMP280_RAIL_GPIO >= 0 || AHT20_RAIL_GPIO >= 0) &&             \
+    (BMP280_RAIL_GPIO >= 0 || !defined(CONFIG_BMP280_ENABLED)) && \
+    (AHT20_RAIL_GPIO >= 0 || !defined(CONFIG_AHT20_ENABLED))
+#define I2C_LINES_FLOAT 1
+#endif
+
+#ifdef CONFIG_SENSOR_POWER_ACTIVE_LOW
+#define LEVEL_ON 0
+#else
+#define LEVEL_ON 1
+#endif
+
+typedef struct
+{
+    const char *name;
+    int gpio; ///< Power enable, -1 if always powered
+    uint32_t warmup_ms;
+} rail_t;
+
+static const rail_t RAILS[SENSOR_POWER_RAILS] = {
+    [SENSOR_POWER_BMP280] = {"BMP280", BMP280_RAIL_GPIO, BMP280_RAIL_WARMUP_MS},
+    [SENSOR_POWER_AHT20] = {"AHT20", AHT20_RAIL_GPIO, AHT20_RAIL_WARMUP_MS},
+    [SENSOR_POWER_DHT22] = {"DHT22", DHT22_RAIL_GPIO, DHT22_RAIL_WARMUP_MS},
+};
+
+// Data lines of gated sensors, floating while they are off
+static const int DATA_GPIOS[] = {
+#ifdef I2C_LINES_FLOAT
+    CONFIG_I2C_SDA_GPIO,
+    CONFIG_I2C_SCL_GPIO,
+#endif
+#if DHT22_RAIL_GPIO >= 0
+    CONFIG_DHT22_GPIO,
+#endif
+    -1,
+};
+
+static bool s_on[SENSOR_POWER_RAILS];
+static int64_t s_on_us[SENSOR_POWER_RAILS];
+
+void sensor_power_on(void)
+{
+    for (size_t i = 0; DATA_GPIOS[i] >= 0; i++)
+    {
+        gpio_hold_dis(DATA_GPIOS[i]);
+    }
+
+    for (int i = 0; i < SENSOR_POWER_RAILS; i++)
+    {
+        if (RAILS[i].gpio < 0 || s_on[i])
+        {
+            continue;
+        }
+        gpio_hold_dis(RAILS[i].gpio);
+        gpio_set_level(RAILS[i].gpio, LEVEL_ON);
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << RAILS[i].gpio,
+            .mode = GPIO_MODE_OUTPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        gpio_config(&io_conf);
+        s_on[i] = true;
+        s_on_us[i] = esp_timer_get_time();
+    }
+}
+
+/**
+ * Time at which the warm-up of a switched-on rail ends
+ */
+static int64_t ready_us(sensor_power_rail_t rail)
+{
+    return s_on_us[rail] + (int64_t)RAILS[rail].warmup_ms * 1000;
+}
+
+void sensor_power_wait(sensor_power_rail_t rail)
+{
+    if (rail >= SENSOR_POWER_RAILS || !s_on[rail])
+    {
+        return;
+    }
+
+    int64_t left_us = ready_us(rail) - esp_timer_get_time();
+    if (left_us <= 0)
+    {
+        return;
+    }
+    ESP_LOGI(TAG, "%s warm-up: waiting %lld ms", RAILS[rail].name, (long long)(left_us + 999) / 1000);
+
+    // Whole ticks in light sleep, the rest busy
+    TickType_t ticks = pdMS_TO_TICKS(left_us / 1000);
+    if (ticks > 0)
+    {
+        vTaskDelay(ticks);
+    }
+    left_us = ready_us(rail) - esp_timer_get_time();
+    if (left_us > 0)
+    {
+        esp_rom_delay_us((uint32_t)left_us);
+    }
+}
+
+bool sensor_power_ready(sensor_power_rail_t rail)
+{
+    return rail < SENSOR_POWER_RAILS && s_on[rail] && esp_timer_get_time() >= ready_us(rail);
+}
+
+void sensor_power_off(void)
+{
+    for (size_t i = 0; DATA_GPIOS[i] >= 0; i++)
+    {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << DATA_GPIOS[i],
+            .mode = GPIO_MODE_DISABLE,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        gpio_config(&io_conf);
+        gpio_hold_en(DATA_GPIOS[i]);
+    }
+
+    for (int i = 0; i < SENSOR_POWER_RAILS; i++)
+    {
+        if (RAILS[i].gpio < 0)
+        {
+            continue;
+        }
+        // Also on wakes that never switched on: the pin must not float in sleep
+        gpio_set_level(RAILS[i].gpio, !LEVEL_ON);
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << RAILS[i].gpio,
+            .mode = GPIO_MODE_OUTPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        gpio_config(&io_conf);
+        gpio_hold_en(RAILS[i].gpio);
+        s_on[i] = false;
+    }
+
+#if !SOC_GPIO_SUPPORT_HOLD_SINGLE_IO_IN_DSLP
+    // Digital pads keep their hold in deep sleep only with this
+    gpio_deep_sleep_hold_en();
+#endif
+}
+
+#else
+
+void sensor_power_on(void)
+{
+}
+
+void sensor_power_wait(sensor_power_rail_t rail)
+{
+    (void)rail;
+}
+
+bool sensor_power_ready(sensor_power_rail_t rail)
+{
+    (void)rail;
+    return false;
+}
+
+void sensor_power_off(void)
+{
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file sensor_power.h
+ * @brief Sensor supply switched by GPIOs, on only while the node is awake
+ *
+ * With CONFIG_SENSOR_POWER_GATING each sensor can have a power enable GPIO
+ * (a load switch, or the sensor supplied from the pin itself). The rails
+ * are switched on early in the wake, so the datasheet warm-up runs while
+ * Wi-Fi connects, and off once the sensors are read. In deep sleep the
+ * enable pins are held off and the data lines of unpowered sensors are
+ * held floating, so no current flows into a sensor through its I/O pins.
+ *
+ * Sensors without an enable GPIO stay powered and return at once from
+ * every call; without the option all functions do nothing.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        SENSOR_POWER_BMP280,
+        SENSOR_POWER_AHT20,
+        SENSOR_POWER_DHT22,
+        SENSOR_POWER_RAILS
+    } sensor_power_rail_t;
+
+    /**
+     * Switch all gated sensors on and start their warm-up
+     * Call as early in the wake as possible.
+     */
+    void sensor_power_on(void);
+
+    /**
+     * Wait until the sensor's warm-up since sensor_power_on() has passed
+     * Returns at once if it has, or if the sensor is not gated.
+     */
+    void sensor_power_wait(sensor_power_rail_t rail);
+
+    /**
+     * True if the sensor is gated and its warm-up has passed: the driver
+     * can skip its own power-up wait
+     */
+    bool sensor_power_ready(sensor_power_rail_t rail);
+
+    /**
+     * Switch gated sensors off and hold their pins for deep sleep
+     */
+    void sensor_power_off(void);
+
+#ifdef __cplusplus
+}
+#endif
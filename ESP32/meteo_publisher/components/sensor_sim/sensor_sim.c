@@ -0,0 +1,125 @@
+/**
+ * @file sensor_sim.c
+ * @brief Simulated BMP280 and AHT20 implementation
+ */
+
+#include "sensor_sim.h"
+#include "esp_rom_sys.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define SIM_AHT20_ADDR 0x38
+#ifdef CONFIG_BMP280_I2C_ADDR
+#define SIM_BMP280_ADDR CONFIG_BMP280_I2C_ADDR
+#else
+#define SIM_BMP280_ADDR 0x76
+#endif
+
+// Bus time of one bit at 100 kHz
+#define SIM_BIT_US 10
+
+#define BMP280_REG_CALIB 0x88
+#define BMP280_REG_ID 0xD0
+#define BMP280_REG_RESET 0xE0
+#define BMP280_REG_DATA 0xF7
+#define BMP280_RESET_VALUE 0xB6
+
+// Datasheet 3.12 example: dig_T1..dig_P9, little endian
+static const uint8_t BMP280_CALIB[24] = {
+    0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC, 0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B,
+    0x27, 0x0B, 0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, 0x70, 0x17};
+
+// adc_P = 415148, adc_T = 519888 (0xF7..0xFC)
+static const uint8_t BMP280_DATA[6] = {0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00};
+
+// Status 0x1C (calibrated, idle), 45.00 %RH, 22.50 °C, CRC-8
+static const uint8_t AHT20_FRAME[7] = {0x1C, 0x73, 0x33, 0x35, 0xCC, 0xCD, 0x2A};
+
+// BMP280 register file and read pointer
+static uint8_t s_bmp280_regs[256];
+static uint8_t s_bmp280_ptr;
+static bool s_bmp280_ready;
+
+static void bmp280_reset(void)
+{
+    memset(s_bmp280_regs, 0, sizeof(s_bmp280_regs));
+    memcpy(&s_bmp280_regs[BMP280_REG_CALIB], BMP280_CALIB, sizeof(BMP280_CALIB));
+    memcpy(&s_bmp280_regs[BMP280_REG_DATA], BMP280_DATA, sizeof(BMP280_DATA));
+    s_bmp280_regs[BMP280_REG_ID] = 0x58;
+    s_bmp280_ready = true;
+}
+
+/**
+ * Register writes come in (register, value) pairs, a lone byte sets the read pointer
+ */
+static void bmp280_transfer(const uint8_t *write, size_t write_len, uint8_t *read, size_t read_len)
+{
+    if (!s_bmp280_ready)
+    {
+        bmp280_reset();
+    }
+
+    if (write_len == 1)
+    {
+        s_bmp280_ptr = write[0];
+    }
+    for (size_t i = 0; i + 1 < write_len; i += 2)
+    {
+        if (write[i] == BMP280_REG_RESET && write[i + 1] == BMP280_RESET_VALUE)
+        {
+            bmp280_reset();
+        }
+        else if (write[i] != BMP280_REG_ID && write[i] < BMP280_REG_DATA)
+        {
+            s_bmp280_regs[write[i]] = write[i + 1];
+        }
+    }
+
+    // Measurements finish at once: status 0xF3 never reports busy
+    for (size_t i = 0; i < read_len; i++)
+    {
+        read[i] = s_bmp280_regs[(uint8_t)(s_bmp280_ptr + i)];
+    }
+}
+
+/**
+ * Commands are accepted and the result is always ready
+ */
+static void aht20_transfer(uint8_t *read, size_t read_len)
+{
+    for (size_t i = 0; i < read_len; i++)
+    {
+        read[i] = i < sizeof(AHT20_FRAME) ? AHT20_FRAME[i] : 0xFF;
+    }
+}
+
+esp_err_t sensor_sim_transfer(uint8_t addr, const uint8_t *write, size_t write_len,
+                              uint8_t *read, size_t read_len)
+{
+    // START, address and ACK of each direction, data bytes with ACK, STOP
+    uint32_t bits = 2 + (write_len != 0 || read_len == 0 ? 9 : 0) + (read_len != 0 ? 9 : 0) +
+                    9 * (uint32_t)(write_len + read_len);
+    esp_rom_delay_us(bits * SIM_BIT_US);
+
+    if (write == NULL)
+    {
+        write_len = 0;
+    }
+    if (read == NULL)
+    {
+        read_len = 0;
+    }
+
+    switch (addr)
+    {
+    case SIM_BMP280_ADDR:
+        bmp280_transfer(write, write_len, read, read_len);
+        return ESP_OK;
+    case SIM_AHT20_ADDR:
+        aht20_transfer(read, read_len);
+        return ESP_OK;
+    default:
+        return ESP_FAIL;
+    }
+}
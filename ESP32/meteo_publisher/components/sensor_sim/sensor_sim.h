@@ -0,0 +1,42 @@
+/**
+ * @file sensor_sim.h
+ * @brief Simulated BMP280 and AHT20 behind the I²C register access helpers
+ *
+ * With CONFIG_SENSOR_SIMULATED the drivers and the bus probe hand their
+ * transfers to sensor_sim_transfer() instead of the I²C controller, e.g.
+ * under QEMU, which has no sensors. The drivers run unchanged above that:
+ * chip ID, calibration, triggers, status polls, CRC and conversion.
+ *
+ * The BMP280 answers with the calibration and raw values of the datasheet
+ * example (25.08 °C, 100653 Pa), the AHT20 with 22.50 °C and 45.00 %RH.
+ * Every transfer takes the time it would take on a 100 kHz bus, so the
+ * wake keeps its timing. No heap allocation.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * One I²C transaction with a simulated device: write, then read
+     *
+     * @param addr 7-bit device address
+     * @param write Bytes written (register address first), may be NULL
+     * @param write_len Number of bytes written
+     * @param read Buffer for the bytes read, may be NULL
+     * @param read_len Number of bytes read
+     * @return ESP_OK, ESP_FAIL if no simulated device has this address (NACK)
+     */
+    esp_err_t sensor_sim_transfer(uint8_t addr, const uint8_t *write, size_t write_len,
+                                  uint8_t *read, size_t read_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file time_sync.c
+ * @brief SNTP offset implementation
+ */
+
+#include "time_sync.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include "rtc_store.h"
+#include "sdkconfig.h"
+#include <sys/time.h>
+
+#ifdef CONFIG_SCHEDULE_SNTP_ENABLED
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+static const char *TAG = "TIME";
+
+#define STATE_TAG 0x4E595354 // "TSYN"
+#define STATE_VERSION 1
+
+/**
+ * Kept in RTC slow memory across deep sleep and software, panic and
+ * watchdog resets (the system time keeps running through them)
+ */
+typedef struct
+{
+    bool valid;
+    int64_t offset_us; ///< Server time minus system time
+    int64_t synced_us; ///< System time of the last answer
+} time_state_t;
+
+RTC_NOINIT_ATTR static RTC_STORE_RECORD(time_state_t) s_state;
+
+static int64_t system_now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void load_state(void)
+{
+    RTC_STORE_OPEN(s_state, STATE_TAG, STATE_VERSION);
+}
+
+#ifdef CONFIG_SCHEDULE_SNTP_ENABLED
+
+// Written by the lwIP task, read by time_sync_finish()
+static volatile bool s_received;
+static int64_t s_received_offset_us;
+static int64_t s_received_at_us;
+static bool s_started;
+
+/**
+ * Replaces the weak lwIP implementation, which steps the system clock
+ */
+void sntp_sync_time(struct timeval *tv)
+{
+    int64_t now = system_now_us();
+    s_received_offset_us = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec - now;
+    s_received_at_us = now;
+    s_received = true;
+    sntp_set_sync_status(SNTP_SYNC_STATUS_COMPLETED);
+}
+
+void time_sync_start(void)
+{
+    load_state();
+    int64_t resync_us = (int64_t)CONFIG_SCHEDULE_SNTP_RESYNC_H * 3600LL * 1000000LL;
+    if (s_started || (s_state.data.valid && system_now_us() - s_state.data.synced_us < resync_us))
+    {
+        return;
+    }
+
+    s_received = false;
+    esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, CONFIG_SCHEDULE_SNTP_SERVER);
+    esp_sntp_init();
+    s_started = true;
+    ESP_LOGI(TAG, "SNTP request to %s", CONFIG_SCHEDULE_SNTP_SERVER);
+}
+
+bool time_sync_finish(uint32_t timeout_ms)
+{
+    load_state();
+    if (!s_started)
+    {
+        return s_state.data.valid;
+    }
+
+    for (uint32_t waited = 0; !s_received && waited < timeout_ms; waited += 10)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    esp_sntp_stop();
+    s_started = false;
+
+    if (!s_received)
+    {
+        ESP_LOGW(TAG, "No SNTP answer within %lu ms", (unsigned long)timeout_ms);
+        return s_state.data.valid;
+    }
+
+    // Drift of the RTC clock since the previous answer
+    int32_t drift_ms = s_state.data.valid ? (int32_t)((s_received_offset_us - s_state.data.offset_us) / 1000) : 0;
+    s_state.data.offset_us = s_received_offset_us;
+    s_state.data.synced_us = s_received_at_us;
+    s_state.data.valid = true;
+    RTC_STORE_COMMIT(s_state);
+
+    EVLOG2(EVLOG_TIME_SYNC, (uint32_t)(s_state.data.offset_us / 1000000), drift_ms);
+    ESP_LOGI(TAG, "Offset %lld s, drift %ld ms since the last answer",
+             (long long)(s_state.data.offset_us / 1000000), (long)drift_ms);
+    return true;
+}
+
+#else
+
+void time_sync_start(void)
+{
+}
+
+bool time_sync_finish(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    return time_sync_valid();
+}
+
+#endif
+
+bool time_sync_valid(void)
+{
+    load_state();
+    return s_state.data.valid;
+}
+
+int64_t time_sync_now_us(void)
+{
+    load_state();
+    return system_now_us() + (s_state.data.valid ? s_state.data.offset_us : 0);
+}
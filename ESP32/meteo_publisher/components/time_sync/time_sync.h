@@ -0,0 +1,53 @@
+/**
+ * @file time_sync.h
+ * @brief Wall-clock time from SNTP, kept as an offset to the system clock
+ *
+ * The system clock counts from power-on and keeps running in deep sleep.
+ * Measurement timestamps, the RTC batch and the outbox rely on it, so SNTP
+ * never steps it: the difference to the server time is kept in RTC memory
+ * instead, and time_sync_now_us() adds it.
+ *
+ * With CONFIG_SCHEDULE_SNTP_ENABLED a publishing wake asks the server when
+ * the offset is unknown or older than CONFIG_SCHEDULE_SNTP_RESYNC_H hours.
+ * The request goes out right after Wi-Fi connects and the answer is
+ * collected after the uplink session, so it rarely adds awake time.
+ * Without it time_sync_now_us() is the system time.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Send an SNTP request if the offset is unknown or due for a refresh
+     * Call once Wi-Fi is connected; returns at once.
+     */
+    void time_sync_start(void);
+
+    /**
+     * Wait for the answer to time_sync_start() and stop SNTP
+     * @param timeout_ms Longest wait, the Wi-Fi stays up meanwhile
+     * @return true if the offset is known (from this or an earlier wake)
+     */
+    bool time_sync_finish(uint32_t timeout_ms);
+
+    /**
+     * True once a server answered since power-on
+     */
+    bool time_sync_valid(void);
+
+    /**
+     * Wall-clock time in microseconds since the epoch if time_sync_valid(),
+     * time since power-on otherwise
+     */
+    int64_t time_sync_now_us(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,204 @@
+/**
+ * @file measurement.h
+ * @brief Measurement record sent by every uplink transport
+ *
+ * Plain C, no ESP-IDF dependencies: shared with the host tools.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define MEASUREMENT_INVALID -999.0f
+#define MEASUREMENT_DEVICE_ID_LEN 32
+#define MEASUREMENT_FW_LEN 16
+
+    /**
+     * BMP280 oversampling profile of a sample, tells the backend its precision
+     */
+    typedef enum
+    {
+        MEASUREMENT_PROFILE_UNKNOWN = 0, ///< Not reported
+        MEASUREMENT_PROFILE_LOW,         ///< osrs ×1/×1, no filter
+        MEASUREMENT_PROFILE_HIGH,        ///< osrs_p ×16, osrs_t ×2, no filter
+        MEASUREMENT_PROFILE_ULTRA,       ///< osrs ×16/×16, filter 16
+    } measurement_profile_t;
+
+    /**
+     * Duty-cycle tier chosen from the battery voltage
+     */
+    typedef enum
+    {
+        MEASUREMENT_TIER_NORMAL = 0, ///< Configured interval
+        MEASUREMENT_TIER_SAVER,      ///< Longer interval, no LED
+        MEASUREMENT_TIER_LOW,        ///< Longer interval, batched uplink
+        MEASUREMENT_TIER_HIBERNATE,  ///< Battery critical, node stops measuring
+    } measurement_tier_t;
+
+    /**
+     * Node health summary, lets the backend flag nodes before they go silent
+     * Codes are the ESP-IDF values; counters saturate instead of wrapping.
+     */
+    typedef struct
+    {
+        uint8_t reset_reason;      ///< esp_reset_reason_t of the last reset that was not a wake, 0 if not reported
+        uint8_t wake_cause;        ///< esp_sleep_source_t of this boot
+        uint8_t wifi_reason;       ///< Last Wi-Fi disconnect reason (wifi_err_reason_t), 0 if none
+        uint16_t failed_publishes; ///< Consecutive publishing wakes that failed
+        uint16_t wifi_disconnects; ///< Since power-on
+        uint16_t sensor_failures;  ///< Failed sensor initializations and reads since power-on
+        uint16_t brownouts;        ///< Since the counters were erased (kept in NVS)
+        uint16_t panics;           ///< Panic and exception resets (kept in NVS)
+        uint16_t watchdogs;        ///< Interrupt, task and RTC watchdog resets (kept in NVS)
+    } measurement_health_t;
+
+    /**
+     * Memory use of the node, sampled while the uplink session is open
+     * Stack values are the unused bytes (high-water mark), 0 if the task
+     * does not run on this node.
+     */
+    typedef struct
+    {
+        uint32_t min_free_heap; ///< Lowest free heap since boot, 0 if not reported
+        uint32_t largest_block; ///< Largest free 8-bit capable block
+        uint32_t free_internal; ///< Free internal RAM
+        uint32_t free_psram;    ///< Free PSRAM, 0 without PSRAM
+        uint16_t stack_main;    ///< Main task (app and sensor drivers)
+        uint16_t stack_wifi;    ///< Wi-Fi driver task
+        uint16_t stack_tcpip;   ///< lwIP task
+        uint16_t stack_event;   ///< Default event loop task
+        uint16_t stack_mqtt;    ///< esp-mqtt client task
+    } measurement_memory_t;
+
+    /**
+     * Register bytes the sensor values were converted from (debug capture)
+     * Lets the backend replay them through the driver conversion
+     * (host/sensor_replay). A frame is present if its bit is set in present.
+     */
+    typedef struct
+    {
+        uint8_t bmp280_calib[24]; ///< Calibration block 0x88..0x9F
+        uint8_t bmp280[6];        ///< Data registers 0xF7..0xFC
+        uint8_t aht20[7];         ///< Status, 5 data bytes, CRC-8
+        uint8_t dht22[5];         ///< 4 data bytes, checksum
+        uint8_t present;          ///< MEASUREMENT_RAW_* bits
+    } measurement_raw_t;
+
+#define MEASUREMENT_RAW_BMP280 0x01
+#define MEASUREMENT_RAW_AHT20 0x02
+#define MEASUREMENT_RAW_DHT22 0x04
+
+// Latency buckets of the I2C trace: below 250 us, then doubling, the last one open
+#define MEASUREMENT_I2C_BUCKETS 8
+#define MEASUREMENT_I2C_BUCKET0_US 250
+
+    /**
+     * I2C devices traced by the sensor drivers
+     */
+    typedef enum
+    {
+        MEASUREMENT_I2C_BMP280 = 0,
+        MEASUREMENT_I2C_AHT20,
+        MEASUREMENT_I2C_DEVICES,
+    } measurement_i2c_device_t;
+
+    /**
+     * I2C transactions of one device during this wake
+     * Counters saturate instead of wrapping.
+     */
+    typedef struct
+    {
+        uint32_t transactions; ///< Completed and failed transactions
+        uint32_t bytes;        ///< Bytes written and read, register addresses included
+        uint16_t nacks;        ///< Transactions not acknowledged (ESP_FAIL)
+        uint16_t timeouts;     ///< Bus busy or stuck (ESP_ERR_TIMEOUT)
+        uint32_t busy_us;      ///< Sum of the transaction latencies
+        uint32_t max_us;       ///< Longest transaction
+        uint16_t hist[MEASUREMENT_I2C_BUCKETS]; ///< Latencies, bucket i below 250 us << i
+    } measurement_i2c_stats_t;
+
+    /**
+     * I2C bus summary of a wake (debug trace)
+     */
+    typedef struct
+    {
+        measurement_i2c_stats_t device[MEASUREMENT_I2C_DEVICES];
+    } measurement_i2c_t;
+
+    /**
+     * One measurement of one node
+     * Sensor values are MEASUREMENT_INVALID when unavailable.
+     */
+    typedef struct
+    {
+        char device_id[MEASUREMENT_DEVICE_ID_LEN]; ///< Node name (CONFIG_NODE_NAME)
+        char fw[MEASUREMENT_FW_LEN];               ///< Firmware version
+        int64_t ts_device;                         ///< Device time of the sample (s)
+        uint32_t sample_age_s;                     ///< Age when sent (0 = taken this wake)
+        int8_t rssi;                               ///< Wi-Fi RSSI in dBm
+        int8_t tx_power;                           ///< Wi-Fi TX power limit in 0.25 dBm, 0 if not reported
+        float altitude_m;                          ///< Altitude derived from pressure
+        uint32_t free_heap;                        ///< Free heap in bytes
+
+        float dht_temp;
+        float dht_rh;
+        float aht20_temp;
+        float aht20_rh;
+        float bmp_temp;
+        float bmp_press;
+
+        const char *transport;  ///< Name of the uplink transport (set by the transport)
+        uint32_t last_awake_ms; ///< Awake time of the previous wake
+
+        uint8_t bmp_profile; ///< measurement_profile_t of bmp_temp/bmp_press
+        float bmp_noise_pa;  ///< Typical RMS pressure noise of that profile
+
+        uint16_t battery_mv; ///< Battery voltage, 0 if not measured
+        uint8_t power_tier;  ///< measurement_tier_t (valid if battery_mv != 0)
+
+        measurement_health_t health; ///< Valid if health.reset_reason != 0
+        measurement_memory_t memory; ///< Valid if memory.min_free_heap != 0
+        uint32_t seq;                ///< Measurement number of the node (outbox), 0 if not numbered
+        uint32_t cfg_version;        ///< Applied runtime configuration, 0 = Kconfig defaults
+        const measurement_raw_t *raw; ///< Raw sensor frames, NULL if not captured; not kept across wakes
+        const measurement_i2c_t *i2c; ///< I2C trace summary, NULL if not traced; not kept across wakes
+    } meteo_measurement_t;
+
+    /**
+     * Reset a measurement: strings empty, sensor values MEASUREMENT_INVALID
+     */
+    void measurement_init(meteo_measurement_t *m);
+
+    /**
+     * Name of a measurement_profile_t ("low", "high", "ultra"), NULL if unknown
+     */
+    const char *measurement_profile_name(uint8_t profile);
+
+    /**
+     * Name of a measurement_i2c_device_t ("bmp280", "aht20")
+     */
+    const char *measurement_i2c_device_name(uint8_t device);
+
+    /**
+     * Name of a measurement_tier_t ("normal", "saver", "low", "hibernate")
+     */
+    const char *measurement_tier_name(uint8_t tier);
+
+    /**
+     * Name of an esp_reset_reason_t ("poweron", "panic", "brownout", ...)
+     */
+    const char *measurement_reset_name(uint8_t reason);
+
+    /**
+     * Name of an esp_sleep_source_t ("timer", "gpio", ...), "none" for a reset
+     */
+    const char *measurement_wake_name(uint8_t cause);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,289 @@
+/**
+ * @file payload.c
+ * @brief JSON payload formatting
+ */
+
+#include "payload.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void measurement_init(meteo_measurement_t *m)
+{
+    memset(m, 0, sizeof(*m));
+    m->altitude_m = NAN;
+    m->dht_temp = MEASUREMENT_INVALID;
+    m->dht_rh = MEASUREMENT_INVALID;
+    m->aht20_temp = MEASUREMENT_INVALID;
+    m->aht20_rh = MEASUREMENT_INVALID;
+    m->bmp_temp = MEASUREMENT_INVALID;
+    m->bmp_press = MEASUREMENT_INVALID;
+}
+
+const char *measurement_profile_name(uint8_t profile)
+{
+    switch (profile)
+    {
+    case MEASUREMENT_PROFILE_LOW:
+        return "low";
+    case MEASUREMENT_PROFILE_HIGH:
+        return "high";
+    case MEASUREMENT_PROFILE_ULTRA:
+        return "ultra";
+    default:
+        return NULL;
+    }
+}
+
+const char *measurement_tier_name(uint8_t tier)
+{
+    switch (tier)
+    {
+    case MEASUREMENT_TIER_NORMAL:
+        return "normal";
+    case MEASUREMENT_TIER_SAVER:
+        return "saver";
+    case MEASUREMENT_TIER_LOW:
+        return "low";
+    case MEASUREMENT_TIER_HIBERNATE:
+        return "hibernate";
+    default:
+        return "unknown";
+    }
+}
+
+const char *measurement_i2c_device_name(uint8_t device)
+{
+    switch (device)
+    {
+    case MEASUREMENT_I2C_BMP280:
+        return "bmp280";
+    case MEASUREMENT_I2C_AHT20:
+        return "aht20";
+    default:
+        return "unknown";
+    }
+}
+
+const char *measurement_reset_name(uint8_t reason)
+{
+    // esp_reset_reason_t
+    static const char *const names[] = {
+        "unknown", "poweron", "ext", "sw", "panic", "int_wdt", "task_wdt", "wdt",
+        "deepsleep", "brownout", "sdio", "usb", "jtag", "efuse", "pwr_glitch", "cpu_lockup"};
+    return reason < sizeof(names) / sizeof(names[0]) ? names[reason] : "unknown";
+}
+
+const char *measurement_wake_name(uint8_t cause)
+{
+    // esp_sleep_source_t
+    static const char *const names[] = {
+        "none", "all", "ext0", "ext1", "timer", "touch", "ulp", "gpio", "uart", "wifi",
+        "cocpu", "cocpu_trap", "bt"};
+    return cause < sizeof(names) / sizeof(names[0]) ? names[cause] : "unknown";
+}
+
+/**
+ * Lowercase hex of a byte string
+ * @return Characters written (without the terminator)
+ */
+static int format_hex(const uint8_t *data, size_t data_len, char *buf, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t n = 0;
+    for (size_t i = 0; i < data_len && n + 2 < len; i++)
+    {
+        buf[n++] = digits[data[i] >> 4];
+        buf[n++] = digits[data[i] & 0x0F];
+    }
+    if (len > 0)
+    {
+        buf[n] = '\0';
+    }
+    return (int)n;
+}
+
+int payload_format_topic(const char *device_id, char *buf, size_t len)
+{
+    return snprintf(buf, len, "sensors/%s/environment", device_id);
+}
+
+int payload_format_json(const meteo_measurement_t *m, char *buf, size_t len)
+{
+    // Replace NaN and invalid values with null for valid JSON
+    char altitude_str[32];
+    if (isnan(m->altitude_m) || m->altitude_m < -500.0f || m->altitude_m > 10000.0f)
+    {
+        snprintf(altitude_str, sizeof(altitude_str), "null");
+    }
+    else
+    {
+        snprintf(altitude_str, sizeof(altitude_str), "%.1f", m->altitude_m);
+    }
+
+    // Precision of the BMP280 sample, omitted when not reported
+    char profile_str[64] = "";
+    const char *profile = measurement_profile_name(m->bmp_profile);
+    if (profile != NULL)
+    {
+        snprintf(profile_str, sizeof(profile_str), ",\"profile\":\"%s\",\"noise_pa\":%.2f",
+                 profile, m->bmp_noise_pa);
+    }
+
+    // TX power of the wake, omitted without Wi-Fi association (ESP-NOW, batched samples)
+    char tx_power_str[24] = "";
+    if (m->tx_power != 0)
+    {
+        snprintf(tx_power_str, sizeof(tx_power_str), "\"tx_dbm\":%.2f,", m->tx_power / 4.0f);
+    }
+
+    // Battery object only on nodes that measure it
+    char battery_str[64] = "";
+    if (m->battery_mv != 0)
+    {
+        snprintf(battery_str, sizeof(battery_str), "\"battery\":{\"mv\":%u,\"tier\":\"%s\"},",
+                 (unsigned)m->battery_mv, measurement_tier_name(m->power_tier));
+    }
+
+    // Health summary, omitted by nodes and samples that do not report it
+    char health_str[224] = "";
+    const measurement_health_t *h = &m->health;
+    if (h->reset_reason != 0)
+    {
+        snprintf(health_str, sizeof(health_str),
+                 "\"health\":{\"reset\":\"%s\",\"wake\":\"%s\",\"pub_fail\":%u,"
+                 "\"wifi_disc\":%u,\"wifi_reason\":%u,\"sensor_fail\":%u,"
+                 "\"brownout\":%u,\"panic\":%u,\"wdt\":%u},",
+                 measurement_reset_name(h->reset_reason), measurement_wake_name(h->wake_cause),
+                 (unsigned)h->failed_publishes, (unsigned)h->wifi_disconnects, (unsigned)h->wifi_reason,
+                 (unsigned)h->sensor_failures, (unsigned)h->brownouts, (unsigned)h->panics,
+                 (unsigned)h->watchdogs);
+    }
+
+    // Memory object, omitted when not sampled; stacks of absent tasks are null
+    char memory_str[256] = "";
+    const measurement_memory_t *mem = &m->memory;
+    if (mem->min_free_heap != 0)
+    {
+        const uint16_t stacks[] = {mem->stack_main, mem->stack_wifi, mem->stack_tcpip,
+                                   mem->stack_event, mem->stack_mqtt};
+        char stack_str[5][8];
+        for (size_t i = 0; i < sizeof(stacks) / sizeof(stacks[0]); i++)
+        {
+            snprintf(stack_str[i], sizeof(stack_str[i]), stacks[i] != 0 ? "%u" : "null", stacks[i]);
+        }
+        snprintf(memory_str, sizeof(memory_str),
+                 "\"mem\":{\"min_free\":%lu,\"largest\":%lu,\"internal\":%lu,\"psram\":%lu,"
+                 "\"stack\":{\"main\":%s,\"wifi\":%s,\"tcpip\":%s,\"event\":%s,\"mqtt\":%s}},",
+                 (unsigned long)mem->min_free_heap, (unsigned long)mem->largest_block,
+                 (unsigned long)mem->free_internal, (unsigned long)mem->free_psram,
+                 stack_str[0], stack_str[1], stack_str[2], stack_str[3], stack_str[4]);
+    }
+
+    // Sequence number, lets the backend spot gaps and duplicates
+    char seq_str[24] = "";
+    if (m->seq != 0)
+    {
+        snprintf(seq_str, sizeof(seq_str), "\"seq\":%lu,", (unsigned long)m->seq);
+    }
+
+    // Acknowledges the downlink configuration the node runs with
+    char cfg_str[24] = "";
+    if (m->cfg_version != 0)
+    {
+        snprintf(cfg_str, sizeof(cfg_str), "\"cfg\":%lu,", (unsigned long)m->cfg_version);
+    }
+
+    // Raw sensor frames as hex strings, debug builds only
+    char raw_str[PAYLOAD_RAW_MAX_LEN] = "";
+    if (m->raw != NULL && m->raw->present != 0)
+    {
+        const measurement_raw_t *r = m->raw;
+        int n = snprintf(raw_str, sizeof(raw_str), ",\"raw\":{");
+        const char *sep = "";
+        if (r->present & MEASUREMENT_RAW_BMP280)
+        {
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "\"bmp280_calib\":\"");
+            n += format_hex(r->bmp280_calib, sizeof(r->bmp280_calib), raw_str + n, sizeof(raw_str) - n);
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "\",\"bmp280\":\"");
+            n += format_hex(r->bmp280, sizeof(r->bmp280), raw_str + n, sizeof(raw_str) - n);
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "\"");
+            sep = ",";
+        }
+        if (r->present & MEASUREMENT_RAW_AHT20)
+        {
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "%s\"aht20\":\"", sep);
+            n += format_hex(r->aht20, sizeof(r->aht20), raw_str + n, sizeof(raw_str) - n);
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "\"");
+            sep = ",";
+        }
+        if (r->present & MEASUREMENT_RAW_DHT22)
+        {
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "%s\"dht22\":\"", sep);
+            n += format_hex(r->dht22, sizeof(r->dht22), raw_str + n, sizeof(raw_str) - n);
+            n += snprintf(raw_str + n, sizeof(raw_str) - n, "\"");
+        }
+        snprintf(raw_str + n, sizeof(raw_str) - n, "}");
+    }
+
+    // I2C trace summary, debug builds only; devices without transactions are omitted
+    char i2c_str[PAYLOAD_I2C_MAX_LEN] = "";
+    if (m->i2c != NULL)
+    {
+        int n = snprintf(i2c_str, sizeof(i2c_str), ",\"i2c\":{");
+        const char *sep = "";
+        for (uint8_t d = 0; d < MEASUREMENT_I2C_DEVICES; d++)
+        {
+            const measurement_i2c_stats_t *s = &m->i2c->device[d];
+            if (s->transactions == 0)
+            {
+                continue;
+            }
+            n += snprintf(i2c_str + n, sizeof(i2c_str) - n,
+                          "%s\"%s\":{\"n\":%lu,\"bytes\":%lu,\"nack\":%u,\"tmo\":%u,"
+                          "\"us\":%lu,\"max_us\":%lu,\"hist\":[",
+                          sep, measurement_i2c_device_name(d), (unsigned long)s->transactions,
+                          (unsigned long)s->bytes, (unsigned)s->nacks, (unsigned)s->timeouts,
+                          (unsigned long)s->busy_us, (unsigned long)s->max_us);
+            for (size_t b = 0; b < MEASUREMENT_I2C_BUCKETS; b++)
+            {
+                n += snprintf(i2c_str + n, sizeof(i2c_str) - n, b == 0 ? "%u" : ",%u", (unsigned)s->hist[b]);
+            }
+            n += snprintf(i2c_str + n, sizeof(i2c_str) - n, "]}");
+            sep = ",";
+        }
+        snprintf(i2c_str + n, sizeof(i2c_str) - n, "}");
+    }
+
+    return snprintf(buf, len,
+                    "{"
+                    "\"device_id\":\"%s\","
+                    "\"fw\":\"%s\","
+                    "%s"
+                    "%s"
+                    "\"ts_device\":%lld,"
+                    "\"sample_age_s\":%lu,"
+                    "\"transport\":\"%s\","
+                    "\"awake_ms\":%lu,"
+                    "\"rssi\":%d,"
+                    "%s"
+                    "\"altitude_m\":%s,"
+                    "\"free_heap\":%lu,"
+                    "%s"
+                    "%s"
+                    "%s"
+                    "\"dht22\":{\"temperature_c\":%.2f,\"humidity_percent\":%.2f},"
+                    "\"aht20\":{\"temperature_c\":%.2f,\"humidity_percent\":%.2f},"
+                    "\"bmp280\":{\"temperature_c\":%.2f,\"pressure_pa\":%.2f%s}"
+                    "%s"
+                    "%s"
+                    "}",
+                    m->device_id, m->fw, seq_str, cfg_str, (long long)m->ts_device,
+                    (unsigned long)m->sample_age_s,
+                    m->transport != NULL ? m->transport : "",
+                    (unsigned long)m->last_awake_ms,
+                    m->rssi, tx_power_str, altitude_str, (unsigned long)m->free_heap, battery_str, health_str, memory_str,
+                    m->dht_temp, m->dht_rh,
+                    m->aht20_temp, m->aht20_rh,
+                    m->bmp_temp, m->bmp_press, profile_str, raw_str, i2c_str);
+}
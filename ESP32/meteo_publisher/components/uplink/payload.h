@@ -0,0 +1,47 @@
+/**
+ * @file payload.h
+ * @brief JSON payload and topic formatting for measurements
+ *
+ * Plain C, no ESP-IDF dependencies: the host fleet simulator links the
+ * same code so it produces byte-identical payloads.
+ */
+
+#pragma once
+
+#include "measurement.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Buffer size that holds the longest payload (all optional objects, maximal values)
+#define PAYLOAD_JSON_MAX_LEN 896
+
+// Longest "raw" object (measurement_raw_t with every frame), on top of PAYLOAD_JSON_MAX_LEN
+#define PAYLOAD_RAW_MAX_LEN 160
+
+// Longest "i2c" object (measurement_i2c_t, every device, maximal counters), on top of PAYLOAD_JSON_MAX_LEN
+#define PAYLOAD_I2C_MAX_LEN 336
+
+    /**
+     * Format the JSON payload published to sensors/<node>/environment
+     *
+     * @param m Measurement
+     * @param buf Output buffer
+     * @param len Size of buf
+     * @return Payload length (as snprintf), negative on error
+     */
+    int payload_format_json(const meteo_measurement_t *m, char *buf, size_t len);
+
+    /**
+     * Format the measurement topic sensors/<node>/environment
+     *
+     * @return Topic length (as snprintf)
+     */
+    int payload_format_topic(const char *device_id, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
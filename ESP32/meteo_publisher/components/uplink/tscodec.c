@@ -0,0 +1,295 @@
+/**
+ * @file tscodec.c
+ * @brief Compact time-series encoding implementation
+ */
+
+#include "tscodec.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define CHANNEL_COUNT 7
+#define CHANNEL_BATTERY 6
+
+// Scaled sensor values beyond this are not plausible readings
+#define SCALED_LIMIT 1000000000.0
+
+enum
+{
+    MODE_ABSENT = 0,
+    MODE_ALL_VALID = 1,
+    MODE_GAPS = 2,
+};
+
+// Float channels in encoding order, scaled by 100
+static const size_t FLOAT_CHANNELS[CHANNEL_COUNT - 1] = {
+    offsetof(meteo_measurement_t, dht_temp),
+    offsetof(meteo_measurement_t, dht_rh),
+    offsetof(meteo_measurement_t, aht20_temp),
+    offsetof(meteo_measurement_t, aht20_rh),
+    offsetof(meteo_measurement_t, bmp_temp),
+    offsetof(meteo_measurement_t, bmp_press),
+};
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t cap;
+    size_t pos; ///< Keeps counting past cap, so overflow is detected once at the end
+} writer_t;
+
+typedef struct
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool error;
+} reader_t;
+
+static void put_byte(writer_t *w, uint8_t b)
+{
+    if (w->pos < w->cap)
+    {
+        w->buf[w->pos] = b;
+    }
+    w->pos++;
+}
+
+static void put_varint(writer_t *w, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        put_byte(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_byte(w, (uint8_t)v);
+}
+
+static void put_signed(writer_t *w, int64_t v)
+{
+    put_varint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static uint8_t get_byte(reader_t *r)
+{
+    if (r->pos >= r->len)
+    {
+        r->error = true;
+        return 0;
+    }
+    return r->buf[r->pos++];
+}
+
+static uint64_t get_varint(reader_t *r)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t b = get_byte(r);
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+        {
+            return v;
+        }
+    }
+    r->error = true;
+    return 0;
+}
+
+static int64_t get_signed(reader_t *r)
+{
+    uint64_t v = get_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * Scaled value of a channel
+ * @return false if the sample has no valid value in this channel
+ */
+static bool channel_value(const meteo_measurement_t *m, int channel, int64_t *value)
+{
+    if (channel == CHANNEL_BATTERY)
+    {
+        *value = m->battery_mv;
+        return m->battery_mv != 0;
+    }
+
+    float f;
+    memcpy(&f, (const char *)m + FLOAT_CHANNELS[channel], sizeof(f));
+    double scaled = (double)f * 100.0;
+    if (f == MEASUREMENT_INVALID || isnan(f) || fabs(scaled) > SCALED_LIMIT)
+    {
+        return false;
+    }
+    *value = llround(scaled);
+    return true;
+}
+
+static void set_channel_value(meteo_measurement_t *m, int channel, int64_t value)
+{
+    if (channel == CHANNEL_BATTERY)
+    {
+        m->battery_mv = (uint16_t)value;
+        return;
+    }
+
+    float f = (float)((double)value / 100.0);
+    memcpy((char *)m + FLOAT_CHANNELS[channel], &f, sizeof(f));
+}
+
+size_t tscodec_encode(const meteo_measurement_t *m, size_t count, int64_t now,
+                      uint8_t *buf, size_t cap)
+{
+    if (m == NULL || buf == NULL || count == 0 || count > TSCODEC_MAX_SAMPLES)
+    {
+        return 0;
+    }
+
+    writer_t w = {.buf = buf, .cap = cap, .pos = 0};
+    put_byte(&w, TSCODEC_MAGIC);
+    put_byte(&w, TSCODEC_VERSION);
+    put_byte(&w, (uint8_t)count);
+    put_signed(&w, m[0].ts_device);
+    put_signed(&w, now - m[count - 1].ts_device);
+    put_varint(&w, m[0].seq);
+
+    // Timestamps: a steady interval costs one byte per sample
+    int64_t prev_delta = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        int64_t delta = m[i].ts_device - m[i - 1].ts_device;
+        put_signed(&w, i == 1 ? delta : delta - prev_delta);
+        prev_delta = delta;
+    }
+    for (size_t i = 1; i < count; i++)
+    {
+        put_signed(&w, (int64_t)m[i].seq - (int64_t)m[i - 1].seq - 1);
+    }
+
+    for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+    {
+        size_t valid = 0;
+        int64_t value;
+        for (size_t i = 0; i < count; i++)
+        {
+            valid += channel_value(&m[i], ch, &value);
+        }
+
+        if (valid == 0)
+        {
+            put_byte(&w, MODE_ABSENT);
+            continue;
+        }
+        uint8_t mode = valid == count ? MODE_ALL_VALID : MODE_GAPS;
+        put_byte(&w, mode);
+
+        // First valid value in full, then deltas; with gaps, each group of
+        // 8 samples is preceded by its validity bits
+        bool first = true;
+        int64_t prev = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (mode == MODE_GAPS && i % 8 == 0)
+            {
+                uint8_t bits = 0;
+                for (size_t j = i; j < i + 8 && j < count; j++)
+                {
+                    bits |= (uint8_t)(channel_value(&m[j], ch, &value) << (j - i));
+                }
+                put_byte(&w, bits);
+            }
+            if (channel_value(&m[i], ch, &value))
+            {
+                put_signed(&w, first ? value : value - prev);
+                prev = value;
+                first = false;
+            }
+        }
+    }
+
+    return w.pos <= cap ? w.pos : 0;
+}
+
+size_t tscodec_decode(const uint8_t *buf, size_t len, meteo_measurement_t *m, size_t max)
+{
+    if (buf == NULL || m == NULL)
+    {
+        return 0;
+    }
+
+    reader_t r = {.buf = buf, .len = len, .pos = 0, .error = false};
+    if (get_byte(&r) != TSCODEC_MAGIC || get_byte(&r) != TSCODEC_VERSION)
+    {
+        return 0;
+    }
+    size_t count = get_byte(&r);
+    if (r.error || count == 0 || count > max)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        measurement_init(&m[i]);
+    }
+
+    m[0].ts_device = get_signed(&r);
+    int64_t last_age = get_signed(&r);
+    m[0].seq = (uint32_t)get_varint(&r);
+
+    int64_t delta = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        int64_t v = get_signed(&r);
+        delta = i == 1 ? v : delta + v;
+        m[i].ts_device = m[i - 1].ts_device + delta;
+    }
+    for (size_t i = 1; i < count; i++)
+    {
+        m[i].seq = (uint32_t)((int64_t)m[i - 1].seq + 1 + get_signed(&r));
+    }
+
+    for (int ch = 0; ch < CHANNEL_COUNT && !r.error; ch++)
+    {
+        uint8_t mode = get_byte(&r);
+        if (mode == MODE_ABSENT)
+        {
+            continue;
+        }
+        if (mode != MODE_ALL_VALID && mode != MODE_GAPS)
+        {
+            return 0;
+        }
+
+        uint8_t bits = 0xFF;
+        bool first = true;
+        int64_t value = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (mode == MODE_GAPS && i % 8 == 0)
+            {
+                bits = get_byte(&r);
+            }
+            if (bits & (1u << (i % 8)))
+            {
+                int64_t v = get_signed(&r);
+                value = first ? v : value + v;
+                first = false;
+                set_channel_value(&m[i], ch, value);
+            }
+        }
+    }
+
+    if (r.error || r.pos != len)
+    {
+        return 0;
+    }
+
+    int64_t now = m[count - 1].ts_device + last_age;
+    for (size_t i = 0; i < count; i++)
+    {
+        m[i].sample_age_s = now > m[i].ts_device ? (uint32_t)(now - m[i].ts_device) : 0;
+    }
+    return count;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file tscodec.h
+ * @brief Compact time-series encoding of a measurement batch
+ *
+ * Plain C, no ESP-IDF dependencies: the host decoder and benchmark link the
+ * same code. Encodes the time series of one node (timestamps, sequence
+ * numbers, sensor values, battery voltage) column by column:
+ *
+ *   magic (0x54) | version | count | ts[0] | now - ts[count-1] | seq[0]
+ *   timestamps:  ts[1] - ts[0], then delta-of-delta (0 at a steady interval)
+ *   seq:         seq[i] - seq[i-1] - 1 (0 when consecutive)
+ *   7 channels:  mode (0 absent, 1 all valid, 2 with gaps), then the first
+ *                valid value and the deltas of the following valid values;
+ *                with gaps, each group of 8 samples starts with a byte of
+ *                validity bits (bit i = sample i of the group)
+ *
+ * Sensor values are scaled to integers of 0.01 (the precision of the JSON
+ * payload), battery voltage in mV. Every integer is a zigzag varint (LEB128).
+ * Per-wake telemetry (health, memory, RSSI) is not part of a series.
+ */
+
+#pragma once
+
+#include "measurement.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define TSCODEC_MAGIC 0x54
+#define TSCODEC_VERSION 1
+#define TSCODEC_MAX_SAMPLES 255
+
+    /**
+     * Encode a batch of measurements of one node, oldest first
+     *
+     * @param m Measurements
+     * @param count Number of measurements (1..TSCODEC_MAX_SAMPLES)
+     * @param now Device time when the batch is sent (s), gives the sample ages
+     * @param buf Output buffer
+     * @param cap Size of buf
+     * @return Encoded length, 0 if buf is too small or the batch is invalid
+     */
+    size_t tscodec_encode(const meteo_measurement_t *m, size_t count, int64_t now,
+                          uint8_t *buf, size_t cap);
+
+    /**
+     * Decode a batch
+     *
+     * Decoded measurements are initialized with measurement_init(); the
+     * encoded fields and sample_age_s are set, device_id is left empty.
+     *
+     * @param buf Encoded batch
+     * @param len Number of bytes
+     * @param m Output measurements
+     * @param max Capacity of m
+     * @return Number of measurements, 0 if the batch is invalid or does not fit
+     */
+    size_t tscodec_decode(const uint8_t *buf, size_t len, meteo_measurement_t *m, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
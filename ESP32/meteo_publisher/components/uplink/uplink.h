@@ -0,0 +1,69 @@
+/**
+ * @file uplink.h
+ * @brief Transport interface for sending measurements
+ *
+ * Each transport (MQTT, CoAP, ...) exposes one uplink_transport_t.
+ * The application picks one from Kconfig and drives a session:
+ * connect() once, send() one or more measurements, disconnect().
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "measurement.h"
+#include "payload.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Longest JSON message of a transport, raw sensor frames and I2C trace included
+#ifdef CONFIG_SENSOR_RAW_CAPTURE
+#define UPLINK_RAW_LEN PAYLOAD_RAW_MAX_LEN
+#else
+#define UPLINK_RAW_LEN 0
+#endif
+#ifdef CONFIG_I2C_TRACE_PAYLOAD
+#define UPLINK_I2C_LEN PAYLOAD_I2C_MAX_LEN
+#else
+#define UPLINK_I2C_LEN 0
+#endif
+#define UPLINK_JSON_MAX_LEN (PAYLOAD_JSON_MAX_LEN + UPLINK_RAW_LEN + UPLINK_I2C_LEN)
+
+    typedef struct
+    {
+        const char *name; ///< Short name reported in the payload
+
+        /**
+         * Open a session (connect / resolve the gateway)
+         * @param device_id Node name used in topics / URIs
+         */
+        esp_err_t (*connect)(const char *device_id);
+
+        /**
+         * Send one measurement in the open session
+         * The transport sets m->transport before formatting. The MQTT
+         * transport keeps a transport already set by the ESP-NOW gateway,
+         * which forwards measurements received over another link.
+         */
+        esp_err_t (*send)(meteo_measurement_t *m);
+
+        /**
+         * Send measurements of this node as one compressed batch (tscodec.h)
+         * Optional, NULL if the transport has no batch format; the
+         * application then sends them one by one.
+         */
+        esp_err_t (*send_batch)(const meteo_measurement_t *m, size_t count);
+
+        /**
+         * Wait for outstanding acknowledgements and close the session
+         */
+        void (*disconnect)(void);
+    } uplink_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
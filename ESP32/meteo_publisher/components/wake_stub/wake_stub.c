@@ -0,0 +1,324 @@
+/**
+ * @file wake_stub.c
+ * @brief Deep-sleep wake stub implementation
+ *
+ * Everything called from esp_wake_deep_sleep() must live in RTC fast memory
+ * (RTC_IRAM_ATTR) or ROM, and may only touch RTC_DATA_ATTR variables:
+ * flash cache and the app's DRAM are not available yet.
+ */
+
+#include "wake_stub.h"
+
+#ifdef CONFIG_WAKE_STUB_ENABLED
+
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+#include "esp_sleep.h"
+#include "esp_wake_stub.h"
+#include "soc/gpio_reg.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/io_mux_reg.h"
+#include <string.h>
+
+// BMP280 registers (see components/bmp280/bmp280.c)
+#define BMP280_REG_PRESS_MSB 0xF7
+#define BMP280_REG_CTRL_MEAS 0xF4
+#define BMP280_REG_STATUS 0xF3
+#define BMP280_STATUS_MEASURING 0x08
+#define BMP280_ADC_SKIPPED 0x80000
+
+// ~100 kHz bit-banged I²C
+#define STUB_I2C_HALF_PERIOD_US 5
+#define STUB_STATUS_POLLS 10
+
+// ESP32-S3 IO_MUX registers are laid out linearly after a 4-byte header
+#define STUB_IO_MUX_REG(pin) (REG_IO_MUX_BASE + 0x4 + (pin) * 4)
+
+typedef struct
+{
+    bool armed;
+    uint8_t count;
+    uint8_t boot_reason;
+    wake_stub_config_t config;
+    wake_stub_sample_t samples[WAKE_STUB_CAPACITY];
+} wake_stub_state_t;
+
+static RTC_DATA_ATTR wake_stub_state_t s_state;
+
+// ---------------------------------------------------------------------------
+// Bit-banged open-drain I²C: output latch stays low, the line is pulled low
+// by enabling the output driver and released by disabling it.
+// ---------------------------------------------------------------------------
+
+static FORCE_INLINE_ATTR void stub_line_low(uint32_t mask)
+{
+    REG_WRITE(GPIO_ENABLE_W1TS_REG, mask);
+}
+
+static FORCE_INLINE_ATTR void stub_line_release(uint32_t mask)
+{
+    REG_WRITE(GPIO_ENABLE_W1TC_REG, mask);
+}
+
+static FORCE_INLINE_ATTR bool stub_line_read(uint32_t mask)
+{
+    return (REG_READ(GPIO_IN_REG) & mask) != 0;
+}
+
+static FORCE_INLINE_ATTR void stub_delay(void)
+{
+    esp_rom_delay_us(STUB_I2C_HALF_PERIOD_US);
+}
+
+static RTC_IRAM_ATTR void stub_pin_setup(uint32_t pin)
+{
+    uint32_t mux = STUB_IO_MUX_REG(pin);
+    PIN_FUNC_SELECT(mux, PIN_FUNC_GPIO);
+    PIN_INPUT_ENABLE(mux);
+    PIN_PULLUP_EN(mux);
+
+    REG_WRITE(GPIO_FUNC0_OUT_SEL_CFG_REG + pin * 4, SIG_GPIO_OUT_IDX);
+    REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << pin);
+    REG_WRITE(GPIO_ENABLE_W1TC_REG, 1UL << pin);
+}
+
+static RTC_IRAM_ATTR void stub_i2c_start(uint32_t sda, uint32_t scl)
+{
+    stub_line_release(sda);
+    stub_line_release(scl);
+    stub_delay();
+    stub_line_low(sda);
+    stub_delay();
+    stub_line_low(scl);
+    stub_delay();
+}
+
+static RTC_IRAM_ATTR void stub_i2c_stop(uint32_t sda, uint32_t scl)
+{
+    stub_line_low(sda);
+    stub_delay();
+    stub_line_release(scl);
+    stub_delay();
+    stub_line_release(sda);
+    stub_delay();
+}
+
+static RTC_IRAM_ATTR bool stub_i2c_write_byte(uint32_t sda, uint32_t scl, uint8_t byte)
+{
+    for (int bit = 7; bit >= 0; bit--)
+    {
+        if (byte & (1 << bit))
+        {
+            stub_line_release(sda);
+        }
+        else
+        {
+            stub_line_low(sda);
+        }
+        stub_delay();
+        stub_line_release(scl);
+        stub_delay();
+        stub_line_low(scl);
+    }
+
+    // ACK clock: device pulls SDA low
+    stub_line_release(sda);
+    stub_delay();
+    stub_line_release(scl);
+    stub_delay();
+    bool ack = !stub_line_read(sda);
+    stub_line_low(scl);
+    stub_delay();
+
+    return ack;
+}
+
+static RTC_IRAM_ATTR uint8_t stub_i2c_read_byte(uint32_t sda, uint32_t scl, bool ack)
+{
+    uint8_t byte = 0;
+
+    stub_line_release(sda);
+    for (int bit = 0; bit < 8; bit++)
+    {
+        stub_delay();
+        stub_line_release(scl);
+        stub_delay();
+        byte = (byte << 1) | (stub_line_read(sda) ? 1 : 0);
+        stub_line_low(scl);
+    }
+
+    if (ack)
+    {
+        stub_line_low(sda);
+    }
+    stub_delay();
+    stub_line_release(scl);
+    stub_delay();
+    stub_line_low(scl);
+    stub_line_release(sda);
+
+    return byte;
+}
+
+static RTC_IRAM_ATTR bool stub_write_reg(uint32_t sda, uint32_t scl, uint8_t addr,
+                                         uint8_t reg, uint8_t value)
+{
+    stub_i2c_start(sda, scl);
+    bool ok = stub_i2c_write_byte(sda, scl, addr << 1) &&
+              stub_i2c_write_byte(sda, scl, reg) &&
+              stub_i2c_write_byte(sda, scl, value);
+    stub_i2c_stop(sda, scl);
+    return ok;
+}
+
+static RTC_IRAM_ATTR bool stub_read_regs(uint32_t sda, uint32_t scl, uint8_t addr,
+                                         uint8_t reg, uint8_t *data, int len)
+{
+    stub_i2c_start(sda, scl);
+    bool ok = stub_i2c_write_byte(sda, scl, addr << 1) &&
+              stub_i2c_write_byte(sda, scl, reg);
+    if (ok)
+    {
+        // Repeated start, then read
+        stub_i2c_start(sda, scl);
+        ok = stub_i2c_write_byte(sda, scl, (addr << 1) | 1);
+    }
+    if (ok)
+    {
+        for (int i = 0; i < len; i++)
+        {
+            data[i] = stub_i2c_read_byte(sda, scl, i < len - 1);
+        }
+    }
+    stub_i2c_stop(sda, scl);
+    return ok;
+}
+
+static FORCE_INLINE_ATTR uint32_t stub_abs_diff(uint32_t a, uint32_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/**
+ * Forced BMP280 measurement, or the latest one in normal mode
+ * Returns false on NACK or skipped measurement.
+ */
+static RTC_IRAM_ATTR bool stub_sample_bmp280(wake_stub_sample_t *sample)
+{
+    const wake_stub_config_t *cfg = &s_state.config;
+    uint32_t sda = 1UL << cfg->sda_pin;
+    uint32_t scl = 1UL << cfg->scl_pin;
+
+    stub_pin_setup(cfg->sda_pin);
+    stub_pin_setup(cfg->scl_pin);
+
+    if (cfg->ctrl_meas != 0)
+    {
+        if (!stub_write_reg(sda, scl, cfg->i2c_addr, BMP280_REG_CTRL_MEAS, cfg->ctrl_meas))
+        {
+            return false;
+        }
+
+        esp_rom_delay_us(cfg->meas_time_ms * 1000U);
+
+        uint8_t status = BMP280_STATUS_MEASURING;
+        for (int i = 0; i < STUB_STATUS_POLLS && (status & BMP280_STATUS_MEASURING); i++)
+        {
+            if (!stub_read_regs(sda, scl, cfg->i2c_addr, BMP280_REG_STATUS, &status, 1))
+            {
+                return false;
+            }
+            if (status & BMP280_STATUS_MEASURING)
+            {
+                esp_rom_delay_us(1000);
+            }
+        }
+    }
+
+    uint8_t data[6];
+    if (!stub_read_regs(sda, scl, cfg->i2c_addr, BMP280_REG_PRESS_MSB, data, 6))
+    {
+        return false;
+    }
+
+    sample->adc_P = ((uint32_t)data[0] << 12) | ((uint32_t)data[1] << 4) | (data[2] >> 4);
+    sample->adc_T = ((uint32_t)data[3] << 12) | ((uint32_t)data[4] << 4) | (data[5] >> 4);
+
+    return sample->adc_P != BMP280_ADC_SKIPPED && sample->adc_T != BMP280_ADC_SKIPPED;
+}
+
+void RTC_IRAM_ATTR esp_wake_deep_sleep(void)
+{
+    if (!s_state.armed || s_state.count >= WAKE_STUB_CAPACITY)
+    {
+        esp_default_wake_deep_sleep();
+        return;
+    }
+
+    wake_stub_sample_t *sample = &s_state.samples[s_state.count];
+    if (!stub_sample_bmp280(sample))
+    {
+        s_state.boot_reason = WAKE_STUB_BOOT_BUS_ERROR;
+        esp_default_wake_deep_sleep();
+        return;
+    }
+    s_state.count++;
+
+    const wake_stub_config_t *cfg = &s_state.config;
+    if (stub_abs_diff(sample->adc_T, cfg->ref_adc_T) > cfg->delta_adc_T ||
+        stub_abs_diff(sample->adc_P, cfg->ref_adc_P) > cfg->delta_adc_P)
+    {
+        s_state.boot_reason = WAKE_STUB_BOOT_THRESHOLD;
+        esp_default_wake_deep_sleep();
+        return;
+    }
+
+    if (s_state.count >= WAKE_STUB_CAPACITY)
+    {
+        s_state.boot_reason = WAKE_STUB_BOOT_FULL;
+        esp_default_wake_deep_sleep();
+        return;
+    }
+
+    // Back to sleep without booting
+    esp_wake_stub_set_wakeup_time(cfg->sleep_us);
+    esp_wake_stub_sleep(&esp_wake_deep_sleep);
+}
+
+// ---------------------------------------------------------------------------
+// Application side
+// ---------------------------------------------------------------------------
+
+void wake_stub_arm(const wake_stub_config_t *config)
+{
+    memcpy(&s_state.config, config, sizeof(wake_stub_config_t));
+    s_state.boot_reason = WAKE_STUB_BOOT_NONE;
+    s_state.armed = true;
+}
+
+void wake_stub_disarm(void)
+{
+    s_state.armed = false;
+}
+
+size_t wake_stub_get_samples(const wake_stub_sample_t **samples)
+{
+    if (samples != NULL)
+    {
+        *samples = s_state.samples;
+    }
+    return s_state.count;
+}
+
+wake_stub_boot_reason_t wake_stub_boot_reason(void)
+{
+    return (wake_stub_boot_reason_t)s_state.boot_reason;
+}
+
+void wake_stub_clear(void)
+{
+    s_state.count = 0;
+    s_state.boot_reason = WAKE_STUB_BOOT_NONE;
+}
+
+#endif // CONFIG_WAKE_STUB_ENABLED
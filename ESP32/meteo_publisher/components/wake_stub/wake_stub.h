@@ -0,0 +1,105 @@
+/**
+ * @file wake_stub.h
+ * @brief Deep-sleep wake stub sampling the BMP280 without a full boot
+ *
+ * The stub runs from RTC fast memory right after a timer wake-up, before
+ * the bootloader. It bit-bangs a forced BMP280 measurement (register level,
+ * no ESP-IDF drivers), appends the raw ADC values to an RTC buffer and goes
+ * straight back to deep sleep. The full application only boots when the
+ * buffer is full, a reading moves past the configured threshold, or the
+ * bus transaction fails. The application then compensates and publishes
+ * the buffered raw samples.
+ *
+ * The BMP280 keeps the oversampling/filter configuration written by the
+ * application while the ESP32 sleeps; the stub only triggers measurements,
+ * or only reads the latest one when the sensor runs in normal mode.
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifdef CONFIG_WAKE_STUB_BATCH_SIZE
+#define WAKE_STUB_CAPACITY CONFIG_WAKE_STUB_BATCH_SIZE
+#else
+#define WAKE_STUB_CAPACITY 5
+#endif
+
+    /**
+     * Reasons the stub handed over to the full application
+     */
+    typedef enum
+    {
+        WAKE_STUB_BOOT_NONE = 0,      ///< Stub not armed (normal boot)
+        WAKE_STUB_BOOT_FULL = 1,      ///< Sample buffer full
+        WAKE_STUB_BOOT_THRESHOLD = 2, ///< Reading crossed a threshold
+        WAKE_STUB_BOOT_BUS_ERROR = 3, ///< NACK or invalid ADC value
+    } wake_stub_boot_reason_t;
+
+    /**
+     * Raw BMP280 sample captured by the stub
+     */
+    typedef struct
+    {
+        uint32_t adc_T; ///< Raw 20-bit temperature
+        uint32_t adc_P; ///< Raw 20-bit pressure
+    } wake_stub_sample_t;
+
+    /**
+     * Stub configuration, copied to RTC memory by wake_stub_arm()
+     */
+    typedef struct
+    {
+        uint8_t sda_pin;       ///< I²C SDA GPIO (0-31)
+        uint8_t scl_pin;       ///< I²C SCL GPIO (0-31)
+        uint8_t i2c_addr;      ///< BMP280 I²C address
+        uint8_t ctrl_meas;     ///< ctrl_meas value triggering a forced measurement, 0 in normal mode
+        uint16_t meas_time_ms; ///< Measurement time to wait before reading
+        uint32_t ref_adc_T;    ///< Raw temperature of the last published sample
+        uint32_t ref_adc_P;    ///< Raw pressure of the last published sample
+        uint32_t delta_adc_T;  ///< Boot when |adc_T - ref_adc_T| exceeds this
+        uint32_t delta_adc_P;  ///< Boot when |adc_P - ref_adc_P| exceeds this
+        uint64_t sleep_us;     ///< Deep sleep duration between stub samples
+    } wake_stub_config_t;
+
+    /**
+     * Arm the stub for the next deep sleep
+     *
+     * @param config Stub configuration (copied)
+     */
+    void wake_stub_arm(const wake_stub_config_t *config);
+
+    /**
+     * Disarm the stub: the next wake boots the application directly
+     */
+    void wake_stub_disarm(void);
+
+    /**
+     * Get the samples buffered by the stub, oldest first
+     *
+     * @param samples Receives a pointer to the RTC buffer
+     * @return Number of samples
+     */
+    size_t wake_stub_get_samples(const wake_stub_sample_t **samples);
+
+    /**
+     * Why the stub booted the application on this wake
+     */
+    wake_stub_boot_reason_t wake_stub_boot_reason(void);
+
+    /**
+     * Drop buffered samples (after they were published)
+     */
+    void wake_stub_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
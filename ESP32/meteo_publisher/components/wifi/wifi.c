@@ -1,4 +1,11 @@
 #include "wifi.h"
+#include "sdkconfig.h"
+
+// Under QEMU wifi_openeth.c implements the API instead
+#ifndef CONFIG_NET_OPENETH
+
+#include "evlog.h"
+#include "nvs_lazy.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
@@ -12,19 +19,58 @@ static EventGroupHandle_t wifi_event_group;
 
 static const char *TAG = "WIFI";
 
+static uint16_t s_disconnects;
+static uint8_t s_last_reason;
+
+// Requested and driver default TX power (0.25 dBm), 0 = not set
+static int8_t s_tx_power;
+static int8_t s_tx_power_default;
+
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data)
 {
   if (event_id == WIFI_EVENT_STA_START)
+  {
+    // The limit only holds once the station runs
+    esp_wifi_get_max_tx_power(&s_tx_power_default);
+    if (s_tx_power != 0)
+      esp_wifi_set_max_tx_power(s_tx_power);
+    esp_wifi_connect();
+  }
+  else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+  {
+    // Auth failure, AP not found, beacon timeout... keep the reason for the
+    // health summary and try again
+    wifi_event_sta_disconnected_t *event = event_data;
+    if (s_disconnects < UINT16_MAX)
+      s_disconnects++;
+    s_last_reason = (uint8_t)event->reason;
+    EVLOG1(EVLOG_WIFI_DISCONNECTED, event->reason);
+    ESP_LOGW(TAG, "Disconnected, reason %u", (unsigned)event->reason);
+    if (s_tx_power != 0 && s_tx_power < s_tx_power_default)
+    {
+      // A reduced TX power may be the cause: retry at full power
+      s_tx_power = 0;
+      esp_wifi_set_max_tx_power(s_tx_power_default);
+      ESP_LOGW(TAG, "TX power back to %d.%02d dBm", s_tx_power_default / 4,
+               (s_tx_power_default % 4) * 25);
+    }
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
     esp_wifi_connect();
+  }
   else if (event_id == IP_EVENT_STA_GOT_IP)
     xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
 }
 
-void wifi_init_and_connect(void)
+esp_err_t wifi_init_and_connect(uint32_t timeout_ms)
 {
   wifi_event_group = xEventGroupCreate();
 
+  // Wi-Fi keeps its config and the PHY its RF calibration in NVS
+#if CONFIG_ESP_WIFI_NVS_ENABLED || CONFIG_ESP_PHY_CALIBRATION_AND_DATA_STORAGE
+  ESP_ERROR_CHECK(nvs_lazy_init());
+#endif
+
   esp_netif_create_default_wifi_sta();
   wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
   esp_wifi_init(&cfg);
@@ -46,10 +92,19 @@ void wifi_init_and_connect(void)
   esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
   esp_wifi_start();
 
-  xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT, false, true,
-                      portMAX_DELAY);
+  EventBits_t bits = xEventGroupWaitBits(
+      wifi_event_group, WIFI_CONNECTED_BIT, false, true,
+      timeout_ms == 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+  if (!(bits & WIFI_CONNECTED_BIT))
+  {
+    ESP_LOGE(TAG, "Not connected after %lu ms (%u disconnects, reason %u)",
+             (unsigned long)timeout_ms, s_disconnects, s_last_reason);
+    return ESP_ERR_TIMEOUT;
+  }
 
+  EVLOG0(EVLOG_WIFI_CONNECTED);
   ESP_LOGI(TAG, "Wi-Fi connected");
+  return ESP_OK;
 }
 
 int8_t wifi_get_rssi(void)
@@ -61,6 +116,29 @@ int8_t wifi_get_rssi(void)
     ESP_LOGE(TAG, "Failed to get AP info: %s", esp_err_to_name(err));
     return 0;
   }
+  EVLOG1(EVLOG_WIFI_RSSI, (int32_t)ap_info.rssi);
   ESP_LOGI(TAG, "RSSI: %d dBm", ap_info.rssi);
   return ap_info.rssi;
 }
+
+void wifi_set_tx_power(int8_t quarter_dbm)
+{
+  s_tx_power = quarter_dbm;
+}
+
+int8_t wifi_get_tx_power(void)
+{
+  int8_t power = 0;
+  if (esp_wifi_get_max_tx_power(&power) != ESP_OK)
+    return 0;
+  return power;
+}
+
+uint16_t wifi_get_disconnects(uint8_t *last_reason)
+{
+  if (last_reason != NULL)
+    *last_reason = s_last_reason;
+  return s_disconnects;
+}
+
+#endif
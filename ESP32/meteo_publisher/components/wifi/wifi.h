@@ -1,6 +1,34 @@
 #pragma once
 
+#include "esp_err.h"
 #include <stdint.h>
 
-void wifi_init_and_connect(void);
+/**
+ * Start the station and wait for an IP address
+ * Disconnects are recorded and reconnected until the timeout.
+ * @param timeout_ms Time to wait, 0 waits forever
+ * @return ESP_OK when connected, ESP_ERR_TIMEOUT otherwise (the station keeps trying)
+ */
+esp_err_t wifi_init_and_connect(uint32_t timeout_ms);
+
 int8_t wifi_get_rssi(void);
+
+/**
+ * Limit the TX power of the next wifi_init_and_connect()
+ * After a disconnect the station retries at the driver default.
+ * @param quarter_dbm Maximum TX power in 0.25 dBm (8..84), 0 for the driver default
+ */
+void wifi_set_tx_power(int8_t quarter_dbm);
+
+/**
+ * TX power limit in effect
+ * @return Maximum TX power in 0.25 dBm, 0 if the station is not started
+ */
+int8_t wifi_get_tx_power(void);
+
+/**
+ * Disconnects seen since wifi_init_and_connect()
+ * @param last_reason Set to the last wifi_err_reason_t, 0 if none (may be NULL)
+ * @return Number of disconnect events
+ */
+uint16_t wifi_get_disconnects(uint8_t *last_reason);
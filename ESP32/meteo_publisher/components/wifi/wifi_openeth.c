@@ -0,0 +1,108 @@
+/**
+ * @file wifi_openeth.c
+ * @brief wifi.h over the OpenCores Ethernet MAC emulated by QEMU
+ *
+ * With CONFIG_NET_OPENETH the station is replaced by the openeth MAC and
+ * its DP83848 PHY, so the firmware runs under QEMU with user networking
+ * (the host is 10.0.2.2). No radio: RSSI and TX power read 0.
+ */
+
+#include "wifi.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_NET_OPENETH
+
+#include "evlog.h"
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "freertos/event_groups.h"
+
+static EventGroupHandle_t eth_event_group;
+#define ETH_CONNECTED_BIT BIT0
+
+static const char *TAG = "ETH";
+
+static uint16_t s_disconnects;
+
+static void eth_event_handler(void *arg, esp_event_base_t event_base,
+                              int32_t event_id, void *event_data)
+{
+  if (event_base == ETH_EVENT && event_id == ETHERNET_EVENT_DISCONNECTED)
+  {
+    if (s_disconnects < UINT16_MAX)
+      s_disconnects++;
+    xEventGroupClearBits(eth_event_group, ETH_CONNECTED_BIT);
+    ESP_LOGW(TAG, "Link down");
+  }
+  else if (event_base == IP_EVENT && event_id == IP_EVENT_ETH_GOT_IP)
+    xEventGroupSetBits(eth_event_group, ETH_CONNECTED_BIT);
+}
+
+esp_err_t wifi_init_and_connect(uint32_t timeout_ms)
+{
+  eth_event_group = xEventGroupCreate();
+
+  esp_netif_config_t netif_cfg = ESP_NETIF_DEFAULT_ETH();
+  esp_netif_t *netif = esp_netif_new(&netif_cfg);
+
+  eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+  eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+  phy_config.autonego_timeout_ms = 100; // Emulated PHY, link is up at once
+  esp_eth_mac_t *mac = esp_eth_mac_new_openeth(&mac_config);
+  esp_eth_phy_t *phy = esp_eth_phy_new_dp83848(&phy_config);
+
+  esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
+  esp_eth_handle_t eth_handle = NULL;
+  esp_err_t ret = esp_eth_driver_install(&eth_config, &eth_handle);
+  if (ret != ESP_OK)
+  {
+    ESP_LOGE(TAG, "openeth driver install failed: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  esp_netif_attach(netif, esp_eth_new_netif_glue(eth_handle));
+
+  esp_event_handler_register(ETH_EVENT, ETHERNET_EVENT_DISCONNECTED,
+                             &eth_event_handler, NULL);
+  esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, &eth_event_handler,
+                             NULL);
+  esp_eth_start(eth_handle);
+
+  EventBits_t bits = xEventGroupWaitBits(
+      eth_event_group, ETH_CONNECTED_BIT, false, true,
+      timeout_ms == 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+  if (!(bits & ETH_CONNECTED_BIT))
+  {
+    ESP_LOGE(TAG, "No IP address after %lu ms", (unsigned long)timeout_ms);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  EVLOG0(EVLOG_WIFI_CONNECTED);
+  ESP_LOGI(TAG, "openeth connected");
+  return ESP_OK;
+}
+
+int8_t wifi_get_rssi(void)
+{
+  return 0;
+}
+
+void wifi_set_tx_power(int8_t quarter_dbm)
+{
+  (void)quarter_dbm;
+}
+
+int8_t wifi_get_tx_power(void)
+{
+  return 0;
+}
+
+uint16_t wifi_get_disconnects(uint8_t *last_reason)
+{
+  if (last_reason != NULL)
+    *last_reason = 0;
+  return s_disconnects;
+}
+
+#endif
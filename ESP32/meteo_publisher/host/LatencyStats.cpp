@@ -0,0 +1,37 @@
+/**
+ * @file LatencyStats.cpp
+ * @brief Latency samples with percentile summary
+ */
+
+#include "LatencyStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+int64_t LatencyStats::percentile(double p) const
+{
+    if (m_samples.empty())
+    {
+        return 0;
+    }
+
+    // Sorting lazily keeps add() O(1) in the event loop
+    std::sort(m_samples.begin(), m_samples.end());
+
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * m_samples.size()));
+    rank = std::min(std::max<size_t>(rank, 1), m_samples.size());
+    return m_samples[rank - 1];
+}
+
+void LatencyStats::print_header()
+{
+    std::printf("  %-22s %8s %9s %9s %9s %9s\n", "latency (ms)", "n", "p50", "p90", "p99", "max");
+}
+
+void LatencyStats::print_row(const char *name) const
+{
+    std::printf("  %-22s %8zu %9.2f %9.2f %9.2f %9.2f\n", name, count(),
+                percentile(50) / 1000.0, percentile(90) / 1000.0,
+                percentile(99) / 1000.0, percentile(100) / 1000.0);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file LatencyStats.hpp
+ * @brief Latency samples with percentile summary
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LatencyStats
+{
+public:
+    void add(int64_t us) { m_samples.push_back(us); }
+    void clear() { m_samples.clear(); }
+    size_t count() const { return m_samples.size(); }
+
+    /**
+     * Percentile in microseconds (nearest rank), 0 when empty
+     * @param p Percentile 0..100
+     */
+    int64_t percentile(double p) const;
+
+    /**
+     * Print "name  n  p50  p90  p99  max" in milliseconds
+     */
+    void print_row(const char *name) const;
+
+    static void print_header();
+
+private:
+    mutable std::vector<int64_t> m_samples;
+};
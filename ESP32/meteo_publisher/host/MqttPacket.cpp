@@ -0,0 +1,122 @@
+/**
+ * @file MqttPacket.cpp
+ * @brief Minimal MQTT 3.1.1 packet encoding/decoding
+ */
+
+#include "MqttPacket.hpp"
+
+namespace mqtt
+{
+
+static void put_remaining_length(std::vector<uint8_t> &out, size_t len)
+{
+    do
+    {
+        uint8_t byte = len % 128;
+        len /= 128;
+        if (len > 0)
+        {
+            byte |= 0x80;
+        }
+        out.push_back(byte);
+    } while (len > 0);
+}
+
+static void put_u16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back(v >> 8);
+    out.push_back(v & 0xFF);
+}
+
+static void put_string(std::vector<uint8_t> &out, const std::string &s)
+{
+    put_u16(out, static_cast<uint16_t>(s.size()));
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+void encode_connect(std::vector<uint8_t> &out, const std::string &client_id,
+                    const std::string &username, const std::string &password,
+                    uint16_t keepalive_s)
+{
+    std::vector<uint8_t> body;
+    put_string(body, "MQTT");
+    body.push_back(4); // Protocol level 3.1.1
+
+    uint8_t flags = 0x02; // Clean session
+    if (!username.empty())
+    {
+        flags |= 0x80;
+        if (!password.empty())
+        {
+            flags |= 0x40;
+        }
+    }
+    body.push_back(flags);
+    put_u16(body, keepalive_s);
+
+    put_string(body, client_id);
+    if (flags & 0x80)
+    {
+        put_string(body, username);
+    }
+    if (flags & 0x40)
+    {
+        put_string(body, password);
+    }
+
+    out.push_back(CONNECT << 4);
+    put_remaining_length(out, body.size());
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+void encode_publish_qos1(std::vector<uint8_t> &out, const std::string &topic,
+                         uint16_t packet_id, const char *payload, size_t len)
+{
+    out.push_back(PUBLISH << 4 | 0x02); // QoS 1
+    put_remaining_length(out, 2 + topic.size() + 2 + len);
+    put_string(out, topic);
+    put_u16(out, packet_id);
+    out.insert(out.end(), payload, payload + len);
+}
+
+void encode_disconnect(std::vector<uint8_t> &out)
+{
+    out.push_back(DISCONNECT << 4);
+    out.push_back(0);
+}
+
+bool decode_next(std::vector<uint8_t> &buf, Packet &packet)
+{
+    size_t len = 0;
+    size_t pos = 1;
+    int shift = 0;
+
+    // Remaining length: up to 4 bytes, 7 bits each
+    while (true)
+    {
+        if (pos >= buf.size() || shift > 21)
+        {
+            return false;
+        }
+        uint8_t byte = buf[pos++];
+        len |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+    }
+
+    if (buf.size() < pos + len)
+    {
+        return false;
+    }
+
+    packet.type = static_cast<PacketType>(buf[0] >> 4);
+    packet.flags = buf[0] & 0x0F;
+    packet.body.assign(buf.begin() + pos, buf.begin() + pos + len);
+    buf.erase(buf.begin(), buf.begin() + pos + len);
+    return true;
+}
+
+} // namespace mqtt
@@ -0,0 +1,64 @@
+/**
+ * @file MqttPacket.hpp
+ * @brief Minimal MQTT 3.1.1 packet encoding/decoding for the host tools
+ *
+ * Only the packets a sensor node exchanges with the broker in one wake:
+ * CONNECT/CONNACK, PUBLISH (QoS 1)/PUBACK, DISCONNECT.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mqtt
+{
+
+enum PacketType : uint8_t
+{
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    DISCONNECT = 14,
+};
+
+/**
+ * Append a CONNECT packet (clean session)
+ * Empty username/password are omitted.
+ */
+void encode_connect(std::vector<uint8_t> &out, const std::string &client_id,
+                    const std::string &username, const std::string &password,
+                    uint16_t keepalive_s);
+
+/**
+ * Append a QoS 1 PUBLISH packet
+ */
+void encode_publish_qos1(std::vector<uint8_t> &out, const std::string &topic,
+                         uint16_t packet_id, const char *payload, size_t len);
+
+/**
+ * Append a DISCONNECT packet
+ */
+void encode_disconnect(std::vector<uint8_t> &out);
+
+/**
+ * One packet parsed from the receive buffer
+ */
+struct Packet
+{
+    PacketType type;
+    uint8_t flags;
+    std::vector<uint8_t> body;
+};
+
+/**
+ * Extract the next complete packet from the front of buf
+ *
+ * @return true if a packet was extracted (and removed from buf)
+ */
+bool decode_next(std::vector<uint8_t> &buf, Packet &packet);
+
+} // namespace mqtt
@@ -0,0 +1,80 @@
+/**
+ * @file SimNode.cpp
+ * @brief Simulated sensor node
+ */
+
+#include "SimNode.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+SimNode::SimNode(int index, const char *prefix, const SimSchedule &schedule, std::mt19937 &rng)
+    : m_schedule(schedule), m_next_wake_us(0), m_generation(0), m_last_awake_ms(0)
+{
+    std::snprintf(m_device_id, sizeof(m_device_id), "%s%05d", prefix, index);
+
+    std::uniform_real_distribution<double> ppm(-schedule.clock_ppm, schedule.clock_ppm);
+    m_clock_scale = 1.0 + ppm(rng) * 1e-6;
+
+    // Indoor and outdoor nodes, different floors
+    std::uniform_real_distribution<float> temp(5.0f, 25.0f);
+    std::uniform_real_distribution<float> rh(30.0f, 80.0f);
+    std::uniform_real_distribution<float> press(99500.0f, 102000.0f);
+    std::uniform_real_distribution<float> rssi(-85.0f, -45.0f);
+    m_temp = temp(rng);
+    m_rh = rh(rng);
+    m_press = press(rng);
+    m_rssi = rssi(rng);
+    m_bmp_offset = 0.0f;
+}
+
+void SimNode::start(int64_t now_us, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int64_t> phase(0, m_schedule.interval_us - 1);
+    m_next_wake_us = now_us + phase(rng);
+    m_generation++;
+}
+
+void SimNode::cold_boot(int64_t now_us, int64_t spread_us, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int64_t> boot(0, spread_us > 0 ? spread_us : 0);
+    m_next_wake_us = now_us + boot(rng);
+    m_last_awake_ms = 0;
+    m_generation++;
+}
+
+void SimNode::sleep(int64_t now_us, int64_t awake_us, std::mt19937 &rng)
+{
+    std::normal_distribution<double> jitter(0.0, static_cast<double>(m_schedule.jitter_us));
+    int64_t sleep_us = static_cast<int64_t>(m_schedule.interval_us * m_clock_scale + jitter(rng));
+
+    m_next_wake_us = now_us + (sleep_us > 0 ? sleep_us : 0);
+    m_last_awake_ms = static_cast<uint32_t>(awake_us / 1000);
+    m_generation++;
+}
+
+void SimNode::measure(meteo_measurement_t *m, int64_t wall_time_s, std::mt19937 &rng)
+{
+    std::normal_distribution<float> step(0.0f, 1.0f);
+
+    // Random walk around the node's climate, sensor offset drifts slowly
+    m_temp += 0.05f * step(rng);
+    m_rh = std::fmin(100.0f, std::fmax(0.0f, m_rh + 0.2f * step(rng)));
+    m_press += 5.0f * step(rng);
+    m_rssi = std::fmin(-30.0f, std::fmax(-95.0f, m_rssi + 0.5f * step(rng)));
+    m_bmp_offset += 0.001f * step(rng);
+
+    measurement_init(m);
+    std::snprintf(m->device_id, sizeof(m->device_id), "%s", m_device_id);
+    std::snprintf(m->fw, sizeof(m->fw), "sim");
+    m->ts_device = wall_time_s;
+    m->rssi = static_cast<int8_t>(std::lround(m_rssi));
+    m->free_heap = 210000 + static_cast<uint32_t>(std::fabs(step(rng)) * 2000.0f);
+    m->last_awake_ms = m_last_awake_ms;
+
+    m->aht20_temp = m_temp + 0.1f * step(rng);
+    m->aht20_rh = m_rh + 0.5f * step(rng);
+    m->bmp_temp = m_temp + 0.8f + m_bmp_offset + 0.02f * step(rng);
+    m->bmp_press = m_press + 2.0f * step(rng);
+    m->altitude_m = 44330.0f * (1.0f - std::pow(m->bmp_press / 101325.0f, 1.0f / 5.225f));
+}
@@ -0,0 +1,68 @@
+/**
+ * @file SimNode.hpp
+ * @brief Simulated sensor node: wake schedule and drifting sensor readings
+ */
+
+#pragma once
+
+#include "measurement.h"
+
+#include <cstdint>
+#include <random>
+
+/**
+ * Schedule parameters shared by all simulated nodes
+ */
+struct SimSchedule
+{
+    int64_t interval_us = 60000000; ///< CONFIG_PUBLISH_INTERVAL
+    int64_t jitter_us = 200000;     ///< Wake jitter (standard deviation)
+    double clock_ppm = 20000;       ///< RTC slow clock error spread (+/-)
+};
+
+class SimNode
+{
+public:
+    SimNode(int index, const char *prefix, const SimSchedule &schedule, std::mt19937 &rng);
+
+    /**
+     * Schedule the first wake at a random phase within one interval
+     */
+    void start(int64_t now_us, std::mt19937 &rng);
+
+    /**
+     * Cold boot of every node at once (power restored): next wake within
+     * spread_us of now, which re-synchronizes the fleet
+     */
+    void cold_boot(int64_t now_us, int64_t spread_us, std::mt19937 &rng);
+
+    /**
+     * The wake finished: deep sleep for one interval from now
+     * @param awake_us Awake time of this wake (reported in the next payload)
+     */
+    void sleep(int64_t now_us, int64_t awake_us, std::mt19937 &rng);
+
+    /**
+     * Take the measurement of the current wake
+     */
+    void measure(meteo_measurement_t *m, int64_t wall_time_s, std::mt19937 &rng);
+
+    int64_t next_wake_us() const { return m_next_wake_us; }
+    uint32_t generation() const { return m_generation; }
+    const char *device_id() const { return m_device_id; }
+
+private:
+    char m_device_id[MEASUREMENT_DEVICE_ID_LEN];
+    const SimSchedule &m_schedule;
+    double m_clock_scale;   ///< Per-node RTC error
+    int64_t m_next_wake_us;
+    uint32_t m_generation;  ///< Bumped on reschedule, invalidates queued wakes
+    uint32_t m_last_awake_ms;
+
+    // Environment: node-specific baseline plus random walk
+    float m_temp;
+    float m_rh;
+    float m_press;
+    float m_rssi;
+    float m_bmp_offset; ///< Slowly drifting sensor calibration offset
+};
@@ -0,0 +1,390 @@
+/**
+ * @file espnow_loopback.cpp
+ * @brief Host loopback of the ESP-NOW uplink: nodes, lossy air, gateway
+ *
+ * Runs the firmware's frame codec, stop-and-wait retransmission and the
+ * gateway's duplicate suppression against a simulated radio that drops,
+ * corrupts and delays frames, and a broker that fails publishes. Checks
+ * that every acknowledged measurement was forwarded exactly once and
+ * unchanged.
+ *
+ * Usage: espnow_loopback [--nodes N] [--frames N] [--loss P] [--ack-loss P]
+ *                        [--late P] [--corrupt P] [--broker-fail P]
+ *                        [--retries N] [--seed N]
+ * Exit status is non-zero when a check fails.
+ */
+
+#include "espnow_arq.h"
+#include "espnow_frame.h"
+#include "payload.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+struct Options
+{
+    int nodes = 8;
+    int frames = 2000;
+    double loss = 0.2;        // DATA frame lost on air
+    double ack_loss = 0.2;    // ACK lost on air
+    double late = 0.05;       // ACK arrives after the node's timeout
+    double corrupt = 0.02;    // DATA frame arrives with a flipped byte
+    double broker_fail = 0.1; // Gateway publish not acknowledged by the broker
+    int retries = 3;
+    unsigned seed = 1;
+};
+
+struct Stats
+{
+    unsigned tx_data = 0;
+    unsigned rx_invalid = 0;
+    unsigned rx_duplicate = 0;
+    unsigned publish_failed = 0;
+    unsigned forwarded = 0;
+    unsigned acked = 0;
+    unsigned gave_up = 0;
+    unsigned attempts_total = 0;
+};
+
+class Loopback;
+
+struct Node
+{
+    uint8_t mac[6];
+    uint16_t seq;
+    std::deque<std::vector<uint8_t>> rx;   // ACKs delivered to the node
+    std::vector<std::vector<uint8_t>> late; // ACKs still in flight
+    Loopback *loopback;
+};
+
+class Loopback
+{
+public:
+    explicit Loopback(const Options &opt) : m_opt(opt), m_rng(opt.seed)
+    {
+        espnow_dedup_init(&m_dedup);
+    }
+
+    bool chance(double p)
+    {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < p;
+    }
+
+    // Node -> air -> gateway; the gateway's ACK goes back through the air
+    bool transmit(Node &node, const uint8_t *frame, size_t len)
+    {
+        m_stats.tx_data++;
+        if (chance(m_opt.loss))
+        {
+            return true;
+        }
+
+        std::vector<uint8_t> air(frame, frame + len);
+        if (chance(m_opt.corrupt))
+        {
+            air[std::uniform_int_distribution<size_t>(0, len - 1)(m_rng)] ^= 0x5A;
+        }
+
+        uint8_t ack[ESPNOW_FRAME_HEADER_LEN];
+        size_t ack_len = gateway_receive(node.mac, air, ack, sizeof(ack));
+        if (ack_len == 0 || chance(m_opt.ack_loss))
+        {
+            return true;
+        }
+
+        std::vector<uint8_t> ack_frame(ack, ack + ack_len);
+        if (chance(m_opt.late))
+        {
+            node.late.push_back(ack_frame);
+        }
+        else
+        {
+            node.rx.push_back(ack_frame);
+        }
+        return true;
+    }
+
+    bool wait_ack(Node &node, uint16_t seq)
+    {
+        bool acked = false;
+        while (!node.rx.empty() && !acked)
+        {
+            espnow_frame_t frame;
+            const std::vector<uint8_t> &rx = node.rx.front();
+            acked = espnow_frame_decode(rx.data(), rx.size(), &frame) &&
+                    frame.type == ESPNOW_FRAME_ACK && frame.seq == seq;
+            node.rx.pop_front();
+        }
+
+        // Timeout: late ACKs show up while the node retransmits
+        if (!acked)
+        {
+            for (auto &ack : node.late)
+            {
+                node.rx.push_back(ack);
+            }
+            node.late.clear();
+        }
+        return acked;
+    }
+
+    // Same steps as gateway_handle() in espnow_gateway.c
+    size_t gateway_receive(const uint8_t *mac, const std::vector<uint8_t> &data,
+                           uint8_t *ack, size_t ack_cap)
+    {
+        espnow_frame_t frame;
+        if (!espnow_frame_decode(data.data(), data.size(), &frame) ||
+            frame.type != ESPNOW_FRAME_DATA)
+        {
+            m_stats.rx_invalid++;
+            return 0;
+        }
+
+        if (espnow_dedup_check(&m_dedup, mac, frame.seq))
+        {
+            m_stats.rx_duplicate++;
+            return espnow_frame_encode_ack(frame.seq, ack, ack_cap);
+        }
+
+        // No PUBACK: no ACK, the retransmission is forwarded again
+        if (chance(m_opt.broker_fail))
+        {
+            espnow_dedup_forget(&m_dedup, mac);
+            m_stats.publish_failed++;
+            return 0;
+        }
+
+        frame.measurement.transport = "espnow";
+        m_forwarded.push_back(frame.measurement);
+        m_stats.forwarded++;
+        return espnow_frame_encode_ack(frame.seq, ack, ack_cap);
+    }
+
+    Stats &stats() { return m_stats; }
+    const std::vector<meteo_measurement_t> &forwarded() const { return m_forwarded; }
+
+private:
+    Options m_opt;
+    std::mt19937 m_rng;
+    espnow_dedup_t m_dedup;
+    Stats m_stats;
+    std::vector<meteo_measurement_t> m_forwarded;
+};
+
+bool node_tx(void *ctx, const uint8_t *frame, size_t len)
+{
+    Node *node = static_cast<Node *>(ctx);
+    return node->loopback->transmit(*node, frame, len);
+}
+
+bool node_wait_ack(void *ctx, uint16_t seq, uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    Node *node = static_cast<Node *>(ctx);
+    return node->loopback->wait_ack(*node, seq);
+}
+
+meteo_measurement_t make_measurement(int node, int index, std::mt19937 &rng)
+{
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    meteo_measurement_t m;
+    measurement_init(&m);
+    std::snprintf(m.device_id, sizeof(m.device_id), "sim-node-%02d", node);
+    std::snprintf(m.fw, sizeof(m.fw), "loopback");
+    m.ts_device = 1700000000LL + index * 60LL;
+    m.sample_age_s = index % 3 == 0 ? 120 : 0;
+    m.last_awake_ms = 40 + index % 17;
+    m.free_heap = 200000 + node;
+    m.aht20_temp = 21.0f + noise(rng);
+    m.aht20_rh = 45.0f + noise(rng);
+    m.bmp_temp = 21.5f + noise(rng);
+    m.bmp_press = 101325.0f + 50.0f * noise(rng);
+    m.altitude_m = 12.0f + noise(rng);
+    if (index % 2 == 0)
+    {
+        // Optional field on every other frame
+        m.bmp_profile = MEASUREMENT_PROFILE_HIGH;
+        m.bmp_noise_pa = 1.3f;
+    }
+    if (index % 3 == 1)
+    {
+        m.battery_mv = static_cast<uint16_t>(3300 + index % 900);
+        m.power_tier = MEASUREMENT_TIER_SAVER;
+    }
+    if (index % 5 == 2)
+    {
+        m.health.reset_reason = 4; // ESP_RST_PANIC
+        m.health.wake_cause = 4;   // ESP_SLEEP_WAKEUP_TIMER
+        m.health.wifi_reason = 201;
+        m.health.failed_publishes = static_cast<uint16_t>(index % 7);
+        m.health.wifi_disconnects = static_cast<uint16_t>(index);
+        m.health.panics = 1;
+    }
+    if (index % 4 == 3)
+    {
+        m.memory.min_free_heap = 180000 + node;
+        m.memory.largest_block = 110000;
+        m.memory.free_internal = 190000;
+        m.memory.stack_main = 1200;
+        m.memory.stack_wifi = 2100;
+        m.memory.stack_tcpip = 1700;
+        m.memory.stack_event = 900;
+    }
+    m.transport = "espnow";
+    return m;
+}
+
+std::string to_json(const meteo_measurement_t &m)
+{
+    char buf[PAYLOAD_JSON_MAX_LEN];
+    payload_format_json(&m, buf, sizeof(buf));
+    return buf;
+}
+
+bool parse_args(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        const char *value = argv[i + 1];
+        if (key == "--nodes")
+            opt.nodes = std::atoi(value);
+        else if (key == "--frames")
+            opt.frames = std::atoi(value);
+        else if (key == "--loss")
+            opt.loss = std::atof(value);
+        else if (key == "--ack-loss")
+            opt.ack_loss = std::atof(value);
+        else if (key == "--late")
+            opt.late = std::atof(value);
+        else if (key == "--corrupt")
+            opt.corrupt = std::atof(value);
+        else if (key == "--broker-fail")
+            opt.broker_fail = std::atof(value);
+        else if (key == "--retries")
+            opt.retries = std::atoi(value);
+        else if (key == "--seed")
+            opt.seed = static_cast<unsigned>(std::atoi(value));
+        else
+            return false;
+    }
+    return argc % 2 == 1 && opt.nodes > 0 && opt.nodes < 256;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt))
+    {
+        std::fprintf(stderr, "usage: %s [--nodes N] [--frames N] [--loss P] [--ack-loss P] "
+                             "[--late P] [--corrupt P] [--broker-fail P] [--retries N] [--seed N]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    Loopback loopback(opt);
+    std::mt19937 rng(opt.seed + 1);
+
+    std::vector<Node> nodes(opt.nodes);
+    for (int i = 0; i < opt.nodes; i++)
+    {
+        const uint8_t mac[6] = {0x24, 0x6f, 0x28, 0x00, 0x00, static_cast<uint8_t>(i)};
+        std::memcpy(nodes[i].mac, mac, sizeof(mac));
+        // Node 0 starts just below the wrap-around
+        nodes[i].seq = i == 0 ? 0xFFF0 : static_cast<uint16_t>(rng());
+        nodes[i].loopback = &loopback;
+    }
+
+    // Expected JSON per (device_id, ts_device) of acknowledged frames
+    std::map<std::pair<std::string, int64_t>, std::string> acked;
+    Stats &stats = loopback.stats();
+
+    for (int index = 0; index < opt.frames; index++)
+    {
+        int n = index % opt.nodes;
+        Node &node = nodes[n];
+        meteo_measurement_t m = make_measurement(n, index, rng);
+
+        uint8_t frame[ESPNOW_FRAME_MAX_LEN];
+        uint16_t seq = node.seq++;
+        size_t len = espnow_frame_encode_data(&m, seq, frame, sizeof(frame));
+        if (len == 0)
+        {
+            std::fprintf(stderr, "FAIL: frame encoding\n");
+            return 1;
+        }
+
+        espnow_arq_ops_t ops = {node_tx, node_wait_ack, &node};
+        int attempts = espnow_arq_send(&ops, frame, len, seq, 30, opt.retries);
+        if (attempts == 0)
+        {
+            stats.gave_up++;
+            stats.attempts_total += opt.retries + 1;
+            continue;
+        }
+        stats.acked++;
+        stats.attempts_total += attempts;
+        acked[{m.device_id, m.ts_device}] = to_json(m);
+    }
+
+    // Every forwarded measurement must be unique and unchanged
+    int failures = 0;
+    std::map<std::pair<std::string, int64_t>, int> seen;
+    for (const meteo_measurement_t &m : loopback.forwarded())
+    {
+        std::pair<std::string, int64_t> key{m.device_id, m.ts_device};
+        if (++seen[key] > 1)
+        {
+            std::fprintf(stderr, "FAIL: %s ts=%lld forwarded twice\n", m.device_id,
+                         static_cast<long long>(m.ts_device));
+            failures++;
+        }
+        auto it = acked.find(key);
+        if (it != acked.end() && it->second != to_json(m))
+        {
+            std::fprintf(stderr, "FAIL: %s ts=%lld payload mismatch\n", m.device_id,
+                         static_cast<long long>(m.ts_device));
+            failures++;
+        }
+    }
+
+    // Every acknowledged measurement must have been forwarded
+    for (const auto &entry : acked)
+    {
+        if (seen.find(entry.first) == seen.end())
+        {
+            std::fprintf(stderr, "FAIL: %s ts=%lld acknowledged but not forwarded\n",
+                         entry.first.first.c_str(), static_cast<long long>(entry.first.second));
+            failures++;
+        }
+    }
+
+    std::printf("nodes=%d frames=%d loss=%.2f ack_loss=%.2f late=%.2f corrupt=%.2f "
+                "broker_fail=%.2f retries=%d seed=%u\n",
+                opt.nodes, opt.frames, opt.loss, opt.ack_loss, opt.late, opt.corrupt,
+                opt.broker_fail, opt.retries, opt.seed);
+    std::printf("  data frames on air     %u\n", stats.tx_data);
+    std::printf("  rejected by gateway    %u (CRC / format)\n", stats.rx_invalid);
+    std::printf("  duplicates suppressed  %u\n", stats.rx_duplicate);
+    std::printf("  publish failed         %u (not acknowledged)\n", stats.publish_failed);
+    std::printf("  forwarded to MQTT      %u\n", stats.forwarded);
+    std::printf("  acknowledged           %u\n", stats.acked);
+    std::printf("  gave up (no ACK)       %u\n", stats.gave_up);
+    std::printf("  attempts per frame     %.2f\n",
+                opt.frames > 0 ? static_cast<double>(stats.attempts_total) / opt.frames : 0.0);
+    std::printf("%s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+
+    return failures == 0 ? 0 : 1;
+}
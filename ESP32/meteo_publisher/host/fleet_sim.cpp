@@ -0,0 +1,694 @@
+/**
+ * @file fleet_sim.cpp
+ * @brief Fleet simulator and MQTT broker load generator
+ *
+ * Simulates many sensor nodes against a real broker. Each wake does what
+ * mqtt_pub.c does on the device: TCP connect, CONNECT, QoS 1 PUBLISH of the
+ * payload built by payload_format_json(), wait, DISCONNECT. Payloads are
+ * byte-compatible with the firmware, so the whole ingest path (broker,
+ * main.py, SQLite) sees realistic traffic.
+ *
+ * Nodes wake on their own drifting clocks with jitter; optional "cold boot"
+ * storms wake (a fraction of) the fleet at once, as after a power cut.
+ *
+ * Single-threaded epoll event loop: thousands of concurrent sessions.
+ */
+
+#include "LatencyStats.hpp"
+#include "MqttPacket.hpp"
+#include "SimNode.hpp"
+#include "payload.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <queue>
+#include <random>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 1883;
+    std::string username;
+    std::string password;
+    std::string prefix = "sim-";
+    int nodes = 1000;
+    int publishes = 1;      // Per wake (wake stub batches publish several)
+    int64_t interval_ms = 60000;
+    int64_t jitter_ms = 200;
+    double clock_ppm = 20000;
+    int64_t duration_s = 300;
+    int64_t linger_ms = 1000; // mqtt_pub_disconnect() keeps the session open 1 s
+    int64_t timeout_ms = 10000;
+    int64_t storm_every_s = 0;
+    double storm_fraction = 1.0;
+    int64_t storm_spread_ms = 3000;
+    int64_t report_every_s = 10;
+    int max_inflight = 4000;
+    unsigned seed = 1;
+    std::string csv;
+};
+
+enum class State
+{
+    Connecting,
+    WaitConnack,
+    WaitPuback,
+    Linger,
+};
+
+enum Outcome
+{
+    OK,
+    FAIL_CONNECT,
+    FAIL_CONNACK,
+    FAIL_CLOSED,
+    FAIL_TIMEOUT,
+    OUTCOME_COUNT,
+};
+
+const char *const OUTCOME_NAMES[OUTCOME_COUNT] = {"ok", "connect", "connack", "closed", "timeout"};
+
+struct Session
+{
+    int fd;
+    size_t node;
+    State state;
+    int64_t t_sched;
+    int64_t t_start;
+    int64_t t_tcp;
+    int64_t t_connack;
+    int64_t t_publish;
+    int64_t t_puback;
+    int64_t t_deadline;
+    int acks_pending;
+    std::vector<uint8_t> tx;
+    std::vector<uint8_t> rx;
+};
+
+struct Wake
+{
+    int64_t due_us;
+    size_t node;
+    uint32_t generation;
+    bool operator>(const Wake &other) const { return due_us > other.due_us; }
+};
+
+int64_t now_us()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+class FleetSim
+{
+public:
+    FleetSim(const Options &opt, const sockaddr_in &broker)
+        : m_opt(opt), m_broker(broker), m_rng(opt.seed)
+    {
+        m_schedule.interval_us = opt.interval_ms * 1000;
+        m_schedule.jitter_us = opt.jitter_ms * 1000;
+        m_schedule.clock_ppm = opt.clock_ppm;
+
+        m_nodes.reserve(opt.nodes);
+        for (int i = 0; i < opt.nodes; i++)
+        {
+            m_nodes.emplace_back(i, opt.prefix.c_str(), m_schedule, m_rng);
+        }
+
+        m_epoll = epoll_create1(0);
+        if (!opt.csv.empty())
+        {
+            m_csv = std::fopen(opt.csv.c_str(), "w");
+            if (m_csv != nullptr)
+            {
+                std::fprintf(m_csv, "device_id,scheduled_ms,start_delay_us,tcp_us,connack_us,puback_us,outcome\n");
+            }
+        }
+    }
+
+    ~FleetSim()
+    {
+        if (m_csv != nullptr)
+        {
+            std::fclose(m_csv);
+        }
+        close(m_epoll);
+    }
+
+    int run();
+
+private:
+    void schedule(size_t node)
+    {
+        m_wakes.push({m_nodes[node].next_wake_us(), node, m_nodes[node].generation()});
+    }
+
+    void cold_boot_storm(int64_t now);
+    void start_session(const Wake &wake, int64_t now);
+    void on_event(Session &s, uint32_t events, int64_t now);
+    void on_packet(Session &s, const mqtt::Packet &packet, int64_t now);
+    void flush(Session &s);
+    void finish(Session &s, Outcome outcome, int64_t now);
+    void check_timeouts(int64_t now);
+    void report(int64_t now, bool final);
+
+    const Options &m_opt;
+    sockaddr_in m_broker;
+    std::mt19937 m_rng;
+    SimSchedule m_schedule;
+    std::vector<SimNode> m_nodes;
+    std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> m_wakes;
+    std::vector<std::unique_ptr<Session>> m_sessions; // Indexed by fd
+    int m_inflight = 0;
+    int m_epoll;
+    FILE *m_csv = nullptr;
+    int64_t m_t0 = 0;
+    uint16_t m_packet_id = 1;
+
+    // Totals
+    LatencyStats m_start_delay, m_tcp, m_connack, m_puback, m_session;
+    unsigned m_outcomes[OUTCOME_COUNT] = {};
+    unsigned long m_acked = 0;
+    unsigned long m_deferred = 0;
+    Wake m_last_deferred = {0, SIZE_MAX, 0};
+    int m_peak_inflight = 0;
+
+    // Current report window
+    LatencyStats m_window_puback;
+    unsigned long m_window_acked = 0;
+    unsigned m_window_failed = 0;
+};
+
+void FleetSim::cold_boot_storm(int64_t now)
+{
+    std::uniform_real_distribution<double> pick(0.0, 1.0);
+    unsigned count = 0;
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        // Nodes that are awake right now finish their wake first
+        if (pick(m_rng) < m_opt.storm_fraction)
+        {
+            m_nodes[i].cold_boot(now, m_opt.storm_spread_ms * 1000, m_rng);
+            schedule(i);
+            count++;
+        }
+    }
+    std::printf("[%7.1f s] cold boot storm: %u nodes within %lld ms\n",
+                (now - m_t0) / 1e6, count, static_cast<long long>(m_opt.storm_spread_ms));
+}
+
+void FleetSim::start_session(const Wake &wake, int64_t now)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+    {
+        std::perror("socket");
+        m_outcomes[FAIL_CONNECT]++;
+        m_nodes[wake.node].sleep(now, 0, m_rng);
+        schedule(wake.node);
+        return;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (static_cast<size_t>(fd) >= m_sessions.size())
+    {
+        m_sessions.resize(fd + 1);
+    }
+    m_sessions[fd].reset(new Session());
+    Session &s = *m_sessions[fd];
+    s.fd = fd;
+    s.node = wake.node;
+    s.state = State::Connecting;
+    s.t_sched = wake.due_us;
+    s.t_start = now;
+    s.t_deadline = now + m_opt.timeout_ms * 1000;
+    s.acks_pending = 0;
+
+    m_inflight++;
+    if (m_inflight > m_peak_inflight)
+    {
+        m_peak_inflight = m_inflight;
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.fd = fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&m_broker), sizeof(m_broker)) < 0 &&
+        errno != EINPROGRESS)
+    {
+        finish(s, FAIL_CONNECT, now);
+    }
+}
+
+void FleetSim::flush(Session &s)
+{
+    while (!s.tx.empty())
+    {
+        ssize_t n = send(s.fd, s.tx.data(), s.tx.size(), MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            break;
+        }
+        s.tx.erase(s.tx.begin(), s.tx.begin() + n);
+    }
+
+    epoll_event ev = {};
+    ev.events = s.tx.empty() ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+    ev.data.fd = s.fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, s.fd, &ev);
+}
+
+void FleetSim::on_event(Session &s, uint32_t events, int64_t now)
+{
+    if (s.state == State::Connecting)
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0 || (events & (EPOLLERR | EPOLLHUP)))
+        {
+            finish(s, FAIL_CONNECT, now);
+            return;
+        }
+
+        s.t_tcp = now;
+        s.state = State::WaitConnack;
+        mqtt::encode_connect(s.tx, m_nodes[s.node].device_id(), m_opt.username,
+                             m_opt.password, 120);
+        flush(s);
+        return;
+    }
+
+    if (events & EPOLLOUT)
+    {
+        flush(s);
+    }
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+        uint8_t buf[1024];
+        ssize_t n = recv(s.fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return;
+            }
+            finish(s, FAIL_CLOSED, now);
+            return;
+        }
+
+        s.rx.insert(s.rx.end(), buf, buf + n);
+        mqtt::Packet packet;
+        int fd = s.fd;
+        while (m_sessions[fd] && mqtt::decode_next(s.rx, packet))
+        {
+            on_packet(s, packet, now);
+        }
+    }
+}
+
+void FleetSim::on_packet(Session &s, const mqtt::Packet &packet, int64_t now)
+{
+    if (s.state == State::WaitConnack && packet.type == mqtt::CONNACK)
+    {
+        if (packet.body.size() < 2 || packet.body[1] != 0)
+        {
+            finish(s, FAIL_CONNACK, now);
+            return;
+        }
+        s.t_connack = now;
+
+        // Current reading last, older (wake stub) samples first
+        SimNode &node = m_nodes[s.node];
+        int64_t wall = static_cast<int64_t>(std::time(nullptr));
+        meteo_measurement_t m;
+        node.measure(&m, wall, m_rng);
+        m.transport = "mqtt";
+
+        char topic[128];
+        char payload[PAYLOAD_JSON_MAX_LEN];
+        payload_format_topic(m.device_id, topic, sizeof(topic));
+        for (int i = m_opt.publishes - 1; i >= 0; i--)
+        {
+            m.sample_age_s = static_cast<uint32_t>(i * (m_opt.interval_ms / 1000));
+            m.ts_device = wall - m.sample_age_s;
+            int len = payload_format_json(&m, payload, sizeof(payload));
+            mqtt::encode_publish_qos1(s.tx, topic, m_packet_id++, payload, len);
+            if (m_packet_id == 0)
+            {
+                m_packet_id = 1;
+            }
+            s.acks_pending++;
+        }
+
+        s.t_publish = now;
+        s.state = State::WaitPuback;
+        flush(s);
+        return;
+    }
+
+    if (s.state == State::WaitPuback && packet.type == mqtt::PUBACK)
+    {
+        if (--s.acks_pending > 0)
+        {
+            return;
+        }
+        s.t_puback = now;
+        s.state = State::Linger;
+        s.t_deadline = now + m_opt.linger_ms * 1000;
+        if (m_opt.linger_ms == 0)
+        {
+            finish(s, OK, now);
+        }
+    }
+}
+
+void FleetSim::finish(Session &s, Outcome outcome, int64_t now)
+{
+    if (outcome == OK)
+    {
+        std::vector<uint8_t> disconnect;
+        mqtt::encode_disconnect(disconnect);
+        send(s.fd, disconnect.data(), disconnect.size(), MSG_NOSIGNAL);
+
+        m_start_delay.add(s.t_start - s.t_sched);
+        m_tcp.add(s.t_tcp - s.t_start);
+        m_connack.add(s.t_connack - s.t_tcp);
+        m_puback.add(s.t_puback - s.t_publish);
+        m_session.add(s.t_puback - s.t_sched);
+        m_window_puback.add(s.t_puback - s.t_publish);
+        m_acked += m_opt.publishes;
+        m_window_acked += m_opt.publishes;
+    }
+    else
+    {
+        m_window_failed++;
+    }
+    m_outcomes[outcome]++;
+
+    if (m_csv != nullptr)
+    {
+        auto delta = [](int64_t to, int64_t from) { return to != 0 && from != 0 ? to - from : -1; };
+        std::fprintf(m_csv, "%s,%lld,%lld,%lld,%lld,%lld,%s\n", m_nodes[s.node].device_id(),
+                     static_cast<long long>((s.t_sched - m_t0) / 1000),
+                     static_cast<long long>(s.t_start - s.t_sched),
+                     static_cast<long long>(delta(s.t_tcp, s.t_start)),
+                     static_cast<long long>(delta(s.t_connack, s.t_tcp)),
+                     static_cast<long long>(delta(s.t_puback, s.t_publish)),
+                     OUTCOME_NAMES[outcome]);
+    }
+
+    // The node sleeps one interval after its awake time
+    m_nodes[s.node].sleep(now, now - s.t_start, m_rng);
+    schedule(s.node);
+
+    int fd = s.fd;
+    close(fd);
+    m_sessions[fd].reset();
+    m_inflight--;
+}
+
+void FleetSim::check_timeouts(int64_t now)
+{
+    for (auto &session : m_sessions)
+    {
+        if (session && now >= session->t_deadline)
+        {
+            finish(*session, session->state == State::Linger ? OK : FAIL_TIMEOUT, now);
+        }
+    }
+}
+
+void FleetSim::report(int64_t now, bool final)
+{
+    if (!final)
+    {
+        std::printf("[%7.1f s] acked %6.1f msg/s  failed %4u  inflight %5d  puback p50 %7.2f ms p99 %7.2f ms\n",
+                    (now - m_t0) / 1e6, m_window_acked / static_cast<double>(m_opt.report_every_s),
+                    m_window_failed, m_inflight,
+                    m_window_puback.percentile(50) / 1000.0, m_window_puback.percentile(99) / 1000.0);
+        m_window_puback.clear();
+        m_window_acked = 0;
+        m_window_failed = 0;
+        return;
+    }
+
+    double elapsed_s = (now - m_t0) / 1e6;
+    std::printf("\n%d nodes, interval %lld ms, %d publish(es) per wake, %.1f s\n", m_opt.nodes,
+                static_cast<long long>(m_opt.interval_ms), m_opt.publishes, elapsed_s);
+    std::printf("  offered load           %9.1f msg/s\n",
+                m_opt.nodes * m_opt.publishes * 1000.0 / m_opt.interval_ms);
+    std::printf("  acknowledged           %9.1f msg/s (%lu messages)\n", m_acked / elapsed_s, m_acked);
+    std::printf("  peak concurrent        %9d sessions\n", m_peak_inflight);
+    std::printf("  deferred wakes         %9lu (--max-inflight reached)\n", m_deferred);
+    std::printf("  sessions:");
+    for (int i = 0; i < OUTCOME_COUNT; i++)
+    {
+        std::printf(" %s=%u", OUTCOME_NAMES[i], m_outcomes[i]);
+    }
+    std::printf("\n\n");
+
+    LatencyStats::print_header();
+    m_start_delay.print_row("wake -> start");
+    m_tcp.print_row("TCP connect");
+    m_connack.print_row("CONNECT -> CONNACK");
+    m_puback.print_row("PUBLISH -> PUBACK");
+    m_session.print_row("wake -> PUBACK");
+}
+
+int FleetSim::run()
+{
+    m_t0 = now_us();
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        m_nodes[i].start(m_t0, m_rng);
+        schedule(i);
+    }
+
+    const int64_t end = m_t0 + m_opt.duration_s * 1000000;
+    const int64_t drain_end = end + m_opt.timeout_ms * 1000 + m_opt.linger_ms * 1000;
+    int64_t next_report = m_t0 + m_opt.report_every_s * 1000000;
+    int64_t next_storm = m_opt.storm_every_s > 0 ? m_t0 + m_opt.storm_every_s * 1000000 : INT64_MAX;
+    int64_t next_timeout_check = m_t0;
+
+    std::vector<epoll_event> events(1024);
+    int64_t now = m_t0;
+
+    while (now < end || (m_inflight > 0 && now < drain_end))
+    {
+        if (now < end && now >= next_storm)
+        {
+            cold_boot_storm(now);
+            next_storm += m_opt.storm_every_s * 1000000;
+        }
+
+        // Start due wakes; stale entries (node rescheduled) are skipped
+        while (now < end && !m_wakes.empty() && m_wakes.top().due_us <= now)
+        {
+            Wake wake = m_wakes.top();
+            if (wake.generation != m_nodes[wake.node].generation())
+            {
+                m_wakes.pop();
+                continue;
+            }
+            if (m_inflight >= m_opt.max_inflight)
+            {
+                // Count each held-back wake once, not once per loop pass
+                if (wake.node != m_last_deferred.node || wake.generation != m_last_deferred.generation)
+                {
+                    m_deferred++;
+                    m_last_deferred = wake;
+                }
+                break;
+            }
+            m_wakes.pop();
+            start_session(wake, now);
+        }
+
+        int64_t wait_us = 100000;
+        if (!m_wakes.empty() && m_inflight < m_opt.max_inflight)
+        {
+            wait_us = std::min(wait_us, std::max<int64_t>(0, m_wakes.top().due_us - now));
+        }
+
+        int n = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()),
+                           static_cast<int>((wait_us + 999) / 1000));
+        now = now_us();
+
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (static_cast<size_t>(fd) < m_sessions.size() && m_sessions[fd])
+            {
+                on_event(*m_sessions[fd], events[i].events, now);
+            }
+        }
+
+        if (now >= next_timeout_check)
+        {
+            check_timeouts(now);
+            next_timeout_check = now + 50000;
+        }
+
+        if (now >= next_report && now < end)
+        {
+            report(now, false);
+            next_report += m_opt.report_every_s * 1000000;
+        }
+    }
+
+    // Whatever is still open did not finish in time
+    for (auto &session : m_sessions)
+    {
+        if (session)
+        {
+            finish(*session, FAIL_TIMEOUT, now);
+        }
+    }
+
+    report(now, true);
+    return m_outcomes[OK] > 0 ? 0 : 1;
+}
+
+bool parse_args(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--host")
+            opt.host = value;
+        else if (key == "--port")
+            opt.port = std::stoi(value);
+        else if (key == "--user")
+            opt.username = value;
+        else if (key == "--pass")
+            opt.password = value;
+        else if (key == "--prefix")
+            opt.prefix = value;
+        else if (key == "--nodes")
+            opt.nodes = std::stoi(value);
+        else if (key == "--publishes")
+            opt.publishes = std::stoi(value);
+        else if (key == "--interval-ms")
+            opt.interval_ms = std::stoll(value);
+        else if (key == "--jitter-ms")
+            opt.jitter_ms = std::stoll(value);
+        else if (key == "--clock-ppm")
+            opt.clock_ppm = std::stod(value);
+        else if (key == "--duration-s")
+            opt.duration_s = std::stoll(value);
+        else if (key == "--linger-ms")
+            opt.linger_ms = std::stoll(value);
+        else if (key == "--timeout-ms")
+            opt.timeout_ms = std::stoll(value);
+        else if (key == "--storm-every-s")
+            opt.storm_every_s = std::stoll(value);
+        else if (key == "--storm-fraction")
+            opt.storm_fraction = std::stod(value);
+        else if (key == "--storm-spread-ms")
+            opt.storm_spread_ms = std::stoll(value);
+        else if (key == "--report-every-s")
+            opt.report_every_s = std::stoll(value);
+        else if (key == "--max-inflight")
+            opt.max_inflight = std::stoi(value);
+        else if (key == "--seed")
+            opt.seed = static_cast<unsigned>(std::stoul(value));
+        else if (key == "--csv")
+            opt.csv = value;
+        else
+            return false;
+    }
+    return argc % 2 == 1 && opt.nodes > 0 && opt.publishes > 0 && opt.interval_ms > 0 &&
+           opt.report_every_s > 0 && opt.max_inflight > 0 &&
+           opt.prefix.size() + 5 < MEASUREMENT_DEVICE_ID_LEN;
+}
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--host H] [--port P] [--user U] [--pass P] [--prefix sim-]\n"
+                 "          [--nodes N] [--publishes N] [--interval-ms MS] [--jitter-ms MS]\n"
+                 "          [--clock-ppm PPM] [--duration-s S] [--linger-ms MS] [--timeout-ms MS]\n"
+                 "          [--storm-every-s S] [--storm-fraction F] [--storm-spread-ms MS]\n"
+                 "          [--report-every-s S] [--max-inflight N] [--seed N] [--csv FILE]\n",
+                 argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    bool ok = false;
+    try
+    {
+        ok = parse_args(argc, argv, opt);
+    }
+    catch (const std::exception &)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(opt.host.c_str(), std::to_string(opt.port).c_str(), &hints, &res) != 0 || res == nullptr)
+    {
+        std::fprintf(stderr, "Cannot resolve %s\n", opt.host.c_str());
+        return 2;
+    }
+    sockaddr_in broker;
+    std::memcpy(&broker, res->ai_addr, sizeof(broker));
+    freeaddrinfo(res);
+
+    // One socket per concurrent session
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur != RLIM_INFINITY && static_cast<rlim_t>(opt.max_inflight) + 16 > limit.rlim_cur)
+        {
+            opt.max_inflight = static_cast<int>(limit.rlim_cur) - 16;
+            std::fprintf(stderr, "max-inflight limited to %d by RLIMIT_NOFILE\n", opt.max_inflight);
+        }
+    }
+
+    std::printf("Simulating %d nodes against %s:%d for %lld s\n", opt.nodes, opt.host.c_str(),
+                opt.port, static_cast<long long>(opt.duration_s));
+
+    FleetSim sim(opt, broker);
+    return sim.run();
+}
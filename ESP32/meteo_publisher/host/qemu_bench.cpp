@@ -0,0 +1,340 @@
+/**
+ * @file qemu_bench.cpp
+ * @brief Boot-to-PUBACK benchmark of the firmware under Espressif's QEMU
+ *
+ * Boots the QEMU build of the publisher (sdkconfig.defaults.qemu: openeth
+ * instead of Wi-Fi, simulated sensors, CONFIG_BENCH_PUBLISH_LATENCY) once
+ * per run against a broker on this machine and reads the line
+ *   BENCH connack_us=<t> puback_us=<t>
+ * the firmware prints when the broker acknowledges the measurement. The
+ * device times count from application start (esp_timer); the host time
+ * runs from starting QEMU, so it adds ROM, bootloader and emulator start.
+ *
+ * Every run boots the same flash image with -snapshot: the outbox and NVS
+ * start empty, each run is a cold boot. No RF, no sensor timing noise: the
+ * spread between runs is the emulator and the network stack.
+ *
+ * Usage: qemu_bench --image flash_image.bin [--runs 10] [--start-broker]
+ */
+
+#include "LatencyStats.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string image;
+    std::string qemu = "qemu-system-xtensa";
+    std::string efuse;
+    std::string mosquitto = "mosquitto";
+    int broker_port = 1883;
+    bool start_broker = false;
+    int runs = 10;
+    int64_t timeout_s = 60;
+    std::string log;
+};
+
+struct RunResult
+{
+    bool ok = false;
+    int64_t connack_us = 0; // Device: application start to CONNACK
+    int64_t puback_us = 0;  // Device: application start to PUBACK
+    int64_t host_us = 0;    // Host: QEMU start to the BENCH line
+};
+
+/**
+ * Start a child with stdout and stderr on a pipe (or /dev/null)
+ * @return pid, -1 on failure; *out_fd is the read end if out_fd != nullptr
+ */
+pid_t spawn(const std::vector<std::string> &args, int *out_fd)
+{
+    int fds[2] = {-1, -1};
+    if (out_fd != nullptr && pipe(fds) != 0)
+    {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int target = out_fd != nullptr ? fds[1] : open("/dev/null", O_WRONLY);
+        dup2(target, STDOUT_FILENO);
+        dup2(target, STDERR_FILENO);
+        // QEMU's monitor must not read the benchmark's terminal
+        int null_in = open("/dev/null", O_RDONLY);
+        dup2(null_in, STDIN_FILENO);
+        if (out_fd != nullptr)
+        {
+            close(fds[0]);
+        }
+
+        std::vector<char *> argv;
+        for (const std::string &arg : args)
+        {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+        std::fprintf(stderr, "Cannot run %s: %s\n", argv[0], std::strerror(errno));
+        _exit(127);
+    }
+
+    if (out_fd != nullptr)
+    {
+        close(fds[1]);
+        if (pid < 0)
+        {
+            close(fds[0]);
+            return -1;
+        }
+        *out_fd = fds[0];
+    }
+    return pid;
+}
+
+void stop(pid_t pid)
+{
+    if (pid <= 0)
+    {
+        return;
+    }
+    kill(pid, SIGTERM);
+    for (int i = 0; i < 50; i++)
+    {
+        if (waitpid(pid, nullptr, WNOHANG) == pid)
+        {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+std::vector<std::string> qemu_args(const Options &opt)
+{
+    std::vector<std::string> args = {
+        opt.qemu, "-nographic", "-machine", "esp32",
+        "-snapshot",
+        "-drive", "file=" + opt.image + ",if=mtd,format=raw",
+        "-nic", "user,model=open_eth",
+    };
+    if (!opt.efuse.empty())
+    {
+        args.insert(args.end(), {"-drive", "file=" + opt.efuse + ",if=none,format=raw,id=efuse",
+                                 "-global", "driver=nvram.esp32.efuse,property=drive,value=efuse"});
+    }
+    return args;
+}
+
+/**
+ * One boot: wait for the BENCH line or give up after the timeout
+ */
+RunResult run_once(const Options &opt, FILE *log)
+{
+    RunResult result;
+    int fd = -1;
+    Clock::time_point start = Clock::now();
+    pid_t pid = spawn(qemu_args(opt), &fd);
+    if (pid < 0)
+    {
+        std::fprintf(stderr, "Cannot start %s\n", opt.qemu.c_str());
+        return result;
+    }
+
+    std::string line;
+    Clock::time_point deadline = start + std::chrono::seconds(opt.timeout_s);
+    bool done = false;
+    while (!done)
+    {
+        int64_t left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left_ms <= 0)
+        {
+            std::fprintf(stderr, "  timeout after %lld s\n", static_cast<long long>(opt.timeout_s));
+            break;
+        }
+
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(left_ms)) <= 0)
+        {
+            continue;
+        }
+
+        char buf[512];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            std::fprintf(stderr, "  QEMU exited before PUBACK\n");
+            break;
+        }
+        if (log != nullptr)
+        {
+            fwrite(buf, 1, static_cast<size_t>(n), log);
+        }
+
+        for (ssize_t i = 0; i < n && !done; i++)
+        {
+            if (buf[i] != '\n')
+            {
+                line.push_back(buf[i]);
+                continue;
+            }
+            long long connack = 0, puback = 0;
+            const char *bench = std::strstr(line.c_str(), "BENCH ");
+            if (bench != nullptr && std::sscanf(bench, "BENCH connack_us=%lld puback_us=%lld", &connack, &puback) == 2)
+            {
+                result.host_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+                result.connack_us = connack;
+                result.puback_us = puback;
+                result.ok = true;
+                done = true;
+            }
+            line.clear();
+        }
+    }
+
+    close(fd);
+    stop(pid);
+    return result;
+}
+
+bool parse_args(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string key = argv[i];
+        if (key == "--start-broker")
+        {
+            opt.start_broker = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (key == "--image")
+            opt.image = value;
+        else if (key == "--qemu")
+            opt.qemu = value;
+        else if (key == "--efuse")
+            opt.efuse = value;
+        else if (key == "--mosquitto")
+            opt.mosquitto = value;
+        else if (key == "--broker-port")
+            opt.broker_port = std::stoi(value);
+        else if (key == "--runs")
+            opt.runs = std::stoi(value);
+        else if (key == "--timeout-s")
+            opt.timeout_s = std::stoll(value);
+        else if (key == "--log")
+            opt.log = value;
+        else
+            return false;
+    }
+    return !opt.image.empty() && opt.runs > 0 && opt.timeout_s > 0;
+}
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s --image FLASH.bin [--runs N] [--timeout-s S] [--qemu qemu-system-xtensa]\n"
+                 "          [--efuse EFUSE.bin] [--start-broker] [--mosquitto PATH] [--broker-port P]\n"
+                 "          [--log FILE]\n",
+                 argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    bool ok = false;
+    try
+    {
+        ok = parse_args(argc, argv, opt);
+    }
+    catch (const std::exception &)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *log = nullptr;
+    if (!opt.log.empty())
+    {
+        log = std::fopen(opt.log.c_str(), "w");
+        if (log == nullptr)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", opt.log.c_str());
+            return 2;
+        }
+    }
+
+    // The firmware connects to mqtt://10.0.2.2, QEMU's address of this machine
+    pid_t broker = -1;
+    if (opt.start_broker)
+    {
+        broker = spawn({opt.mosquitto, "-p", std::to_string(opt.broker_port)}, nullptr);
+        if (broker < 0)
+        {
+            std::fprintf(stderr, "Cannot start %s\n", opt.mosquitto.c_str());
+            return 2;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+
+    LatencyStats connack, puback, host;
+    int failed = 0;
+    for (int i = 0; i < opt.runs; i++)
+    {
+        RunResult r = run_once(opt, log);
+        if (!r.ok)
+        {
+            failed++;
+            std::printf("run %2d  failed\n", i + 1);
+            continue;
+        }
+        connack.add(r.connack_us);
+        puback.add(r.puback_us);
+        host.add(r.host_us);
+        std::printf("run %2d  CONNACK %8.1f ms  PUBACK %8.1f ms  host %8.1f ms\n", i + 1,
+                    r.connack_us / 1000.0, r.puback_us / 1000.0, r.host_us / 1000.0);
+        std::fflush(stdout);
+    }
+
+    stop(broker);
+    if (log != nullptr)
+    {
+        std::fclose(log);
+    }
+
+    std::printf("\n%d runs, %d failed\n", opt.runs, failed);
+    LatencyStats::print_header();
+    connack.print_row("app start -> CONNACK");
+    puback.print_row("app start -> PUBACK");
+    host.print_row("QEMU start -> PUBACK");
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,401 @@
+/**
+ * @file sensor_replay.cpp
+ * @brief Replays raw sensor frames through the driver conversion code
+ *
+ * Reads measurements exported with their register bytes
+ * (tools/export_measurements.py --raw; nodes built with
+ * CONFIG_SENSOR_RAW_CAPTURE) and converts the frames again with the
+ * drivers' own bmp280_conv.c, aht20_conv.c and dht22_conv.c. Every
+ * replayed value must match the reported one at the payload's 0.01
+ * resolution: a regression test for changes to the conversion code.
+ *
+ * Also runs alternative conversion paths on the same bytes and prints
+ * how far they are from the driver:
+ *   - BMP280: double-precision formulas of the datasheet (section 8.1)
+ *     against the driver's integer compensation
+ *   - AHT20: integer fixed-point (0.01 units) against the driver's float
+ *
+ * Usage: sensor_replay raw.csv [--verbose]
+ * Exit status is non-zero when a replayed value differs from the reported one.
+ */
+
+#include "aht20_conv.h"
+#include "bmp280_conv.h"
+#include "dht22_conv.h"
+#include "measurement.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Columns written by tools/export_measurements.py --raw, in this order
+enum Column
+{
+    COL_DEVICE,
+    COL_TIMESTAMP,
+    COL_SEQ,
+    COL_DHT_TEMP,
+    COL_DHT_RH,
+    COL_AHT_TEMP,
+    COL_AHT_RH,
+    COL_BMP_TEMP,
+    COL_BMP_PRESS,
+    COL_BATTERY,
+    COL_RAW_BMP_CALIB,
+    COL_RAW_BMP,
+    COL_RAW_AHT,
+    COL_RAW_DHT,
+    COL_COUNT,
+};
+
+/**
+ * Difference statistics of one quantity
+ */
+struct Diff
+{
+    const char *name;
+    const char *unit;
+    size_t count = 0;
+    double sum = 0.0;
+    double max = 0.0;
+
+    Diff(const char *n, const char *u) : name(n), unit(u) {}
+
+    void add(double a, double b)
+    {
+        double d = std::fabs(a - b);
+        count++;
+        sum += d;
+        if (d > max)
+        {
+            max = d;
+        }
+    }
+
+    void print() const
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        std::printf("  %-22s %6zu samples  max %.6f %s  mean %.6f %s\n",
+                    name, count, max, unit, sum / count, unit);
+    }
+};
+
+bool parse_hex(const std::string &hex, uint8_t *out, size_t len)
+{
+    if (hex.size() != len * 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+        char *end = nullptr;
+        out[i] = static_cast<uint8_t>(std::strtoul(byte, &end, 16));
+        if (end != byte + 2)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Replayed value equals the reported one, which the payload rounds to 0.01
+bool same(float reported, float replayed)
+{
+    return std::fabs(reported - replayed) <= 0.005f + std::fabs(reported) * 1e-6f;
+}
+
+/**
+ * BMP280 compensation in double precision (datasheet section 8.1)
+ */
+void bmp280_compensate_double(const bmp280_calib_t &c, int32_t adc_T, int32_t adc_P,
+                              double *temp, double *press)
+{
+    double var1 = (adc_T / 16384.0 - c.dig_T1 / 1024.0) * c.dig_T2;
+    double var2 = (adc_T / 131072.0 - c.dig_T1 / 8192.0) *
+                  (adc_T / 131072.0 - c.dig_T1 / 8192.0) * c.dig_T3;
+    double t_fine = var1 + var2;
+    *temp = t_fine / 5120.0;
+
+    var1 = t_fine / 2.0 - 64000.0;
+    var2 = var1 * var1 * c.dig_P6 / 32768.0;
+    var2 = var2 + var1 * c.dig_P5 * 2.0;
+    var2 = var2 / 4.0 + c.dig_P4 * 65536.0;
+    var1 = (c.dig_P3 * var1 * var1 / 524288.0 + c.dig_P2 * var1) / 524288.0;
+    var1 = (1.0 + var1 / 32768.0) * c.dig_P1;
+    if (var1 == 0.0)
+    {
+        *press = 0.0;
+        return;
+    }
+    double p = 1048576.0 - adc_P;
+    p = (p - var2 / 4096.0) * 6250.0 / var1;
+    var1 = c.dig_P9 * p * p / 2147483648.0;
+    var2 = p * c.dig_P8 / 32768.0;
+    *press = p + (var1 + var2 + c.dig_P7) / 16.0;
+}
+
+/**
+ * AHT20 conversion in integer arithmetic, 0.01 °C and 0.01 % RH
+ */
+void aht20_convert_fixed(uint32_t raw_humidity, uint32_t raw_temp, int32_t *temp_centi, int32_t *rh_centi)
+{
+    *rh_centi = static_cast<int32_t>((static_cast<uint64_t>(raw_humidity) * 10000 + (1 << 19)) >> 20);
+    *temp_centi = static_cast<int32_t>((static_cast<uint64_t>(raw_temp) * 20000 + (1 << 19)) >> 20) - 5000;
+}
+
+float parse_value(const std::string &field)
+{
+    return field.empty() ? MEASUREMENT_INVALID : std::strtof(field.c_str(), nullptr);
+}
+
+struct Replay
+{
+    bool verbose = false;
+    size_t rows = 0;
+    size_t frames = 0;
+    size_t rejected = 0;
+    size_t mismatches = 0;
+
+    Diff bmp_temp{"bmp280 temperature", "C"};
+    Diff bmp_press{"bmp280 pressure", "Pa"};
+    Diff aht_temp{"aht20 temperature", "C"};
+    Diff aht_rh{"aht20 humidity", "%"};
+    Diff bmp_temp_double{"bmp280 temperature", "C"};
+    Diff bmp_press_double{"bmp280 pressure", "Pa"};
+    Diff aht_temp_fixed{"aht20 temperature", "C"};
+    Diff aht_rh_fixed{"aht20 humidity", "%"};
+
+    void check(const std::vector<std::string> &f, const char *what, float reported, float replayed)
+    {
+        if (!same(reported, replayed))
+        {
+            mismatches++;
+            std::printf("MISMATCH %s %s: %s reported %.2f, replayed %.4f\n",
+                        f[COL_DEVICE].c_str(), f[COL_TIMESTAMP].c_str(), what, reported, replayed);
+        }
+        else if (verbose)
+        {
+            std::printf("%s %s: %s %.2f\n", f[COL_DEVICE].c_str(), f[COL_TIMESTAMP].c_str(), what, replayed);
+        }
+    }
+
+    void reject(const std::vector<std::string> &f, const char *what)
+    {
+        rejected++;
+        std::printf("REJECTED %s %s: %s frame fails the driver checks\n",
+                    f[COL_DEVICE].c_str(), f[COL_TIMESTAMP].c_str(), what);
+    }
+
+    void bmp280(const std::vector<std::string> &f)
+    {
+        uint8_t calib_raw[BMP280_CALIB_LEN], data[BMP280_DATA_LEN];
+        if (!parse_hex(f[COL_RAW_BMP_CALIB], calib_raw, sizeof(calib_raw)) ||
+            !parse_hex(f[COL_RAW_BMP], data, sizeof(data)))
+        {
+            return;
+        }
+        frames++;
+
+        // Same steps as bmp280_convert()
+        bmp280_calib_t calib;
+        int32_t adc_T, adc_P;
+        bmp280_parse_calib(calib_raw, &calib);
+        bmp280_parse_data(data, &adc_T, &adc_P);
+        if (!bmp280_raw_valid(adc_T, adc_P))
+        {
+            reject(f, "bmp280");
+            return;
+        }
+        int32_t T = bmp280_compensate_temp(&calib, adc_T);
+        uint32_t P = bmp280_compensate_press(&calib, adc_P);
+        if (!bmp280_result_valid(T, P))
+        {
+            reject(f, "bmp280");
+            return;
+        }
+        float temp = T / 100.0f;
+        float press = P / 256.0f;
+
+        float reported_temp = parse_value(f[COL_BMP_TEMP]);
+        float reported_press = parse_value(f[COL_BMP_PRESS]);
+        check(f, "bmp280 temperature", reported_temp, temp);
+        check(f, "bmp280 pressure", reported_press, press);
+        bmp_temp.add(reported_temp, temp);
+        bmp_press.add(reported_press, press);
+
+        double temp_double, press_double;
+        bmp280_compensate_double(calib, adc_T, adc_P, &temp_double, &press_double);
+        bmp_temp_double.add(temp, temp_double);
+        bmp_press_double.add(press, press_double);
+    }
+
+    void aht20(const std::vector<std::string> &f)
+    {
+        uint8_t frame[AHT20_FRAME_LEN];
+        if (!parse_hex(f[COL_RAW_AHT], frame, sizeof(frame)))
+        {
+            return;
+        }
+        frames++;
+
+        // Same steps as aht20_read()
+        if (!aht20_frame_crc_ok(frame))
+        {
+            reject(f, "aht20");
+            return;
+        }
+        uint32_t raw_humidity, raw_temp;
+        float temp, rh;
+        aht20_parse_frame(frame, &raw_humidity, &raw_temp);
+        aht20_convert(raw_humidity, raw_temp, &temp, &rh);
+        if (!aht20_result_valid(raw_humidity, temp))
+        {
+            reject(f, "aht20");
+            return;
+        }
+
+        float reported_temp = parse_value(f[COL_AHT_TEMP]);
+        float reported_rh = parse_value(f[COL_AHT_RH]);
+        check(f, "aht20 temperature", reported_temp, temp);
+        check(f, "aht20 humidity", reported_rh, rh);
+        aht_temp.add(reported_temp, temp);
+        aht_rh.add(reported_rh, rh);
+
+        int32_t temp_centi, rh_centi;
+        aht20_convert_fixed(raw_humidity, raw_temp, &temp_centi, &rh_centi);
+        aht_temp_fixed.add(temp, temp_centi / 100.0);
+        aht_rh_fixed.add(rh, rh_centi / 100.0);
+    }
+
+    void dht22(const std::vector<std::string> &f)
+    {
+        uint8_t frame[DHT22_FRAME_LEN];
+        if (!parse_hex(f[COL_RAW_DHT], frame, sizeof(frame)))
+        {
+            return;
+        }
+        frames++;
+
+        // Same steps as dht22_read()
+        float temp, rh;
+        dht22_convert(frame, &temp, &rh);
+        if (!dht22_frame_checksum_ok(frame) || !dht22_result_valid(temp, rh))
+        {
+            reject(f, "dht22");
+            return;
+        }
+        check(f, "dht22 temperature", parse_value(f[COL_DHT_TEMP]), temp);
+        check(f, "dht22 humidity", parse_value(f[COL_DHT_RH]), rh);
+    }
+};
+
+bool load_csv(const std::string &path, Replay &replay)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    std::getline(in, line); // Header
+    if (line.find("raw_bmp280_calib") == std::string::npos)
+    {
+        std::fprintf(stderr, "%s has no raw columns (export with --raw)\n", path.c_str());
+        return false;
+    }
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ','))
+        {
+            fields.push_back(field);
+        }
+        fields.resize(COL_COUNT);
+        if (fields[COL_DEVICE].empty())
+        {
+            continue;
+        }
+
+        replay.rows++;
+        replay.bmp280(fields);
+        replay.aht20(fields);
+        replay.dht22(fields);
+    }
+    return true;
+}
+
+void usage()
+{
+    std::fprintf(stderr, "Usage: sensor_replay raw.csv [--verbose]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string csv;
+    Replay replay;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--verbose")
+        {
+            replay.verbose = true;
+        }
+        else if (arg[0] != '-' && csv.empty())
+        {
+            csv = arg;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (csv.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    if (!load_csv(csv, replay))
+    {
+        return 2;
+    }
+    if (replay.frames == 0)
+    {
+        std::fprintf(stderr, "No raw frames in %s\n", csv.c_str());
+        return 2;
+    }
+
+    std::printf("%zu measurements, %zu frames replayed, %zu rejected, %zu mismatches\n",
+                replay.rows, replay.frames, replay.rejected, replay.mismatches);
+    std::printf("Driver conversion vs reported values:\n");
+    replay.bmp_temp.print();
+    replay.bmp_press.print();
+    replay.aht_temp.print();
+    replay.aht_rh.print();
+    std::printf("BMP280 double-precision datasheet formulas vs driver integer compensation:\n");
+    replay.bmp_temp_double.print();
+    replay.bmp_press_double.print();
+    std::printf("AHT20 integer fixed-point vs driver float conversion:\n");
+    replay.aht_temp_fixed.print();
+    replay.aht_rh_fixed.print();
+
+    return replay.mismatches == 0 ? 0 : 1;
+}
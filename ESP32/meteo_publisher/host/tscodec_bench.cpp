@@ -0,0 +1,247 @@
+/**
+ * @file tscodec_bench.cpp
+ * @brief Compression ratio and encode cost of the batch codec on recorded data
+ *
+ * Reads measurements exported from the Orange Pi database
+ * (tools/export_measurements.py), splits each node's series into batches
+ * of the low-tier batch size and encodes them with the firmware's
+ * tscodec_encode(). Compares the size with one JSON payload per
+ * measurement (what the node sends without the codec) and with the raw
+ * values (8-byte timestamp, 4-byte seq, 32-bit floats), checks that every
+ * batch decodes to the exported values, and times the encoder.
+ *
+ * Usage: tscodec_bench measurements.csv [--batch N] [--iterations N]
+ * Exit status is non-zero when a batch does not round-trip.
+ */
+
+#include "payload.h"
+#include "tscodec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Options
+{
+    std::string csv;
+    size_t batch = 4; // CONFIG_POWER_BATCH_SIZE
+    int iterations = 2000;
+};
+
+// Columns written by tools/export_measurements.py, in this order
+const char *const COLUMNS[] = {
+    "device_id", "timestamp_device", "seq",
+    "dht22_temperature_c", "dht22_humidity_percent",
+    "aht20_temperature_c", "aht20_humidity_percent",
+    "bmp280_temperature_c", "bmp280_pressure_pa", "battery_mv",
+};
+
+float parse_value(const std::string &field)
+{
+    return field.empty() ? MEASUREMENT_INVALID : std::strtof(field.c_str(), nullptr);
+}
+
+bool load_csv(const std::string &path, std::map<std::string, std::vector<meteo_measurement_t>> &series)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line))
+    {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ','))
+        {
+            fields.push_back(field);
+        }
+        fields.resize(sizeof(COLUMNS) / sizeof(COLUMNS[0]));
+        if (fields[0].empty() || fields[1].empty())
+        {
+            continue;
+        }
+
+        meteo_measurement_t m;
+        measurement_init(&m);
+        std::snprintf(m.device_id, sizeof(m.device_id), "%s", fields[0].c_str());
+        std::snprintf(m.fw, sizeof(m.fw), "bench");
+        m.transport = "mqtt";
+        m.ts_device = std::strtoll(fields[1].c_str(), nullptr, 10);
+        m.seq = static_cast<uint32_t>(std::strtoul(fields[2].c_str(), nullptr, 10));
+        m.dht_temp = parse_value(fields[3]);
+        m.dht_rh = parse_value(fields[4]);
+        m.aht20_temp = parse_value(fields[5]);
+        m.aht20_rh = parse_value(fields[6]);
+        m.bmp_temp = parse_value(fields[7]);
+        m.bmp_press = parse_value(fields[8]);
+        m.battery_mv = static_cast<uint16_t>(std::strtoul(fields[9].c_str(), nullptr, 10));
+        series[m.device_id].push_back(m);
+    }
+    return true;
+}
+
+// Decoded value equals the exported one at the codec's 0.01 resolution
+bool same(float expected, float decoded)
+{
+    if (expected == MEASUREMENT_INVALID || std::isnan(expected))
+    {
+        return decoded == MEASUREMENT_INVALID;
+    }
+    return std::fabs(expected - decoded) <= 0.005f + std::fabs(expected) * 1e-6f;
+}
+
+bool round_trip(const meteo_measurement_t *batch, size_t count, const uint8_t *buf, size_t len)
+{
+    meteo_measurement_t decoded[TSCODEC_MAX_SAMPLES];
+    if (tscodec_decode(buf, len, decoded, TSCODEC_MAX_SAMPLES) != count)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        const meteo_measurement_t &a = batch[i];
+        const meteo_measurement_t &b = decoded[i];
+        if (a.ts_device != b.ts_device || a.seq != b.seq || a.battery_mv != b.battery_mv ||
+            !same(a.dht_temp, b.dht_temp) || !same(a.dht_rh, b.dht_rh) ||
+            !same(a.aht20_temp, b.aht20_temp) || !same(a.aht20_rh, b.aht20_rh) ||
+            !same(a.bmp_temp, b.bmp_temp) || !same(a.bmp_press, b.bmp_press))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void usage()
+{
+    std::fprintf(stderr, "Usage: tscodec_bench measurements.csv [--batch N] [--iterations N]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc)
+        {
+            opt.batch = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--iterations" && i + 1 < argc)
+        {
+            opt.iterations = std::atoi(argv[++i]);
+        }
+        else if (arg[0] != '-' && opt.csv.empty())
+        {
+            opt.csv = arg;
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (opt.csv.empty() || opt.batch == 0 || opt.batch > TSCODEC_MAX_SAMPLES || opt.iterations <= 0)
+    {
+        usage();
+        return 2;
+    }
+
+    std::map<std::string, std::vector<meteo_measurement_t>> series;
+    if (!load_csv(opt.csv, series))
+    {
+        return 2;
+    }
+
+    // Batches as the node would form them: consecutive measurements of one node
+    std::vector<std::vector<meteo_measurement_t>> batches;
+    for (auto &entry : series)
+    {
+        std::vector<meteo_measurement_t> &s = entry.second;
+        std::stable_sort(s.begin(), s.end(), [](const meteo_measurement_t &a, const meteo_measurement_t &b)
+                         { return a.ts_device < b.ts_device; });
+        for (size_t i = 0; i < s.size(); i += opt.batch)
+        {
+            batches.emplace_back(s.begin() + i, s.begin() + std::min(s.size(), i + opt.batch));
+        }
+    }
+    if (batches.empty())
+    {
+        std::fprintf(stderr, "No measurements in %s\n", opt.csv.c_str());
+        return 2;
+    }
+
+    size_t samples = 0, json_bytes = 0, raw_bytes = 0, codec_bytes = 0, failures = 0;
+    uint8_t buf[PAYLOAD_JSON_MAX_LEN * 8];
+    char json[PAYLOAD_JSON_MAX_LEN];
+    for (const auto &batch : batches)
+    {
+        int64_t now = batch.back().ts_device;
+        size_t len = tscodec_encode(batch.data(), batch.size(), now, buf, sizeof(buf));
+        if (len == 0 || !round_trip(batch.data(), batch.size(), buf, len))
+        {
+            failures++;
+            continue;
+        }
+
+        samples += batch.size();
+        codec_bytes += len;
+        raw_bytes += batch.size() * (8 + 4 + 7 * 4);
+        for (const auto &m : batch)
+        {
+            json_bytes += payload_format_json(&m, json, sizeof(json));
+        }
+    }
+
+    // Encode cost: all batches, repeated
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < opt.iterations; it++)
+    {
+        for (const auto &batch : batches)
+        {
+            sink += tscodec_encode(batch.data(), batch.size(), batch.back().ts_device, buf, sizeof(buf));
+        }
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double encodes = static_cast<double>(opt.iterations) * batches.size();
+
+    std::printf("%zu nodes, %zu measurements, %zu batches of up to %zu\n",
+                series.size(), samples, batches.size() - failures, opt.batch);
+    std::printf("  JSON, one payload each   %9zu bytes  %7.1f B/measurement\n",
+                json_bytes, static_cast<double>(json_bytes) / samples);
+    std::printf("  raw binary values        %9zu bytes  %7.1f B/measurement\n",
+                raw_bytes, static_cast<double>(raw_bytes) / samples);
+    std::printf("  tscodec                  %9zu bytes  %7.1f B/measurement\n",
+                codec_bytes, static_cast<double>(codec_bytes) / samples);
+    std::printf("  ratio vs JSON            %9.1f x\n", static_cast<double>(json_bytes) / codec_bytes);
+    std::printf("  ratio vs raw binary      %9.1f x\n", static_cast<double>(raw_bytes) / codec_bytes);
+    std::printf("  encode (this host)       %9.0f ns/batch  %5.1f ns/measurement  (%zu)\n",
+                elapsed_ns / encodes, elapsed_ns / encodes / (static_cast<double>(samples) / batches.size()),
+                sink % 10);
+    if (failures != 0)
+    {
+        std::printf("FAIL: %zu batches did not round-trip\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -4,10 +4,15 @@
  */
 
 #include "AHT20Sensor.hpp"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "sensor_power.h"
 
 static const char *TAG = "AHT20Sensor";
 
+// A conversion started before deep sleep waits in the sensor
+RTC_DATA_ATTR static bool s_triggered;
+
 AHT20Sensor::AHT20Sensor(i2c_port_t i2c_port,
                          gpio_num_t sda_pin,
                          gpio_num_t scl_pin,
@@ -18,7 +23,8 @@ AHT20Sensor::AHT20Sensor(i2c_port_t i2c_port,
         .i2c_port = i2c_port,
         .sda_pin = sda_pin,
         .scl_pin = scl_pin,
-        .i2c_freq_hz = i2c_freq_hz};
+        .i2c_freq_hz = i2c_freq_hz,
+        .powered = s_triggered || sensor_power_ready(SENSOR_POWER_AHT20)};
 
     esp_err_t ret = aht20_init(&m_handle, &config);
     if (ret == ESP_OK)
@@ -39,14 +45,22 @@ AHT20Sensor::AHT20Sensor(i2c_port_t i2c_port,
                          float temp_offset,
                          float temp_factor,
                          float humidity_offset,
-                         float humidity_factor)
+                         float humidity_factor,
+                         bool present)
     : m_initialized(false), m_temp_offset(temp_offset), m_temp_factor(temp_factor), m_humidity_offset(humidity_offset), m_humidity_factor(humidity_factor)
 {
+    if (!present)
+    {
+        ESP_LOGI(TAG, "AHT20 absent, not initialized");
+        return;
+    }
+
     aht20_config_t config = {
         .i2c_port = i2c_port,
         .sda_pin = sda_pin,
         .scl_pin = scl_pin,
-        .i2c_freq_hz = i2c_freq_hz};
+        .i2c_freq_hz = i2c_freq_hz,
+        .powered = s_triggered || sensor_power_ready(SENSOR_POWER_AHT20)};
 
     esp_err_t ret = aht20_init(&m_handle, &config);
     if (ret == ESP_OK)
@@ -90,7 +104,20 @@ bool AHT20Sensor::read_temp_humidity(float *temp, float *humidity)
     }
 
     float raw_temp, raw_humidity;
-    esp_err_t ret = aht20_read(&m_handle, &raw_temp, &raw_humidity);
+    esp_err_t ret = ESP_FAIL;
+    if (s_triggered)
+    {
+        s_triggered = false;
+        ret = aht20_read_triggered(&m_handle, &raw_temp, &raw_humidity);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGW(TAG, "No result from before sleep, measuring");
+        }
+    }
+    if (ret != ESP_OK)
+    {
+        ret = aht20_read(&m_handle, &raw_temp, &raw_humidity);
+    }
     if (ret != ESP_OK)
     {
         return false;
@@ -103,6 +130,17 @@ bool AHT20Sensor::read_temp_humidity(float *temp, float *humidity)
     return true;
 }
 
+bool AHT20Sensor::trigger_for_next_wake()
+{
+    if (!m_initialized)
+    {
+        return false;
+    }
+
+    s_triggered = aht20_trigger(&m_handle) == ESP_OK;
+    return s_triggered;
+}
+
 bool AHT20Sensor::soft_reset()
 {
     if (!m_initialized)
@@ -36,6 +36,7 @@ public:
 
     /**
      * Constructor with calibration offsets
+     * @param present false skips the initialization (device known absent)
      */
     AHT20Sensor(i2c_port_t i2c_port,
                 gpio_num_t sda_pin,
@@ -44,7 +45,8 @@ public:
                 float temp_offset,
                 float temp_factor,
                 float humidity_offset,
-                float humidity_factor);
+                float humidity_factor,
+                bool present = true);
 
     ~AHT20Sensor() override = default;
 
@@ -57,11 +59,36 @@ public:
     // TempHumiditySensor interface
     bool read_temp_humidity(float *temp, float *humidity) override;
 
+    /**
+     * Start a conversion for the next wake to read instead of measuring
+     * Call right before deep sleep; the result is one period old when read.
+     */
+    bool trigger_for_next_wake();
+
     /**
      * Perform soft reset of sensor
      */
     bool soft_reset();
 
+    /**
+     * Limit the measurements of one read (see aht20_retry_policy_t)
+     */
+    void set_retry_policy(uint8_t max_attempts, uint16_t budget_ms)
+    {
+        aht20_retry_policy_t policy = {max_attempts, budget_ms};
+        aht20_set_retry_policy(&m_handle, &policy);
+    }
+
+    /**
+     * Read counters of the driver
+     */
+    const aht20_stats_t &stats() const { return m_handle.stats; }
+
+    /**
+     * Last 7-byte frame read, for raw capture
+     */
+    const uint8_t *raw_frame() const { return m_handle.last_frame; }
+
     /**
      * Check if sensor is initialized
      */
@@ -22,7 +22,8 @@ BMP280Sensor::BMP280Sensor(i2c_port_t i2c_port,
         .sda_pin = sda_pin,
         .scl_pin = scl_pin,
         .i2c_freq_hz = i2c_freq_hz,
-        .mode = mode};
+        .mode = mode,
+        .continuous_ms = 0};
 
     esp_err_t ret = bmp280_init(&m_handle, &config);
     if (ret == ESP_OK)
@@ -45,16 +46,25 @@ BMP280Sensor::BMP280Sensor(i2c_port_t i2c_port,
                            float temp_offset,
                            float temp_factor,
                            float press_offset,
-                           float press_factor)
+                           float press_factor,
+                           bool present,
+                           uint32_t continuous_ms)
     : m_initialized(false), m_temp_offset(temp_offset), m_temp_factor(temp_factor), m_press_offset(press_offset), m_press_factor(press_factor)
 {
+    if (!present)
+    {
+        ESP_LOGI(TAG, "BMP280 absent, not initialized");
+        return;
+    }
+
     bmp280_config_t config = {
         .i2c_port = i2c_port,
         .i2c_addr = i2c_addr,
         .sda_pin = sda_pin,
         .scl_pin = scl_pin,
         .i2c_freq_hz = i2c_freq_hz,
-        .mode = mode};
+        .mode = mode,
+        .continuous_ms = continuous_ms};
 
     esp_err_t ret = bmp280_init(&m_handle, &config);
     if (ret == ESP_OK)
@@ -110,3 +120,23 @@ bool BMP280Sensor::read_temp_pressure(float *temp, float *pressure)
 
     return true;
 }
+
+bool BMP280Sensor::convert_raw(int32_t adc_T, int32_t adc_P, float *temp, float *pressure)
+{
+    if (!m_initialized || temp == nullptr || pressure == nullptr)
+    {
+        return false;
+    }
+
+    float raw_temp, raw_press;
+    if (bmp280_convert(&m_handle, adc_T, adc_P, &raw_temp, &raw_press) != ESP_OK)
+    {
+        return false;
+    }
+
+    // Apply calibration: calibrated = (raw * factor) + offset
+    *temp = (raw_temp * m_temp_factor) + m_temp_offset;
+    *pressure = (raw_press * m_press_factor) + m_press_offset;
+
+    return true;
+}
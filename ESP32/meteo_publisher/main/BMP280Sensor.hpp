@@ -40,6 +40,9 @@ public:
 
     /**
      * Constructor with calibration offsets
+     * @param present false skips the initialization (device known absent)
+     * @param continuous_ms Non-zero keeps the sensor in normal mode at about
+     *                      this period (see bmp280_config_t)
      */
     BMP280Sensor(i2c_port_t i2c_port,
                  uint8_t i2c_addr,
@@ -50,7 +53,9 @@ public:
                  float temp_offset,
                  float temp_factor,
                  float press_offset,
-                 float press_factor);
+                 float press_factor,
+                 bool present = true,
+                 uint32_t continuous_ms = 0);
 
     ~BMP280Sensor() override = default;
 
@@ -63,6 +68,57 @@ public:
     // TempPressureSensor interface
     bool read_temp_pressure(float *temp, float *pressure) override;
 
+    /**
+     * Convert raw ADC values (e.g. from the wake stub) with calibration applied
+     * @param adc_T Raw 20-bit temperature value
+     * @param adc_P Raw 20-bit pressure value
+     * @param temp Pointer to store temperature in Celsius
+     * @param pressure Pointer to store pressure in Pascals
+     * @return true on success, false on error
+     */
+    bool convert_raw(int32_t adc_T, int32_t adc_P, float *temp, float *pressure);
+
+    /**
+     * Raw ADC values of the last successful read
+     */
+    int32_t last_adc_temp() const { return m_handle.last_adc_T; }
+    int32_t last_adc_press() const { return m_handle.last_adc_P; }
+
+    /**
+     * Register bytes for raw capture: calibration block and last data registers
+     */
+    const uint8_t *raw_calib() const { return m_handle.calib_raw; }
+    const uint8_t *raw_data() const { return m_handle.last_data; }
+
+    /**
+     * True while the sensor measures in normal mode
+     */
+    bool continuous() const { return m_handle.continuous; }
+
+    /**
+     * ctrl_meas register value that triggers a forced measurement
+     */
+    uint8_t forced_ctrl_meas() const { return m_handle.mode_config.ctrl_meas_value; }
+
+    /**
+     * Typical forced measurement time in milliseconds
+     */
+    uint8_t measurement_time_ms() const { return m_handle.mode_config.meas_time_ms; }
+
+    /**
+     * Limit the measurements of one read (see bmp280_retry_policy_t)
+     */
+    void set_retry_policy(uint8_t max_attempts, uint16_t budget_ms)
+    {
+        bmp280_retry_policy_t policy = {max_attempts, budget_ms};
+        bmp280_set_retry_policy(&m_handle, &policy);
+    }
+
+    /**
+     * Read counters of the driver
+     */
+    const bmp280_stats_t &stats() const { return m_handle.stats; }
+
     /**
      * Check if sensor is initialized
      */
@@ -0,0 +1,120 @@
+/**
+ * @file BootTimer.cpp
+ * @brief Wake-cycle timing breakdown implementation
+ */
+
+#include "BootTimer.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rtc_time.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "wake_stub.h"
+}
+
+static const char *TAG = "BOOT";
+
+static constexpr uint32_t STATE_TAG = 0x424F4F54; // "BOOT"
+static constexpr uint16_t STATE_VERSION = 1;
+
+/**
+ * Kept in RTC slow memory across deep sleep
+ */
+struct BootState
+{
+    uint64_t sleep_enter_rtc_us; ///< RTC clock reading at esp_deep_sleep_start()
+    uint64_t sleep_duration_us;  ///< Programmed sleep duration
+    uint32_t last_awake_ms;
+};
+
+RTC_DATA_ATTR static RtcState<BootState, STATE_TAG, STATE_VERSION> s_state;
+
+BootTimer::BootTimer()
+    : m_count(0), m_last_us(esp_timer_get_time()), m_pre_app_us(0), m_startup_us(0)
+{
+    uint64_t rtc_now = esp_rtc_get_time_us();
+    m_startup_us = static_cast<uint32_t>(m_last_us);
+
+    bool timer_wake = s_state.open() && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER &&
+                      s_state->sleep_enter_rtc_us != 0;
+
+#ifdef CONFIG_WAKE_STUB_ENABLED
+    // The stub went back to sleep without updating the sleep entry time:
+    // only the part since application start is known
+    const wake_stub_sample_t *samples = nullptr;
+    if (timer_wake && wake_stub_get_samples(&samples) > 0)
+    {
+        m_pre_app_us = m_startup_us;
+        return;
+    }
+#endif
+
+    if (timer_wake)
+    {
+        uint64_t wake_rtc = s_state->sleep_enter_rtc_us + s_state->sleep_duration_us;
+        if (rtc_now > wake_rtc)
+        {
+            m_pre_app_us = static_cast<uint32_t>(rtc_now - wake_rtc);
+        }
+    }
+    else
+    {
+        // Power-on or reset: the RTC clock started with the chip
+        m_pre_app_us = static_cast<uint32_t>(rtc_now);
+    }
+}
+
+void BootTimer::mark(const char *stage)
+{
+    int64_t now = esp_timer_get_time();
+    if (m_count < MAX_STAGES)
+    {
+        m_stages[m_count].name = stage;
+        m_stages[m_count].duration_us = static_cast<uint32_t>(now - m_last_us);
+        m_count++;
+    }
+    m_last_us = now;
+}
+
+void BootTimer::print() const
+{
+#ifdef CONFIG_BOOT_TIMING_ENABLED
+    uint32_t app_us = 0;
+    for (int i = 0; i < m_count; i++)
+    {
+        app_us += m_stages[i].duration_us;
+    }
+
+    ESP_LOGI(TAG, "Wake timing breakdown:");
+    ESP_LOGI(TAG, "  %-24s %8.1f ms", "wake -> app_main", m_pre_app_us / 1000.0f);
+    if (m_pre_app_us > m_startup_us)
+    {
+        ESP_LOGI(TAG, "    %-22s %8.1f ms", "ROM + bootloader", (m_pre_app_us - m_startup_us) / 1000.0f);
+    }
+    ESP_LOGI(TAG, "    %-22s %8.1f ms", "app startup", m_startup_us / 1000.0f);
+    for (int i = 0; i < m_count; i++)
+    {
+        ESP_LOGI(TAG, "  %-24s %8.1f ms", m_stages[i].name, m_stages[i].duration_us / 1000.0f);
+    }
+    ESP_LOGI(TAG, "  %-24s %8.1f ms", "total awake", (m_pre_app_us + app_us) / 1000.0f);
+#endif
+}
+
+void BootTimer::before_sleep(uint64_t sleep_us)
+{
+    int64_t awake_us = esp_timer_get_time() - m_startup_us + m_pre_app_us;
+
+    s_state->last_awake_ms = static_cast<uint32_t>(awake_us / 1000);
+    s_state->sleep_duration_us = sleep_us;
+    s_state->sleep_enter_rtc_us = esp_rtc_get_time_us();
+    s_state.commit();
+}
+
+uint32_t BootTimer::last_awake_ms()
+{
+    return s_state->last_awake_ms;
+}
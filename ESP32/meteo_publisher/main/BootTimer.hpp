@@ -0,0 +1,73 @@
+/**
+ * @file BootTimer.hpp
+ * @brief Wake-cycle timing breakdown
+ *
+ * Measures how long each wake spends before app_main (ROM, bootloader,
+ * startup) and in each stage of the application, using esp_timer and the
+ * RTC clock. The sleep entry time is kept in RTC memory so the time from
+ * timer wake-up to app_main can be derived on the next boot.
+ * No heap allocation - stages are kept in a fixed-size array.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class BootTimer
+{
+public:
+    static constexpr int MAX_STAGES = 12;
+
+    /**
+     * Constructor - captures app_main entry time
+     * Create as the first statement of app_main.
+     */
+    BootTimer();
+
+    /**
+     * Record the end of a stage (elapsed since the previous mark)
+     * @param stage Static string naming the stage
+     */
+    void mark(const char *stage);
+
+    /**
+     * Print the breakdown to the console (CONFIG_BOOT_TIMING_ENABLED)
+     */
+    void print() const;
+
+    /**
+     * Store sleep entry time and awake duration in RTC memory
+     * Call right before esp_deep_sleep_start().
+     * @param sleep_us Programmed deep sleep duration in microseconds
+     */
+    void before_sleep(uint64_t sleep_us);
+
+    /**
+     * Microseconds from timer wake-up (or power-on) to app_main entry
+     * 0 if unknown (e.g. wake from a source other than the timer)
+     */
+    uint32_t pre_app_us() const { return m_pre_app_us; }
+
+    /**
+     * Microseconds spent in app startup before app_main (esp_timer based)
+     */
+    uint32_t startup_us() const { return m_startup_us; }
+
+    /**
+     * Milliseconds the previous wake was awake (0 after power-on)
+     */
+    static uint32_t last_awake_ms();
+
+private:
+    struct Stage
+    {
+        const char *name;
+        uint32_t duration_us;
+    };
+
+    Stage m_stages[MAX_STAGES];
+    int m_count;
+    int64_t m_last_us;
+    uint32_t m_pre_app_us;
+    uint32_t m_startup_us;
+};
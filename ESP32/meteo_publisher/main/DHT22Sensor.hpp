@@ -53,6 +53,11 @@ public:
      */
     bool is_initialized() const { return m_initialized; }
 
+    /**
+     * Last 5-byte frame read, for raw capture
+     */
+    const uint8_t *raw_frame() const { return m_handle.last_frame; }
+
 private:
     dht22_handle_t m_handle; ///< C driver handle (owned)
     bool m_initialized;
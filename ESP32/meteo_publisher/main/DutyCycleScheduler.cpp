@@ -0,0 +1,229 @@
+/**
+ * @file DutyCycleScheduler.cpp
+ * @brief Battery-aware duty cycle implementation
+ */
+
+#include "DutyCycleScheduler.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include "runtime_config.h"
+#include "time_sync.h"
+#include <string.h>
+}
+
+static const char *TAG = "DUTY";
+
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+static constexpr size_t BATCH_CAPACITY = CONFIG_POWER_BATCH_SIZE;
+#else
+static constexpr size_t BATCH_CAPACITY = 1;
+#endif
+
+static constexpr uint32_t STATE_TAG = 0x44555459; // "DUTY"
+static constexpr uint16_t STATE_VERSION = 1;
+
+#ifdef CONFIG_SCHEDULE_ALIGNED
+// A slot closer than this is skipped: the wake would overlap it
+static constexpr int64_t MIN_SLEEP_US = 1000000;
+#endif
+
+/**
+ * Kept in RTC slow memory across deep sleep and software, panic and
+ * watchdog resets
+ */
+struct SchedulerState
+{
+    uint8_t tier;
+    uint8_t count;
+    uint64_t last_period_us;
+    meteo_measurement_t batch[BATCH_CAPACITY];
+};
+
+RTC_NOINIT_ATTR static RtcState<SchedulerState, STATE_TAG, STATE_VERSION> s_state;
+
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+/**
+ * Tier for a voltage; offset_mv raises the thresholds (hysteresis)
+ */
+static measurement_tier_t tier_for(uint32_t battery_mv, uint32_t offset_mv)
+{
+    const runtime_config_t *config = runtime_config_get();
+    if (battery_mv < config->hibernate_mv + offset_mv)
+    {
+        return MEASUREMENT_TIER_HIBERNATE;
+    }
+    if (battery_mv < config->low_mv + offset_mv)
+    {
+        return MEASUREMENT_TIER_LOW;
+    }
+    if (battery_mv < config->saver_mv + offset_mv)
+    {
+        return MEASUREMENT_TIER_SAVER;
+    }
+    return MEASUREMENT_TIER_NORMAL;
+}
+#endif
+
+#ifdef CONFIG_SCHEDULE_ALIGNED
+/**
+ * Fixed wake offset of this node within a period (FNV-1a of the node name)
+ */
+static int64_t node_offset_us(uint64_t period_us)
+{
+    uint64_t range_us = period_us * CONFIG_SCHEDULE_STAGGER_PERCENT / 100;
+    if (range_us == 0)
+    {
+        return 0;
+    }
+
+    uint32_t hash = 2166136261u;
+    for (const char *c = CONFIG_NODE_NAME; *c != '\0'; c++)
+    {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    // Millisecond steps, so short and long periods spread alike
+    return static_cast<int64_t>(hash % (range_us / 1000 + 1)) * 1000;
+}
+#endif
+
+DutyCycleScheduler::DutyCycleScheduler()
+    : m_tier(MEASUREMENT_TIER_NORMAL), m_previous(MEASUREMENT_TIER_NORMAL)
+{
+    if (!s_state.open())
+    {
+        s_state->tier = MEASUREMENT_TIER_NORMAL;
+        s_state.commit();
+    }
+    m_tier = m_previous = static_cast<measurement_tier_t>(s_state->tier);
+}
+
+measurement_tier_t DutyCycleScheduler::update(uint32_t battery_mv)
+{
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+    if (battery_mv != 0)
+    {
+        // Worse tiers apply at once, better ones only with margin
+        measurement_tier_t tier = tier_for(battery_mv, 0);
+        if (tier < m_previous)
+        {
+            measurement_tier_t recovered = tier_for(battery_mv, CONFIG_POWER_HYSTERESIS_MV);
+            tier = recovered < m_previous ? recovered : m_previous;
+        }
+        m_tier = tier;
+        s_state->tier = tier;
+        s_state.commit();
+    }
+
+    EVLOG3(EVLOG_POWER_TIER, battery_mv, m_tier, s_state->count);
+    ESP_LOGI(TAG, "Battery %lu mV, tier %s%s, %u batched", (unsigned long)battery_mv,
+             measurement_tier_name(m_tier), tier_changed() ? " (changed)" : "", s_state->count);
+#else
+    (void)battery_mv;
+#endif
+    return m_tier;
+}
+
+bool DutyCycleScheduler::should_publish() const
+{
+    switch (m_tier)
+    {
+    case MEASUREMENT_TIER_LOW:
+        // The configured batch may be smaller than the RTC capacity
+        return tier_changed() || static_cast<size_t>(s_state->count) + 1 >= runtime_config_get()->batch_size;
+    case MEASUREMENT_TIER_HIBERNATE:
+        return tier_changed();
+    default:
+        return true;
+    }
+}
+
+uint64_t DutyCycleScheduler::period_us() const
+{
+    uint64_t interval_us = runtime_config_get()->interval_ms * 1000ULL;
+
+#ifdef CONFIG_POWER_SCHEDULER_ENABLED
+    switch (m_tier)
+    {
+    case MEASUREMENT_TIER_SAVER:
+        return interval_us * CONFIG_POWER_SAVER_INTERVAL_FACTOR;
+    case MEASUREMENT_TIER_LOW:
+        return interval_us * CONFIG_POWER_LOW_INTERVAL_FACTOR;
+    case MEASUREMENT_TIER_HIBERNATE:
+        return CONFIG_POWER_HIBERNATE_INTERVAL_S * 1000000ULL;
+    default:
+        break;
+    }
+#endif
+    return interval_us;
+}
+
+uint64_t DutyCycleScheduler::sleep_us() const
+{
+    uint64_t period = period_us();
+#ifdef CONFIG_SCHEDULE_ALIGNED
+    // Time since the last slot of this node, slots at k * period + offset
+    int64_t p = static_cast<int64_t>(period);
+    int64_t offset = node_offset_us(period);
+    int64_t since = ((time_sync_now_us() - offset) % p + p) % p;
+    int64_t sleep = p - since;
+    if (sleep < MIN_SLEEP_US)
+    {
+        sleep += p;
+    }
+    ESP_LOGD(TAG, "Slot offset %lld ms, %s time", static_cast<long long>(offset / 1000),
+             time_sync_valid() ? "wall-clock" : "power-on");
+    return static_cast<uint64_t>(sleep);
+#else
+    return period;
+#endif
+}
+
+uint64_t DutyCycleScheduler::previous_period_us() const
+{
+    return s_state->last_period_us != 0 ? s_state->last_period_us : runtime_config_get()->interval_ms * 1000ULL;
+}
+
+bool DutyCycleScheduler::store(const meteo_measurement_t &m)
+{
+    bool dropped = false;
+    if (s_state->count == BATCH_CAPACITY)
+    {
+        // Keep the newest: the uplink has been failing for a while
+        memmove(&s_state->batch[0], &s_state->batch[1], (BATCH_CAPACITY - 1) * sizeof(meteo_measurement_t));
+        s_state->count--;
+        dropped = true;
+    }
+
+    s_state->batch[s_state->count] = m;
+    s_state->batch[s_state->count].transport = nullptr; // Set by the transport that sends it
+    s_state->count++;
+    s_state.commit();
+    return !dropped;
+}
+
+size_t DutyCycleScheduler::batched() const
+{
+    return s_state->count;
+}
+
+const meteo_measurement_t &DutyCycleScheduler::batched_at(size_t index) const
+{
+    return s_state->batch[index];
+}
+
+void DutyCycleScheduler::clear_batch()
+{
+    s_state->count = 0;
+    s_state.commit();
+}
+
+void DutyCycleScheduler::before_sleep()
+{
+    s_state->last_period_us = period_us();
+    s_state.commit();
+}
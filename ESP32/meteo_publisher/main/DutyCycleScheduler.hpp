@@ -0,0 +1,104 @@
+/**
+ * @file DutyCycleScheduler.hpp
+ * @brief Battery-aware duty cycle: sleep length, LED and uplink batching
+ *
+ * Maps the battery voltage to a tier (measurement_tier_t) with hysteresis,
+ * so a voltage sagging under radio load does not flip tiers every wake.
+ * Lower tiers sleep longer, turn the LED off and collect several
+ * measurements in RTC memory before connecting once to send them all.
+ * Below the critical voltage the node hibernates: it only wakes to check
+ * the battery. Tier and batch survive deep sleep in RTC memory.
+ *
+ * With CONFIG_SCHEDULE_ALIGNED the node sleeps until the next multiple of
+ * the period plus a fixed per-node offset, so the awake time does not add
+ * to the period and a fleet spreads its uplinks over it.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C"
+{
+#include "measurement.h"
+}
+
+class DutyCycleScheduler
+{
+public:
+    /**
+     * Constructor - loads the state kept in RTC memory (reset on power-on)
+     */
+    DutyCycleScheduler();
+
+    /**
+     * Choose the tier of this wake
+     * @param battery_mv Battery voltage, 0 if not measured (tier unchanged)
+     * @return Tier of this wake
+     */
+    measurement_tier_t update(uint32_t battery_mv);
+
+    measurement_tier_t tier() const { return m_tier; }
+
+    /**
+     * True on the first wake after the tier changed
+     */
+    bool tier_changed() const { return m_tier != m_previous; }
+
+    /**
+     * LED signalling allowed in this tier
+     */
+    bool led_enabled() const { return m_tier == MEASUREMENT_TIER_NORMAL; }
+
+    /**
+     * Connect and publish in this wake
+     * False while measurements are being batched or in hibernation;
+     * true on the first wake of a new tier, so the backend sees the change.
+     */
+    bool should_publish() const;
+
+    /**
+     * Wake period of this tier (microseconds)
+     */
+    uint64_t period_us() const;
+
+    /**
+     * Deep sleep duration after this wake (microseconds)
+     * The period, or the time to the next aligned slot with
+     * CONFIG_SCHEDULE_ALIGNED; call right before sleeping.
+     */
+    uint64_t sleep_us() const;
+
+    /**
+     * Wake period of the previous wake (microseconds)
+     */
+    uint64_t previous_period_us() const;
+
+    /**
+     * Keep a measurement for the next publishing wake
+     * @return false if the batch is full (measurement dropped)
+     */
+    bool store(const meteo_measurement_t &m);
+
+    /**
+     * Batched measurements, oldest first
+     */
+    size_t batched() const;
+    const meteo_measurement_t &batched_at(size_t index) const;
+
+    /**
+     * Forget the batch after it was sent
+     */
+    void clear_batch();
+
+    /**
+     * Record the wake period, call right before deep sleep
+     */
+    void before_sleep();
+
+private:
+    measurement_tier_t m_tier;
+    measurement_tier_t m_previous;
+};
@@ -0,0 +1,169 @@
+/**
+ * @file NodeHealth.cpp
+ * @brief Node health counters implementation
+ */
+
+#include "NodeHealth.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "evlog.h"
+#include "nvs.h"
+#include "nvs_lazy.h"
+}
+
+static const char *TAG = "HEALTH";
+
+static constexpr uint32_t STATE_TAG = 0x484C5448; // "HLTH"
+static constexpr uint16_t STATE_VERSION = 1;
+static const char *NVS_NAMESPACE = "health";
+
+/**
+ * Kept in RTC slow memory across deep sleep and software, panic and
+ * watchdog resets
+ */
+struct HealthState
+{
+    measurement_health_t health;
+};
+
+RTC_NOINIT_ATTR static RtcState<HealthState, STATE_TAG, STATE_VERSION> s_state;
+
+static void add_saturated(uint16_t &counter, uint32_t n)
+{
+    uint32_t sum = counter + n;
+    counter = sum > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(sum);
+}
+
+/**
+ * Counter of an abnormal reset, nullptr for regular ones
+ */
+static uint16_t *abnormal_counter(esp_reset_reason_t reason, const char **key)
+{
+    switch (reason)
+    {
+    case ESP_RST_BROWNOUT:
+        *key = "brownouts";
+        return &s_state->health.brownouts;
+    case ESP_RST_PANIC:
+        *key = "panics";
+        return &s_state->health.panics;
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        *key = "watchdogs";
+        return &s_state->health.watchdogs;
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * Load the abnormal reset counters after RTC memory was lost
+ */
+static void load_persistent()
+{
+    if (nvs_lazy_init() != ESP_OK)
+    {
+        return;
+    }
+
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        return; // Never written
+    }
+    nvs_get_u16(nvs, "brownouts", &s_state->health.brownouts);
+    nvs_get_u16(nvs, "panics", &s_state->health.panics);
+    nvs_get_u16(nvs, "watchdogs", &s_state->health.watchdogs);
+    nvs_close(nvs);
+}
+
+static void store_persistent(const char *key, uint16_t value)
+{
+    nvs_handle_t nvs;
+    if (nvs_lazy_init() != ESP_OK || nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Cannot store %s", key);
+        return;
+    }
+    nvs_set_u16(nvs, key, value);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+NodeHealth::NodeHealth()
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (!s_state.open())
+    {
+        load_persistent();
+    }
+
+    s_state->health.wake_cause = static_cast<uint8_t>(esp_sleep_get_wakeup_cause());
+    if (reason == ESP_RST_DEEPSLEEP)
+    {
+        s_state.commit();
+        return;
+    }
+
+    // Not a timer wake: remember why until the next reset
+    s_state->health.reset_reason = static_cast<uint8_t>(reason);
+    const char *key = nullptr;
+    uint16_t *counter = abnormal_counter(reason, &key);
+    if (counter != nullptr)
+    {
+        add_saturated(*counter, 1);
+        store_persistent(key, *counter);
+        ESP_LOGW(TAG, "Reset by %s (%u so far)", measurement_reset_name(reason), *counter);
+    }
+    s_state.commit();
+}
+
+void NodeHealth::sensor_failed(uint32_t count)
+{
+    add_saturated(s_state->health.sensor_failures, count);
+    s_state.commit();
+}
+
+void NodeHealth::wifi_disconnected(uint16_t disconnects, uint8_t last_reason)
+{
+    if (disconnects == 0)
+    {
+        return;
+    }
+    add_saturated(s_state->health.wifi_disconnects, disconnects);
+    s_state->health.wifi_reason = last_reason;
+    s_state.commit();
+}
+
+void NodeHealth::publish_result(bool ok)
+{
+    if (ok)
+    {
+        s_state->health.failed_publishes = 0;
+        s_state.commit();
+        return;
+    }
+    add_saturated(s_state->health.failed_publishes, 1);
+    s_state.commit();
+    ESP_LOGW(TAG, "Publish failed (%u in a row)", s_state->health.failed_publishes);
+}
+
+const measurement_health_t &NodeHealth::summary() const
+{
+    const measurement_health_t &h = s_state->health;
+    EVLOG4(EVLOG_HEALTH, h.reset_reason, h.wake_cause, h.failed_publishes, h.sensor_failures);
+    ESP_LOGI(TAG, "Reset %s, wake %s, %u failed publishes, %u Wi-Fi disconnects (reason %u), "
+                  "%u sensor failures, brownouts/panics/watchdogs %u/%u/%u",
+             measurement_reset_name(h.reset_reason), measurement_wake_name(h.wake_cause),
+             h.failed_publishes, h.wifi_disconnects, h.wifi_reason, h.sensor_failures,
+             h.brownouts, h.panics, h.watchdogs);
+    return h;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file NodeHealth.hpp
+ * @brief Reset, wake and failure counters reported with every measurement
+ *
+ * A node that stops reporting leaves no trace on the backend. This block
+ * keeps why it restarted (esp_reset_reason), why it woke, consecutive
+ * failed publishes, Wi-Fi disconnect reasons and sensor failures in RTC
+ * memory, and sends the summary with each measurement. Brown-outs, panics
+ * and watchdog resets are also counted in NVS, since such resets can clear
+ * RTC memory; NVS is only written on those (rare) boots.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+extern "C"
+{
+#include "measurement.h"
+}
+
+class NodeHealth
+{
+public:
+    /**
+     * Constructor - loads the state kept in RTC memory and records this boot
+     */
+    NodeHealth();
+
+    /**
+     * Count failed sensor initializations or reads of this wake
+     */
+    void sensor_failed(uint32_t count = 1);
+
+    /**
+     * Add the Wi-Fi disconnects of this wake
+     * @param disconnects Disconnect events (wifi_get_disconnects())
+     * @param last_reason Reason of the last one
+     */
+    void wifi_disconnected(uint16_t disconnects, uint8_t last_reason);
+
+    /**
+     * Record the outcome of a publishing wake (resets the failure streak)
+     * @param ok The measurement of this wake was acknowledged by the
+     *           transport (MQTT: PUBACK); a publish that was only queued
+     *           counts as failed
+     */
+    void publish_result(bool ok);
+
+    /**
+     * Summary for the payload, call before publishing
+     */
+    const measurement_health_t &summary() const;
+};
@@ -0,0 +1,186 @@
+/**
+ * @file OversamplingGovernor.cpp
+ * @brief BMP280 oversampling governor implementation
+ */
+
+#include "OversamplingGovernor.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+#include "measurement.h"
+#include "runtime_config.h"
+#include <math.h>
+}
+
+static const char *TAG = "GOVERNOR";
+
+// Readings needed before leaving the most precise profile
+static constexpr uint32_t MIN_SAMPLES = 4;
+
+// Cheaper profiles need this much margin (no flapping at the boundary)
+static constexpr float DOWNGRADE_MARGIN = 1.25f;
+
+// Weight of the newest difference in the variance average (1/4)
+static constexpr float EWMA_WEIGHT = 0.25f;
+
+static constexpr uint32_t STATE_TAG = 0x474F5652; // "GOVR"
+static constexpr uint16_t STATE_VERSION = 1;
+
+/**
+ * Kept in RTC slow memory across deep sleep
+ */
+struct GovernorState
+{
+    uint32_t samples;
+    float last_pressure_pa;
+    float var_pa2;      ///< Average squared wake-to-wake change minus sensor noise
+    uint8_t last_mode;  ///< bmp280_mode_t of last_pressure_pa
+};
+
+RTC_DATA_ATTR static RtcState<GovernorState, STATE_TAG, STATE_VERSION> s_state;
+
+// Cheapest first
+static const bmp280_mode_t MODES[] = {
+    BMP280_MODE_WEATHER_MONITORING,
+    BMP280_MODE_HIGH_RESOLUTION,
+    BMP280_MODE_METEO_ULTRA_PRECISION,
+};
+
+OversamplingGovernor::OversamplingGovernor()
+    : m_selected(BMP280_MODE_METEO_ULTRA_PRECISION), m_previous(BMP280_MODE_METEO_ULTRA_PRECISION)
+{
+    if (!s_state.open())
+    {
+        s_state->last_mode = BMP280_MODE_METEO_ULTRA_PRECISION;
+        s_state.commit();
+    }
+    m_previous = static_cast<bmp280_mode_t>(s_state->last_mode);
+}
+
+float OversamplingGovernor::variability_pa() const
+{
+    return s_state->var_pa2 > 0.0f ? sqrtf(s_state->var_pa2) : 0.0f;
+}
+
+uint8_t OversamplingGovernor::profile_of(bmp280_mode_t mode)
+{
+    switch (mode)
+    {
+    case BMP280_MODE_WEATHER_MONITORING:
+        return MEASUREMENT_PROFILE_LOW;
+    case BMP280_MODE_HIGH_RESOLUTION:
+        return MEASUREMENT_PROFILE_HIGH;
+    case BMP280_MODE_METEO_ULTRA_PRECISION:
+        return MEASUREMENT_PROFILE_ULTRA;
+    default:
+        return MEASUREMENT_PROFILE_UNKNOWN;
+    }
+}
+
+float OversamplingGovernor::noise_pa(bmp280_mode_t mode)
+{
+    // Approximate values from the datasheet noise tables
+    switch (mode)
+    {
+    case BMP280_MODE_WEATHER_MONITORING:
+        return 3.0f;
+    case BMP280_MODE_HIGH_RESOLUTION:
+        return 1.3f;
+    default:
+        return 0.2f;
+    }
+}
+
+bmp280_mode_t OversamplingGovernor::select(uint32_t battery_mv)
+{
+    // A profile set by the backend overrides the governor and the battery check
+    uint8_t forced = runtime_config_get()->bmp_profile;
+    for (bmp280_mode_t mode : MODES)
+    {
+        if (forced != MEASUREMENT_PROFILE_UNKNOWN && profile_of(mode) == forced)
+        {
+            m_selected = mode;
+            ESP_LOGI(TAG, "Profile %s (runtime configuration)", measurement_profile_name(forced));
+            return m_selected;
+        }
+    }
+
+#ifdef CONFIG_GOVERNOR_ENABLED
+    float allowed_pa = CONFIG_GOVERNOR_NOISE_TARGET_CPA / 100.0f;
+    float signal_pa = variability_pa() / CONFIG_GOVERNOR_SIGNAL_RATIO;
+    if (signal_pa > allowed_pa)
+    {
+        allowed_pa = signal_pa;
+    }
+
+    if (s_state->samples < MIN_SAMPLES)
+    {
+        // Learn the variability with the best profile first
+        m_selected = BMP280_MODE_METEO_ULTRA_PRECISION;
+    }
+    else if (CONFIG_GOVERNOR_BATTERY_LOW_MV > 0 && battery_mv > 0 &&
+             battery_mv < CONFIG_GOVERNOR_BATTERY_LOW_MV)
+    {
+        m_selected = BMP280_MODE_WEATHER_MONITORING;
+    }
+    else
+    {
+        m_selected = BMP280_MODE_METEO_ULTRA_PRECISION;
+        for (bmp280_mode_t mode : MODES)
+        {
+            float needed = noise_pa(mode);
+            if (noise_pa(mode) > noise_pa(m_previous))
+            {
+                needed *= DOWNGRADE_MARGIN;
+            }
+            if (needed <= allowed_pa)
+            {
+                m_selected = mode;
+                break;
+            }
+        }
+    }
+
+    EVLOG3(EVLOG_GOVERNOR_PROFILE, profile_of(m_selected), evlog_f(variability_pa()), battery_mv);
+    ESP_LOGI(TAG, "Profile %s (variability %.2f Pa, allowed noise %.2f Pa, battery %lu mV)",
+             measurement_profile_name(profile_of(m_selected)), variability_pa(), allowed_pa,
+             (unsigned long)battery_mv);
+#else
+    (void)battery_mv;
+    m_selected = BMP280_MODE_METEO_ULTRA_PRECISION;
+#endif
+    return m_selected;
+}
+
+void OversamplingGovernor::update(float pressure_pa)
+{
+    if (s_state->samples > 0)
+    {
+        // Both readings carry sensor noise, keep only the change of the signal
+        float diff = pressure_pa - s_state->last_pressure_pa;
+        float noise_prev = noise_pa(static_cast<bmp280_mode_t>(s_state->last_mode));
+        float noise_now = noise_pa(m_selected);
+        float change2 = diff * diff - noise_prev * noise_prev - noise_now * noise_now;
+
+        if (s_state->samples == 1)
+        {
+            s_state->var_pa2 = change2;
+        }
+        else
+        {
+            s_state->var_pa2 += EWMA_WEIGHT * (change2 - s_state->var_pa2);
+        }
+    }
+
+    if (s_state->samples < UINT32_MAX)
+    {
+        s_state->samples++;
+    }
+    s_state->last_pressure_pa = pressure_pa;
+    s_state->last_mode = m_selected;
+    s_state.commit();
+}
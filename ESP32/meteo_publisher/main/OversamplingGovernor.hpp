@@ -0,0 +1,66 @@
+/**
+ * @file OversamplingGovernor.hpp
+ * @brief Picks the cheapest BMP280 oversampling profile that meets a noise target
+ *
+ * The wake-to-wake pressure variance is kept in RTC memory. The sensor noise
+ * of the profiles used is subtracted, what remains is the natural variability
+ * of the signal. When the signal is calm the configured noise target applies;
+ * when it moves a lot a noisier (shorter) measurement is good enough.
+ * A low battery forces the cheapest profile; a profile set through the
+ * runtime configuration (runtime_config.h) overrides both.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+extern "C"
+{
+#include "bmp280.h"
+}
+
+class OversamplingGovernor
+{
+public:
+    /**
+     * Constructor - loads the state kept in RTC memory (reset on power-on)
+     */
+    OversamplingGovernor();
+
+    /**
+     * Choose the profile of this wake
+     * @param battery_mv Battery voltage, 0 if not measured
+     * @return Mode to initialize the BMP280 with
+     */
+    bmp280_mode_t select(uint32_t battery_mv);
+
+    /**
+     * Feed a valid pressure reading taken with the selected mode
+     */
+    void update(float pressure_pa);
+
+    /**
+     * Mode of the last valid reading before this wake (armed in the wake stub)
+     */
+    bmp280_mode_t previous_mode() const { return m_previous; }
+
+    /**
+     * Standard deviation of the natural wake-to-wake pressure change (Pa)
+     */
+    float variability_pa() const;
+
+    /**
+     * measurement_profile_t reported for a mode
+     */
+    static uint8_t profile_of(bmp280_mode_t mode);
+
+    /**
+     * Typical RMS pressure noise of a mode (Pa)
+     */
+    static float noise_pa(bmp280_mode_t mode);
+
+private:
+    bmp280_mode_t m_selected;
+    bmp280_mode_t m_previous;
+};
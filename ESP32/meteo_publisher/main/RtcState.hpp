@@ -0,0 +1,84 @@
+/**
+ * @file RtcState.hpp
+ * @brief Typed state record in RTC memory (C++ side of rtc_store)
+ *
+ * Replaces the magic-number pattern of the modules that keep state across
+ * deep sleep:
+ *
+ *   struct GovernorState { ... };
+ *   RTC_DATA_ATTR static RtcState<GovernorState, 0x474F5652, 1> s_state; // "GOVR"
+ *
+ *   if (!s_state.open())
+ *   {
+ *       s_state->last_mode = ...; // Defaults, the rest is zero
+ *   }
+ *   s_state->samples++;
+ *   s_state.commit();
+ *
+ * open() checks tag, version, firmware and CRC (see rtc_store.h) and zeroes
+ * the state on a mismatch. Access is a plain member access; commit() after
+ * a change keeps the record valid through a reset that is not a deep-sleep
+ * wake. Increment Version when T changes. The object has no constructor,
+ * so it is not cleared at boot (RTC_NOINIT_ATTR works), and no heap
+ * allocation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+
+extern "C"
+{
+#include "rtc_store.h"
+}
+
+template <typename T, uint32_t Tag, uint16_t Version>
+class RtcState
+{
+    static_assert(std::is_trivially_copyable<T>::value, "RTC state must be a plain struct");
+    static_assert(sizeof(T) <= UINT16_MAX, "RTC state too large for the record header");
+
+public:
+    /**
+     * Check the record once per boot
+     * @return true if the state of the previous wake was kept, false if
+     *         it was zeroed and the caller should set its defaults
+     */
+    bool open()
+    {
+        return rtc_store_open(&m_hdr, &m_data, sizeof(T), Tag, Version);
+    }
+
+    /**
+     * Seal the record after a change
+     */
+    void commit()
+    {
+        rtc_store_commit(&m_hdr, &m_data);
+    }
+
+    T *operator->()
+    {
+        return &m_data;
+    }
+
+    const T *operator->() const
+    {
+        return &m_data;
+    }
+
+    T &operator*()
+    {
+        return m_data;
+    }
+
+    const T &operator*() const
+    {
+        return m_data;
+    }
+
+private:
+    rtc_store_hdr_t m_hdr;
+    T m_data;
+};
@@ -0,0 +1,102 @@
+/**
+ * @file SensorPresence.cpp
+ * @brief I²C sensor presence map implementation
+ */
+
+#include "SensorPresence.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+}
+
+static const char *TAG = "PRESENCE";
+
+static constexpr uint32_t STATE_TAG = 0x49324350; // "I2CP"
+static constexpr uint16_t STATE_VERSION = 1;
+
+/**
+ * Kept in RTC slow memory across deep sleep
+ */
+struct PresenceState
+{
+    uint8_t probed[16];  ///< Bit per 7-bit address
+    uint8_t present[16]; ///< Bit per 7-bit address, valid where probed
+    uint32_t wakes_since_probe;
+    bool reprobe;        ///< A present device failed
+};
+
+RTC_DATA_ATTR static RtcState<PresenceState, STATE_TAG, STATE_VERSION> s_state;
+
+static bool test_bit(const uint8_t *map, uint8_t addr)
+{
+    return (map[(addr >> 3) & 0x0F] >> (addr & 7)) & 1;
+}
+
+static void set_bit(uint8_t *map, uint8_t addr, bool value)
+{
+    uint8_t mask = 1 << (addr & 7);
+    if (value)
+    {
+        map[(addr >> 3) & 0x0F] |= mask;
+    }
+    else
+    {
+        map[(addr >> 3) & 0x0F] &= ~mask;
+    }
+}
+
+SensorPresence::SensorPresence()
+{
+    if (!s_state.open())
+    {
+        s_state->reprobe = true;
+        s_state.commit();
+    }
+}
+
+bool SensorPresence::update(i2c_port_t port, const uint8_t *addrs, size_t count)
+{
+    bool stale = s_state->reprobe || s_state->wakes_since_probe >= CONFIG_I2C_REPROBE_WAKES;
+    for (size_t i = 0; i < count && !stale; i++)
+    {
+        stale = !test_bit(s_state->probed, addrs[i]); // Configuration changed
+    }
+
+    if (!stale)
+    {
+        s_state->wakes_since_probe++;
+        s_state.commit();
+        return false;
+    }
+
+    s_state->reprobe = false;
+    s_state->wakes_since_probe = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        esp_err_t ret = i2c_bus_probe(port, addrs[i], CONFIG_I2C_PROBE_TIMEOUT_MS);
+        set_bit(s_state->probed, addrs[i], true);
+        set_bit(s_state->present, addrs[i], ret == ESP_OK);
+        if (ret == ESP_ERR_TIMEOUT)
+        {
+            s_state->reprobe = true; // Bus busy or stuck, not a real answer
+        }
+        ESP_LOGI(TAG, "0x%02X %s", addrs[i], ret == ESP_OK ? "present" : esp_err_to_name(ret));
+    }
+    s_state.commit();
+    return true;
+}
+
+bool SensorPresence::present(uint8_t addr) const
+{
+    return !test_bit(s_state->probed, addr) || test_bit(s_state->present, addr);
+}
+
+void SensorPresence::mark_failed(uint8_t addr)
+{
+    ESP_LOGW(TAG, "0x%02X failed, probing again next wake", addr);
+    s_state->reprobe = true;
+    s_state.commit();
+}
@@ -0,0 +1,49 @@
+/**
+ * @file SensorPresence.hpp
+ * @brief Remembers which I²C sensors answered, so absent ones cost nothing
+ *
+ * The bus is probed with a short timeout at cold boot and the result is
+ * kept in RTC memory. Warm wakes skip the initialization of sensors known
+ * to be absent instead of waiting for their transactions to fail. The bus
+ * is probed again every CONFIG_I2C_REPROBE_WAKES wakes (a sensor may have
+ * been plugged in) and on the wake after a present sensor failed.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C"
+{
+#include "i2c_bus.h"
+}
+
+class SensorPresence
+{
+public:
+    /**
+     * Constructor - loads the map kept in RTC memory (reset on power-on)
+     */
+    SensorPresence();
+
+    /**
+     * Probe the addresses if the map is stale, otherwise count the wake
+     * @param port I²C port with installed driver
+     * @param addrs 7-bit addresses of the configured sensors
+     * @param count Number of addresses
+     * @return true if the bus was probed in this wake
+     */
+    bool update(i2c_port_t port, const uint8_t *addrs, size_t count);
+
+    /**
+     * True if the device answered the last probe, or was never probed
+     */
+    bool present(uint8_t addr) const;
+
+    /**
+     * A device reported present failed: probe again on the next wake
+     */
+    void mark_failed(uint8_t addr);
+};
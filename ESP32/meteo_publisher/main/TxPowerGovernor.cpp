@@ -0,0 +1,136 @@
+/**
+ * @file TxPowerGovernor.cpp
+ * @brief Wi-Fi TX power governor implementation
+ */
+
+#include "TxPowerGovernor.hpp"
+#include "RtcState.hpp"
+
+extern "C"
+{
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "evlog.h"
+}
+
+static const char *TAG = "TXPOWER";
+
+// RSSI of the last wakes that published
+static constexpr uint8_t HISTORY = 8;
+
+static constexpr uint32_t STATE_TAG = 0x57505854; // "TXPW"
+static constexpr uint16_t STATE_VERSION = 1;
+
+#ifdef CONFIG_ESP_PHY_MAX_WIFI_TX_POWER
+static constexpr int8_t MAX_POWER = CONFIG_ESP_PHY_MAX_WIFI_TX_POWER * 4 < 84 ? CONFIG_ESP_PHY_MAX_WIFI_TX_POWER * 4 : 84;
+#else
+static constexpr int8_t MAX_POWER = 80;
+#endif
+
+/**
+ * Kept in RTC slow memory across deep sleep
+ */
+struct TxPowerState
+{
+    int8_t power;    ///< Limit of the next wake (0.25 dBm)
+    uint8_t healthy; ///< Consecutive healthy wakes at this power
+    uint8_t count;   ///< Valid entries in rssi
+    uint8_t next;    ///< Ring buffer position
+    int8_t rssi[HISTORY];
+};
+
+RTC_DATA_ATTR static RtcState<TxPowerState, STATE_TAG, STATE_VERSION> s_state;
+
+TxPowerGovernor::TxPowerGovernor()
+{
+    if (!s_state.open())
+    {
+        s_state->power = MAX_POWER;
+        s_state.commit();
+    }
+}
+
+int8_t TxPowerGovernor::worst_rssi() const
+{
+    int8_t worst = 0;
+    for (uint8_t i = 0; i < s_state->count; i++)
+    {
+        if (i == 0 || s_state->rssi[i] < worst)
+        {
+            worst = s_state->rssi[i];
+        }
+    }
+    return worst;
+}
+
+int8_t TxPowerGovernor::select() const
+{
+#ifdef CONFIG_WIFI_TX_POWER_ADAPTIVE
+    ESP_LOGI(TAG, "TX power %d.%02d dBm (worst RSSI %d dBm, %u healthy wakes)", s_state->power / 4,
+             (s_state->power % 4) * 25, worst_rssi(), s_state->healthy);
+    return s_state->power < MAX_POWER ? s_state->power : 0;
+#else
+    return 0;
+#endif
+}
+
+void TxPowerGovernor::update(bool connected, bool published, int8_t rssi, uint16_t disconnects)
+{
+#ifdef CONFIG_WIFI_TX_POWER_ADAPTIVE
+    int8_t previous = s_state->power;
+
+    if (connected && rssi != 0)
+    {
+        s_state->rssi[s_state->next] = rssi;
+        s_state->next = (s_state->next + 1) % HISTORY;
+        if (s_state->count < HISTORY)
+        {
+            s_state->count++;
+        }
+    }
+
+    // Margin of the weakest recent wake over the floor, and what is already used of it
+    int32_t margin = (worst_rssi() - CONFIG_WIFI_TX_POWER_RSSI_FLOOR) * 4;
+    int32_t reduction = MAX_POWER - s_state->power;
+    int32_t step = CONFIG_WIFI_TX_POWER_STEP_DBM * 4;
+
+    if (!connected || !published || disconnects != 0)
+    {
+        s_state->power = MAX_POWER;
+        s_state->healthy = 0;
+    }
+    else if (reduction > margin)
+    {
+        // The link got weaker: one step back up
+        s_state->power = reduction - step > 0 ? s_state->power + step : MAX_POWER;
+        s_state->healthy = 0;
+    }
+    else
+    {
+        if (s_state->healthy < UINT8_MAX)
+        {
+            s_state->healthy++;
+        }
+        if (s_state->healthy >= CONFIG_WIFI_TX_POWER_STABLE_WAKES && reduction + step <= margin &&
+            s_state->power - step >= CONFIG_WIFI_TX_POWER_MIN_DBM * 4)
+        {
+            s_state->power -= step;
+            s_state->healthy = 0;
+        }
+    }
+
+    s_state.commit();
+
+    if (s_state->power != previous)
+    {
+        EVLOG3(EVLOG_WIFI_TX_POWER, previous, s_state->power, worst_rssi());
+        ESP_LOGI(TAG, "Next wake %d.%02d dBm (connected %d, published %d, %u disconnects)",
+                 s_state->power / 4, (s_state->power % 4) * 25, connected, published, disconnects);
+    }
+#else
+    (void)connected;
+    (void)published;
+    (void)rssi;
+    (void)disconnects;
+#endif
+}
@@ -0,0 +1,48 @@
+/**
+ * @file TxPowerGovernor.hpp
+ * @brief Lowers the Wi-Fi TX power while the link has margin to spare
+ *
+ * The RSSI of recent wakes is kept in RTC memory. The path to the AP is
+ * taken as symmetric: a node that hears the AP well above the RSSI floor
+ * is also heard by it with that margin, so it can transmit that much
+ * weaker. After CONFIG_WIFI_TX_POWER_STABLE_WAKES healthy wakes the power
+ * drops by one step, as long as the weakest RSSI of the history keeps the
+ * reduction within the margin. A failed connect, a disconnect or a publish
+ * without acknowledgement goes back to full power at once.
+ * No heap allocation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class TxPowerGovernor
+{
+public:
+    /**
+     * Constructor - loads the state kept in RTC memory (reset on power-on)
+     */
+    TxPowerGovernor();
+
+    /**
+     * TX power limit of this wake, for wifi_set_tx_power()
+     * @return Maximum TX power in 0.25 dBm, 0 for the driver default
+     */
+    int8_t select() const;
+
+    /**
+     * Feed the outcome of a publishing wake
+     * @param connected Station got an IP address
+     * @param published Uplink session opened and the measurement was
+     *                  acknowledged (MQTT: CONNACK and PUBACK received),
+     *                  not only queued
+     * @param rssi RSSI of this wake (dBm), ignored if not connected
+     * @param disconnects Wi-Fi disconnects during this wake
+     */
+    void update(bool connected, bool published, int8_t rssi, uint16_t disconnects);
+
+    /**
+     * Weakest RSSI of the history (dBm), 0 if empty
+     */
+    int8_t worst_rssi() const;
+};
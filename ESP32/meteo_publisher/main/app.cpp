@@ -7,24 +7,55 @@
  */
 
 #include "SensorInterface.hpp"
+#include "BootTimer.hpp"
 #include "BMP280Sensor.hpp"
 #include "DHT22Sensor.hpp"
 #include "AHT20Sensor.hpp"
+#include "OversamplingGovernor.hpp"
+#include "DutyCycleScheduler.hpp"
+#include "NodeHealth.hpp"
+#include "SensorPresence.hpp"
+#include "TxPowerGovernor.hpp"
 
 extern "C"
 {
+#include "battery.h"
+#include "heap_audit.h"
+#include "i2c_trace.h"
+#include "memstats.h"
+#include "outbox.h"
+#include "power_mgmt.h"
+#include "rtc_store.h"
+#include "runtime_config.h"
+#include "sensor_power.h"
+#include "time_sync.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_sleep.h"
 #include "esp_system.h"
+#include "evlog.h"
 #include "led.h"
-#include "mqtt_pub.h"
-#include "nvs_flash.h"
+#include "measurement.h"
+#include "uplink.h"
+#include "wake_stub.h"
 #include "wifi.h"
 #include "driver/gpio.h"
 #include "driver/rmt_tx.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef CONFIG_UPLINK_TRANSPORT_COAP
+#include "coap_pub.h"
+#elif defined(CONFIG_UPLINK_TRANSPORT_ESPNOW)
+#include "espnow_pub.h"
+#else
+#include "mqtt_pub.h"
+#endif
+#ifdef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+#include "espnow_gateway.h"
+#endif
 }
 
 // ESP32-S3 NeoPixel RGB LED GPIO (from Kconfig or default)
@@ -36,6 +67,14 @@ extern "C"
 
 static const char *TAG = "APP";
 
+#ifdef CONFIG_UPLINK_TRANSPORT_COAP
+static const uplink_transport_t *const s_uplink = &coap_transport;
+#elif defined(CONFIG_UPLINK_TRANSPORT_ESPNOW)
+static const uplink_transport_t *const s_uplink = &espnow_transport;
+#else
+static const uplink_transport_t *const s_uplink = &mqtt_transport;
+#endif
+
 /**
  * Calculate altitude from pressure using standard barometric formula
  * @param pressure_pa Pressure in Pascals
@@ -47,9 +86,42 @@ static float calculate_altitude(float pressure_pa, float sea_level_pa = 101325.0
     return 44330.0f * (1.0f - powf(pressure_pa / sea_level_pa, 1.0f / 5.225f));
 }
 
+/**
+ * Battery voltage of this wake
+ * @return Millivolts, 0 if not measured
+ */
+static uint32_t read_battery_mv()
+{
+    uint32_t mv = 0;
+#ifdef CONFIG_BATTERY_MONITOR_ENABLED
+    battery_handle_t battery;
+    battery_config_t config = {};
+    config.gpio = CONFIG_BATTERY_ADC_GPIO;
+    config.divider_x1000 = CONFIG_BATTERY_DIVIDER_X1000;
+    config.samples = 8;
+
+    if (battery_init(&battery, &config) == ESP_OK)
+    {
+        if (battery_read_mv(&battery, &mv) != ESP_OK)
+        {
+            mv = 0;
+        }
+        battery_deinit(&battery);
+    }
+#endif
+    return mv;
+}
+
+// LED signalling can be turned off at runtime by the duty-cycle tier
+static bool s_led_enabled = true;
+
 // Wrapper functions for LED signaling based on configuration
 __attribute__((unused)) static void signal_led_on()
 {
+    if (!s_led_enabled)
+    {
+        return;
+    }
 #ifdef CONFIG_LED_SIGNALING_ENABLED
 #ifdef CONFIG_LED_TYPE_RGB
     neopixel_set_color(NEOPIXEL_GPIO, 0, 0, 255); // Blue
@@ -72,6 +144,10 @@ static void signal_led_off()
 
 static void signal_led_blink(int duration_ms)
 {
+    if (!s_led_enabled)
+    {
+        return;
+    }
 #ifdef CONFIG_LED_SIGNALING_ENABLED
 #ifdef CONFIG_LED_TYPE_RGB
     neopixel_blink(NEOPIXEL_GPIO, 0, 0, 255, duration_ms); // Blue
@@ -83,6 +159,10 @@ static void signal_led_blink(int duration_ms)
 
 static void signal_led_blink_success(int count)
 {
+    if (!s_led_enabled)
+    {
+        return;
+    }
 #ifdef CONFIG_LED_SIGNALING_ENABLED
 #ifdef CONFIG_LED_TYPE_RGB
     neopixel_blink_success(NEOPIXEL_GPIO, 0, 0, 255, count); // Blue
@@ -92,13 +172,233 @@ static void signal_led_blink_success(int count)
 #endif
 }
 
+/**
+ * Log the driver counters of this wake (only when something was retried or failed)
+ */
+static void log_sensor_stats(const aht20_stats_t *aht20, const bmp280_stats_t *bmp280)
+{
+    if (aht20 != nullptr && (aht20->retries != 0 || aht20->failures != 0))
+    {
+        EVLOG4(EVLOG_AHT20_STATS, aht20->reads, aht20->retries, aht20->crc_errors, aht20->failures);
+        ESP_LOGW(TAG, "AHT20: %lu retries, %lu CRC errors, %lu implausible, %lu bus errors",
+                 (unsigned long)aht20->retries, (unsigned long)aht20->crc_errors,
+                 (unsigned long)aht20->implausible, (unsigned long)aht20->bus_errors);
+    }
+    if (bmp280 != nullptr && (bmp280->retries != 0 || bmp280->failures != 0))
+    {
+        EVLOG4(EVLOG_BMP280_STATS, bmp280->reads, bmp280->retries, bmp280->implausible, bmp280->failures);
+        ESP_LOGW(TAG, "BMP280: %lu retries, %lu implausible, %lu bus errors",
+                 (unsigned long)bmp280->retries, (unsigned long)bmp280->implausible,
+                 (unsigned long)bmp280->bus_errors);
+    }
+}
+
+#ifdef CONFIG_WAKE_STUB_ENABLED
+/**
+ * Publish the raw BMP280 samples buffered by the wake stub, oldest first
+ * Must be called inside an open uplink session.
+ * @param current Measurement of this wake; node fields are reused
+ * @param stub_mode BMP280 mode the stub was armed with
+ * @param interval_s Stub sampling interval
+ */
+static void publish_stub_samples(BMP280Sensor &bmp280, const meteo_measurement_t &current,
+                                 bmp280_mode_t stub_mode, uint32_t interval_s)
+{
+    const wake_stub_sample_t *samples = nullptr;
+    size_t count = wake_stub_get_samples(&samples);
+
+    // The stub's sample from this wake is superseded by the fresh reading
+    wake_stub_boot_reason_t reason = wake_stub_boot_reason();
+    size_t older = (reason == WAKE_STUB_BOOT_FULL || reason == WAKE_STUB_BOOT_THRESHOLD) && count > 0
+                       ? count - 1
+                       : count;
+
+    ESP_LOGI(TAG, "Publishing %u wake stub samples (boot reason %d)", (unsigned)older, reason);
+
+    for (size_t i = 0; i < older; i++)
+    {
+        float temp, pressure;
+        if (!bmp280.convert_raw(samples[i].adc_T, samples[i].adc_P, &temp, &pressure))
+        {
+            continue;
+        }
+
+        meteo_measurement_t m = current;
+        m.dht_temp = m.dht_rh = MEASUREMENT_INVALID;
+        m.aht20_temp = m.aht20_rh = MEASUREMENT_INVALID;
+        m.bmp_temp = temp;
+        m.bmp_press = pressure;
+        m.bmp_profile = OversamplingGovernor::profile_of(stub_mode);
+        m.bmp_noise_pa = OversamplingGovernor::noise_pa(stub_mode);
+        m.altitude_m = calculate_altitude(pressure);
+        m.sample_age_s = (older - i) * interval_s;
+        m.ts_device = current.ts_device - m.sample_age_s;
+        s_uplink->send(&m);
+    }
+
+    wake_stub_clear();
+}
+
+/**
+ * Arm the wake stub with the current reading as reference
+ * Thresholds are converted to raw ADC counts from the local sensitivity.
+ * @param sleep_us Deep sleep duration between stub samples
+ */
+static void arm_wake_stub(BMP280Sensor &bmp280, uint64_t sleep_us)
+{
+    int32_t adc_T = bmp280.last_adc_temp();
+    int32_t adc_P = bmp280.last_adc_press();
+
+    float t0, p0, t1, p1, t2, p2;
+    if (!bmp280.convert_raw(adc_T, adc_P, &t0, &p0) ||
+        !bmp280.convert_raw(adc_T + 1000, adc_P, &t1, &p1) ||
+        !bmp280.convert_raw(adc_T, adc_P + 1000, &t2, &p2))
+    {
+        wake_stub_disarm();
+        return;
+    }
+
+    float temp_per_count = fabsf(t1 - t0) / 1000.0f;
+    float press_per_count = fabsf(p2 - p0) / 1000.0f;
+
+    wake_stub_config_t config = {};
+    config.sda_pin = CONFIG_I2C_SDA_GPIO;
+    config.scl_pin = CONFIG_I2C_SCL_GPIO;
+    config.i2c_addr = CONFIG_BMP280_I2C_ADDR;
+    // 0: sensor runs in normal mode, the stub only reads the latest result
+    config.ctrl_meas = bmp280.continuous() ? 0 : bmp280.forced_ctrl_meas();
+    config.meas_time_ms = bmp280.measurement_time_ms();
+    config.ref_adc_T = adc_T;
+    config.ref_adc_P = adc_P;
+    config.delta_adc_T = temp_per_count > 0.0f
+                             ? static_cast<uint32_t>(CONFIG_WAKE_STUB_TEMP_DELTA_CENTI_C / 100.0f / temp_per_count)
+                             : UINT32_MAX;
+    config.delta_adc_P = press_per_count > 0.0f
+                             ? static_cast<uint32_t>(CONFIG_WAKE_STUB_PRESS_DELTA_PA / press_per_count)
+                             : UINT32_MAX;
+    config.sleep_us = sleep_us;
+
+    wake_stub_arm(&config);
+}
+#endif
+
+/**
+ * Keep a measurement that could not be published
+ * In flash with the outbox, otherwise in the RTC batch of the low tier.
+ */
+static void keep_unsent(DutyCycleScheduler &scheduler, const meteo_measurement_t &m)
+{
+#ifdef CONFIG_OUTBOX_ENABLED
+    (void)scheduler;
+    outbox_store(&m);
+#else
+    if (scheduler.tier() == MEASUREMENT_TIER_LOW)
+    {
+        // Retried with the next batch
+        scheduler.store(m);
+    }
+#endif
+}
+
+/**
+ * Send the measurements batched by the duty-cycle scheduler, oldest first
+ * Must be called inside an open uplink session.
+ */
+static void publish_batch(DutyCycleScheduler &scheduler, int64_t now)
+{
+#ifdef CONFIG_POWER_BATCH_COMPRESSED
+    // One compressed message; one message per measurement if the transport cannot
+    if (s_uplink->send_batch != nullptr && scheduler.batched() > 1 &&
+        s_uplink->send_batch(&scheduler.batched_at(0), scheduler.batched()) == ESP_OK)
+    {
+        scheduler.clear_batch();
+        return;
+    }
+#endif
+    for (size_t i = 0; i < scheduler.batched(); i++)
+    {
+        meteo_measurement_t m = scheduler.batched_at(i);
+        m.sample_age_s = now > m.ts_device ? static_cast<uint32_t>(now - m.ts_device) : 0;
+#ifdef CONFIG_OUTBOX_ENABLED
+        if (s_uplink->send(&m) != ESP_OK)
+        {
+            outbox_store(&m);
+        }
+#else
+        s_uplink->send(&m);
+#endif
+    }
+    scheduler.clear_batch();
+}
+
+/**
+ * Enter deep sleep for the duration chosen by the scheduler
+ */
+static void deep_sleep(BootTimer &boot_timer, DutyCycleScheduler &scheduler)
+{
+    uint64_t sleep_us = scheduler.sleep_us();
+
+    EVLOG1(EVLOG_APP_SLEEP, static_cast<uint32_t>(sleep_us / 1000));
+    ESP_LOGI(TAG, "Sleeping %llu ms (%.1f sec)", sleep_us / 1000, sleep_us / 1000000.0f);
+
+    scheduler.before_sleep();
+    sensor_power_off();
+    power_mgmt_report();
+    esp_sleep_enable_timer_wakeup(sleep_us);
+    boot_timer.before_sleep(sleep_us);
+    rtc_store_commit_all(); // After the last change to RTC state
+    esp_deep_sleep_start();
+}
+
 extern "C" void app_main(void)
 {
+    BootTimer boot_timer;
+
+    evlog_init(esp_reset_reason());
     ESP_LOGI(TAG, "Boot %s FW %s", CONFIG_NODE_NAME, CONFIG_FW_VERSION);
+    NodeHealth health;
+
+#ifndef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+    // Scaled clock and light sleep while waiting; the gateway must keep listening
+    power_mgmt_init();
+#endif
 
     // Turn off the NeoPixel RGB LED immediately (always turn off at boot)
     neopixel_off(NEOPIXEL_GPIO);
 
+    // Battery first: the tier decides what this wake does
+    uint32_t battery_mv = read_battery_mv();
+    DutyCycleScheduler scheduler;
+    scheduler.update(battery_mv);
+    s_led_enabled = scheduler.led_enabled() && runtime_config_get()->led;
+    bool publish = scheduler.should_publish();
+    boot_timer.mark("battery");
+
+#ifndef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+    if (scheduler.tier() == MEASUREMENT_TIER_HIBERNATE && !publish)
+    {
+        // Battery critical: only check it again later
+#ifdef CONFIG_WAKE_STUB_ENABLED
+        wake_stub_disarm();
+#endif
+        deep_sleep(boot_timer, scheduler);
+    }
+#endif
+
+#ifdef CONFIG_WAKE_STUB_ENABLED
+    // The stub booted us to publish its buffer
+    const wake_stub_sample_t *stub_samples = nullptr;
+    if (wake_stub_get_samples(&stub_samples) > 0)
+    {
+        publish = true;
+    }
+#endif
+
+#ifndef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+    // Gated sensors warm up while the LED, netif and Wi-Fi start
+    sensor_power_on();
+#endif
+
     // Initialize LED and signal activity
 #ifdef CONFIG_LED_SIGNALING_ENABLED
 #ifndef CONFIG_LED_TYPE_RGB
@@ -111,12 +411,40 @@ extern "C" void app_main(void)
     ESP_ERROR_CHECK(led_init());
 #endif
 
-    // Initialize system
-    ESP_ERROR_CHECK(nvs_flash_init());
+    boot_timer.mark("led init");
+
+    // Initialize system (NVS is initialized lazily by its users)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+    boot_timer.mark("netif + event loop");
 
-    wifi_init_and_connect();
+#ifdef CONFIG_METEO_ROLE_ESPNOW_GATEWAY
+    // Gateway role: forward ESP-NOW frames to MQTT, never sleeps
+    wifi_init_and_connect(0);
+    espnow_gateway_run();
+#endif
+
+    bool link_up = true;
+#ifndef CONFIG_UPLINK_TRANSPORT_ESPNOW
+    // ESP-NOW does not associate; the radio is started by the transport
+    TxPowerGovernor tx_power;
+    if (publish)
+    {
+        wifi_set_tx_power(tx_power.select());
+        power_lock_acquire(POWER_LOCK_RADIO);
+        link_up = wifi_init_and_connect(CONFIG_WIFI_CONNECT_TIMEOUT_MS) == ESP_OK;
+        if (link_up)
+        {
+            // Answer collected after the uplink session
+            time_sync_start();
+        }
+        power_lock_release(POWER_LOCK_RADIO);
+        uint8_t reason = 0;
+        uint16_t disconnects = wifi_get_disconnects(&reason);
+        health.wifi_disconnected(disconnects, reason);
+        boot_timer.mark("wifi connect");
+    }
+#endif
 
     // Initialize sensors using C++ wrappers
     ESP_LOGI(TAG, "Initializing sensors...");
@@ -124,6 +452,34 @@ extern "C" void app_main(void)
     // Sensor pointer for temperature/pressure sensor
     TempPressureSensor *temp_pressure_sensor = nullptr;
 
+#if defined(CONFIG_AHT20_ENABLED) || defined(CONFIG_BMP280_ENABLED)
+    // Bus recovery and probe need the sensors up: wait out what is left
+    sensor_power_wait(SENSOR_POWER_BMP280);
+    sensor_power_wait(SENSOR_POWER_AHT20);
+#ifdef CONFIG_SENSOR_POWER_GATING
+    boot_timer.mark("sensor warm-up");
+#endif
+
+    // Free a stuck bus, then skip sensors that did not answer the last probe
+    i2c_bus_config_t bus_config = {
+        .port = I2C_NUM_0,
+        .sda_pin = static_cast<gpio_num_t>(CONFIG_I2C_SDA_GPIO),
+        .scl_pin = static_cast<gpio_num_t>(CONFIG_I2C_SCL_GPIO),
+        .freq_hz = 100000};
+    i2c_bus_init(&bus_config);
+
+    static const uint8_t i2c_addrs[] = {
+#ifdef CONFIG_AHT20_ENABLED
+        AHT20_I2C_ADDR,
+#endif
+#ifdef CONFIG_BMP280_ENABLED
+        CONFIG_BMP280_I2C_ADDR,
+#endif
+    };
+    SensorPresence presence;
+    presence.update(I2C_NUM_0, i2c_addrs, sizeof(i2c_addrs));
+#endif
+
 #ifdef CONFIG_DHT22_ENABLED
     // Create DHT22 sensor - no calibration applied
     DHT22Sensor dht22(static_cast<gpio_num_t>(CONFIG_DHT22_GPIO),
@@ -133,6 +489,7 @@ extern "C" void app_main(void)
     if (!dht22.is_initialized())
     {
         ESP_LOGE(TAG, "DHT22 initialization failed");
+        health.sensor_failed();
     }
     else
     {
@@ -146,45 +503,80 @@ extern "C" void app_main(void)
                       static_cast<gpio_num_t>(CONFIG_I2C_SDA_GPIO),
                       static_cast<gpio_num_t>(CONFIG_I2C_SCL_GPIO),
                       100000,
-                      0.0f, 1.0f,  // temp: offset=0, factor=1
-                      0.0f, 1.0f); // humidity: offset=0, factor=1
+                      0.0f, 1.0f, // temp: offset=0, factor=1
+                      0.0f, 1.0f, // humidity: offset=0, factor=1
+                      presence.present(AHT20_I2C_ADDR));
 
     if (!aht20.is_initialized())
     {
-        ESP_LOGE(TAG, "AHT20 initialization failed");
+        if (presence.present(AHT20_I2C_ADDR))
+        {
+            ESP_LOGE(TAG, "AHT20 initialization failed");
+            health.sensor_failed();
+            presence.mark_failed(AHT20_I2C_ADDR);
+        }
     }
     else
     {
+        aht20.set_retry_policy(CONFIG_SENSOR_READ_ATTEMPTS, CONFIG_AHT20_RETRY_BUDGET_MS);
         ESP_LOGI(TAG, "AHT20 sensor enabled");
     }
 #endif
 
 #ifdef CONFIG_BMP280_ENABLED
+    // Oversampling profile from the recent pressure variance and the battery
+    OversamplingGovernor governor;
+    bmp280_mode_t bmp_mode = governor.select(battery_mv);
+
+#ifdef CONFIG_BMP280_NORMAL_MODE
+    // Keep converting between wakes, except in hibernation (too long a period)
+    uint32_t bmp_continuous_ms = scheduler.tier() != MEASUREMENT_TIER_HIBERNATE
+                                     ? static_cast<uint32_t>(scheduler.period_us() / 1000)
+                                     : 0;
+#else
+    uint32_t bmp_continuous_ms = 0;
+#endif
+
     // Create BMP280 sensor - apply -1.2°C offset for module heating compensation
     BMP280Sensor bmp280(I2C_NUM_0,
                         CONFIG_BMP280_I2C_ADDR,
                         static_cast<gpio_num_t>(CONFIG_I2C_SDA_GPIO),
                         static_cast<gpio_num_t>(CONFIG_I2C_SCL_GPIO),
                         100000,
-                        BMP280_MODE_METEO_ULTRA_PRECISION,
-                        0.0f, 1.0f,  // temp: offset=0, factor=1 (applied later if needed)
-                        0.0f, 1.0f); // pressure: offset=0, factor=1
+                        bmp_mode,
+                        0.0f, 1.0f, // temp: offset=0, factor=1 (applied later if needed)
+                        0.0f, 1.0f, // pressure: offset=0, factor=1
+                        presence.present(CONFIG_BMP280_I2C_ADDR),
+                        bmp_continuous_ms);
 
     if (!bmp280.is_initialized())
     {
-        ESP_LOGE(TAG, "BMP280 initialization failed");
+        if (presence.present(CONFIG_BMP280_I2C_ADDR))
+        {
+            ESP_LOGE(TAG, "BMP280 initialization failed");
+            health.sensor_failed();
+            presence.mark_failed(CONFIG_BMP280_I2C_ADDR);
+        }
     }
     else
     {
+        bmp280.set_retry_policy(CONFIG_SENSOR_READ_ATTEMPTS, CONFIG_BMP280_RETRY_BUDGET_MS);
         temp_pressure_sensor = &bmp280;
         ESP_LOGI(TAG, "BMP280 sensor enabled");
     }
 #endif
 
+    boot_timer.mark("sensor init");
+
     // Blink to indicate sensor initialization complete
     signal_led_blink(200);
     vTaskDelay(pdMS_TO_TICKS(100));
 
+    // Everything the measure phase needs exists now: reads and payload
+    // assembly must not touch the heap
+    heap_audit_counts_t heap_use;
+    heap_audit_begin(HEAP_AUDIT_PHASE_MEASURE, &heap_use);
+
     // Read sensors using interfaces
     float dht_temp = 0.0f, dht_humidity = 0.0f;
     float aht20_temp = 0.0f, aht20_humidity = 0.0f;
@@ -194,9 +586,11 @@ extern "C" void app_main(void)
 #ifdef CONFIG_DHT22_ENABLED
     if (dht22.is_initialized())
     {
+        sensor_power_wait(SENSOR_POWER_DHT22);
         if (!dht22.read_temp_humidity(&dht_temp, &dht_humidity))
         {
             ESP_LOGW(TAG, "Failed to read DHT22 sensor");
+            health.sensor_failed();
             dht_temp = -999.0f;
             dht_humidity = -999.0f;
         }
@@ -215,6 +609,7 @@ extern "C" void app_main(void)
         if (!aht20.read_temp_humidity(&aht20_temp, &aht20_humidity))
         {
             ESP_LOGW(TAG, "Failed to read AHT20 sensor");
+            health.sensor_failed();
             aht20_temp = -999.0f;
             aht20_humidity = -999.0f;
         }
@@ -227,14 +622,23 @@ extern "C" void app_main(void)
     }
 
     // Read temperature and pressure sensor (BMP280)
+    bool bmp_valid = false;
     if (temp_pressure_sensor != nullptr)
     {
-        if (!temp_pressure_sensor->read_temp_pressure(&bmp_temp, &bmp_pressure))
+        bmp_valid = temp_pressure_sensor->read_temp_pressure(&bmp_temp, &bmp_pressure);
+        if (!bmp_valid)
         {
             ESP_LOGW(TAG, "Failed to read temperature/pressure sensor");
+            health.sensor_failed();
             bmp_temp = -999.0f;
             bmp_pressure = -999.0f;
         }
+#ifdef CONFIG_BMP280_ENABLED
+        else
+        {
+            governor.update(bmp_pressure);
+        }
+#endif
     }
     else
     {
@@ -243,8 +647,33 @@ extern "C" void app_main(void)
         bmp_pressure = -999.0f;
     }
 
+    log_sensor_stats(
+#ifdef CONFIG_AHT20_ENABLED
+        aht20.is_initialized() ? &aht20.stats() : nullptr,
+#else
+        nullptr,
+#endif
+#ifdef CONFIG_BMP280_ENABLED
+        bmp280.is_initialized() ? &bmp280.stats() : nullptr
+#else
+        nullptr
+#endif
+    );
+
+    boot_timer.mark("sensor read");
+#ifdef CONFIG_I2C_TRACE_ENABLED
+    i2c_trace_dump();
+#endif
+
+    // Sensors stay off through the uplink session and the sleep
+    sensor_power_off();
+
     // Get WiFi signal strength
-    int8_t rssi = wifi_get_rssi();
+#ifdef CONFIG_UPLINK_TRANSPORT_ESPNOW
+    int8_t rssi = 0; // Measured by the gateway
+#else
+    int8_t rssi = publish && link_up ? wifi_get_rssi() : 0;
+#endif
 
     // Calculate altitude from pressure
     float altitude_m = calculate_altitude(bmp_pressure);
@@ -252,26 +681,180 @@ extern "C" void app_main(void)
     // Get free heap memory
     uint32_t free_heap = esp_get_free_heap_size();
 
+    EVLOG2(EVLOG_APP_ALTITUDE, evlog_f(altitude_m), free_heap);
     ESP_LOGI(TAG, "Altitude: %.1f m, Free heap: %lu bytes", altitude_m, free_heap);
 
-    // Publish measurements
-    mqtt_publish_measurement(CONFIG_NODE_NAME, CONFIG_FW_VERSION,
-                             dht_temp, dht_humidity,
-                             aht20_temp, aht20_humidity,
-                             bmp_temp, bmp_pressure,
-                             rssi, altitude_m, free_heap);
+    meteo_measurement_t measurement;
+    measurement_init(&measurement);
+    snprintf(measurement.device_id, sizeof(measurement.device_id), "%s", CONFIG_NODE_NAME);
+    snprintf(measurement.fw, sizeof(measurement.fw), "%s", CONFIG_FW_VERSION);
+    measurement.ts_device = time(NULL);
+    measurement.rssi = rssi;
+#ifndef CONFIG_UPLINK_TRANSPORT_ESPNOW
+    measurement.tx_power = publish && link_up ? wifi_get_tx_power() : 0;
+#endif
+    measurement.altitude_m = altitude_m;
+    measurement.free_heap = free_heap;
+    measurement.dht_temp = dht_temp;
+    measurement.dht_rh = dht_humidity;
+    measurement.aht20_temp = aht20_temp;
+    measurement.aht20_rh = aht20_humidity;
+    measurement.bmp_temp = bmp_temp;
+    measurement.bmp_press = bmp_pressure;
+    measurement.last_awake_ms = BootTimer::last_awake_ms();
+    measurement.cfg_version = runtime_config_get()->version;
+#ifdef CONFIG_BMP280_ENABLED
+    if (bmp_valid)
+    {
+        measurement.bmp_profile = OversamplingGovernor::profile_of(bmp_mode);
+        measurement.bmp_noise_pa = OversamplingGovernor::noise_pa(bmp_mode);
+    }
+#endif
+    if (battery_mv != 0)
+    {
+        measurement.battery_mv = static_cast<uint16_t>(battery_mv);
+        measurement.power_tier = scheduler.tier();
+    }
+    measurement.health = health.summary();
+#ifdef CONFIG_SENSOR_RAW_CAPTURE
+    // Frames of the values above; attached only to this wake's message
+    measurement_raw_t raw = {};
+#ifdef CONFIG_BMP280_ENABLED
+    if (bmp_valid)
+    {
+        memcpy(raw.bmp280_calib, bmp280.raw_calib(), sizeof(raw.bmp280_calib));
+        memcpy(raw.bmp280, bmp280.raw_data(), sizeof(raw.bmp280));
+        raw.present |= MEASUREMENT_RAW_BMP280;
+    }
+#endif
+#ifdef CONFIG_AHT20_ENABLED
+    if (aht20_temp != MEASUREMENT_INVALID)
+    {
+        memcpy(raw.aht20, aht20.raw_frame(), sizeof(raw.aht20));
+        raw.present |= MEASUREMENT_RAW_AHT20;
+    }
+#endif
+#ifdef CONFIG_DHT22_ENABLED
+    if (dht_temp != MEASUREMENT_INVALID)
+    {
+        memcpy(raw.dht22, dht22.raw_frame(), sizeof(raw.dht22));
+        raw.present |= MEASUREMENT_RAW_DHT22;
+    }
+#endif
+#endif
+    heap_audit_end(HEAP_AUDIT_PHASE_MEASURE, &heap_use);
+#ifdef CONFIG_OUTBOX_ENABLED
+    measurement.seq = outbox_next_seq();
+#endif
+    heap_audit_begin(HEAP_AUDIT_PHASE_PUBLISH, &heap_use);
+
+    // Publish measurements, or keep them for a later wake while batching;
+    // the whole session runs at full clock
+    bool sent = false;
+    if (publish)
+    {
+        power_lock_acquire(POWER_LOCK_RADIO);
+    }
+    if (!publish)
+    {
+        scheduler.store(measurement);
+        boot_timer.mark("batch");
+    }
+    else if (link_up && s_uplink->connect(CONFIG_NODE_NAME) == ESP_OK)
+    {
+        // Peak of the wake: radio, network stack and uplink client all running
+        memstats_sample(&measurement.memory);
+        memstats_log(&measurement.memory);
+#ifdef CONFIG_OUTBOX_ENABLED
+        // Backlog of earlier failed wakes first, in this session
+        outbox_replay(s_uplink, CONFIG_OUTBOX_REPLAY_MAX, CONFIG_OUTBOX_REPLAY_INTERVAL_MS);
+#endif
+#ifdef CONFIG_WAKE_STUB_ENABLED
+        if (temp_pressure_sensor != nullptr)
+        {
+            publish_stub_samples(bmp280, measurement, governor.previous_mode(),
+                                 static_cast<uint32_t>(scheduler.previous_period_us() / 1000000));
+        }
+#endif
+        publish_batch(scheduler, measurement.ts_device);
+#ifdef CONFIG_SENSOR_RAW_CAPTURE
+        measurement.raw = &raw;
+#endif
+#ifdef CONFIG_I2C_TRACE_PAYLOAD
+        measurement_i2c_t i2c;
+        i2c_trace_summary(&i2c);
+        measurement.i2c = &i2c;
+#endif
+        // Confirmed delivery: MQTT returns ESP_OK only after the PUBACK
+        sent = s_uplink->send(&measurement) == ESP_OK;
+        // Kept copies (outbox, batch) never carry the frames or the trace
+        measurement.raw = nullptr;
+        measurement.i2c = nullptr;
+        health.publish_result(sent);
+        if (!sent)
+        {
+            keep_unsent(scheduler, measurement);
+        }
+        s_uplink->disconnect();
+        boot_timer.mark("publish");
+    }
+    else
+    {
+        health.publish_result(false);
+        keep_unsent(scheduler, measurement);
+    }
+    // Also on batching and failed wakes, where the report matters most
+    heap_audit_end(HEAP_AUDIT_PHASE_PUBLISH, &heap_use);
+    if (publish)
+    {
+#ifdef CONFIG_SCHEDULE_SNTP_ENABLED
+        if (link_up)
+        {
+            time_sync_finish(CONFIG_SCHEDULE_SNTP_WAIT_MS);
+        }
+#endif
+        power_lock_release(POWER_LOCK_RADIO);
+#ifndef CONFIG_UPLINK_TRANSPORT_ESPNOW
+        // Only an acknowledged measurement lets the power step down
+        tx_power.update(link_up, sent, rssi, wifi_get_disconnects(nullptr));
+#endif
+    }
 
     // Success indication
     signal_led_blink_success(3);
-
-    ESP_LOGI(TAG, "Sleeping %d ms (%.1f sec)",
-             CONFIG_PUBLISH_INTERVAL,
-             CONFIG_PUBLISH_INTERVAL / 1000.0f);
+    boot_timer.mark("led signal");
+    boot_timer.print();
 
     // Turn off LED before deep sleep
     signal_led_off();
 
+#ifdef CONFIG_WAKE_STUB_ENABLED
+    if (temp_pressure_sensor == nullptr)
+    {
+        // Raw samples cannot be converted without the BMP280: drop them,
+        // or the full buffer would force a publish on every wake
+        wake_stub_clear();
+    }
+
+    // Next wakes sample from the stub until the buffer fills up
+    if (bmp_valid && scheduler.tier() != MEASUREMENT_TIER_HIBERNATE)
+    {
+        arm_wake_stub(bmp280, scheduler.period_us());
+    }
+    else
+    {
+        wake_stub_disarm();
+    }
+#endif
+
+#ifdef CONFIG_AHT20_PRETRIGGER
+    // The next wake reads this conversion instead of waiting for one
+    if (aht20.is_initialized())
+    {
+        aht20.trigger_for_next_wake();
+    }
+#endif
+
     // Enter deep sleep
-    esp_sleep_enable_timer_wakeup(CONFIG_PUBLISH_INTERVAL * 1000ULL);
-    esp_deep_sleep_start();
+    deep_sleep(boot_timer, scheduler);
 }
@@ -0,0 +1,19 @@
+# Power-management profile: CPU clock scaled down and automatic light sleep
+# while a wake waits for sensors, LED and MQTT acknowledgements.
+# Compare awake current and duration with and without it, see
+# docs/BUILD_PROFILES.md.
+#
+# idf.py -D SDKCONFIG_DEFAULTS="sdkconfig.defaults;sdkconfig.defaults.pm" build
+
+# ESP-IDF power management and tickless idle (needed for light sleep)
+CONFIG_PM_ENABLE=y
+CONFIG_FREERTOS_USE_TICKLESS_IDLE=y
+
+# Frequency scaling between 40 MHz and the default CPU frequency,
+# full clock only while I2C, DHT22 or radio hold their lock
+CONFIG_POWER_MGMT_ENABLED=y
+CONFIG_POWER_MGMT_MIN_FREQ_MHZ=40
+CONFIG_POWER_MGMT_LIGHT_SLEEP=y
+
+# Time per power mode and per lock, for measurement builds only
+# CONFIG_PM_PROFILING=y
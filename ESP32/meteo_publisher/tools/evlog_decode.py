@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Decode the binary event log uploaded by the firmware (CONFIG_EVLOG_ENABLED).
+
+The event table is read from components/evlog/evlog_events.h so the decoder
+always matches the firmware source tree it ships with.
+
+Usage:
+    # Request an upload on the next wake, then capture it
+    mosquitto_pub -h <broker> -r -t sensors/<node>/log/request -m 1
+    mosquitto_sub -h <broker> -t sensors/<node>/log -C 1 > log.bin
+    python3 tools/evlog_decode.py log.bin
+
+    # Or fetch directly (requires paho-mqtt)
+    python3 tools/evlog_decode.py --broker <broker> --node <node>
+"""
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+from typing import List, Tuple
+
+EVLOG_MAGIC = 0x45564C47
+EVLOG_FORMAT_VERSION = 1
+
+HEADER = struct.Struct("<IBBHHHII")
+RECORD = struct.Struct("<IHBB4I")
+
+EVENTS_H = Path(__file__).resolve().parent.parent / "components" / "evlog" / "evlog_events.h"
+EVENT_RE = re.compile(r'^EVLOG_EVENT\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', re.MULTILINE)
+SPEC_RE = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?([dioxXufeEgGc%])")
+
+
+def load_events(path: Path) -> List[Tuple[str, str]]:
+    return [(m.group(1), m.group(2).encode().decode("unicode_escape"))
+            for m in EVENT_RE.finditer(path.read_text())]
+
+
+def render(fmt: str, args: List[int]) -> str:
+    values = []
+    it = iter(args)
+    for spec in SPEC_RE.finditer(fmt):
+        conv = spec.group(1)
+        if conv == "%":
+            continue
+        word = next(it, 0)
+        if conv in "feEgG":
+            values.append(struct.unpack("<f", struct.pack("<I", word))[0])
+        elif conv in "di":
+            values.append(struct.unpack("<i", struct.pack("<I", word))[0])
+        else:
+            values.append(word)
+    return fmt % tuple(values)
+
+
+def decode(blob: bytes, events: List[Tuple[str, str]]) -> None:
+    if len(blob) < HEADER.size:
+        sys.exit("Log too short")
+
+    magic, version, rec_size, capacity, head, count, wake, dropped = HEADER.unpack_from(blob)
+    if magic != EVLOG_MAGIC:
+        sys.exit(f"Bad magic 0x{magic:08X}")
+    if version != EVLOG_FORMAT_VERSION or rec_size != RECORD.size:
+        sys.exit(f"Unsupported log format v{version} (record size {rec_size})")
+
+    print(f"# wake={wake} records={count}/{capacity} dropped={dropped}")
+
+    first = (head - count) % capacity
+    for i in range(count):
+        slot = (first + i) % capacity
+        offset = HEADER.size + slot * rec_size
+        ts_ms, ev_id, rec_wake, nargs, *args = RECORD.unpack_from(blob, offset)
+
+        if ev_id < len(events):
+            name, fmt = events[ev_id]
+            try:
+                text = render(fmt, args[:nargs])
+            except (TypeError, ValueError):
+                text = f"{fmt} {args[:nargs]}"
+        else:
+            name, text = f"EVENT_{ev_id}", " ".join(f"0x{a:08X}" for a in args[:nargs])
+
+        print(f"[w{rec_wake:3d} {ts_ms:8d} ms] {name}: {text}")
+
+
+def fetch_mqtt(broker: str, port: int, node: str, user: str, password: str) -> bytes:
+    import paho.mqtt.client as mqtt
+
+    result = {}
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(f"sensors/{node}/log")
+
+    def on_message(client, userdata, msg):
+        result["blob"] = msg.payload
+        client.disconnect()
+
+    client = mqtt.Client()
+    if user and password:
+        client.username_pw_set(user, password)
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, port, keepalive=60)
+    client.publish(f"sensors/{node}/log/request", "1", qos=1, retain=True)
+    print(f"# waiting for next wake of {node}...", file=sys.stderr)
+    client.loop_forever()
+    return result["blob"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode meteo_publisher binary event log")
+    parser.add_argument("file", nargs="?", help="Raw log dump (default: stdin)")
+    parser.add_argument("--broker", help="Request and fetch the log over MQTT")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--node", help="Node name (CONFIG_NODE_NAME)")
+    parser.add_argument("--user", default=None)
+    parser.add_argument("--password", default=None)
+    parser.add_argument("--events", type=Path, default=EVENTS_H, help="Path to evlog_events.h")
+    args = parser.parse_args()
+
+    events = load_events(args.events)
+
+    if args.broker:
+        if not args.node:
+            parser.error("--node is required with --broker")
+        blob = fetch_mqtt(args.broker, args.port, args.node, args.user, args.password)
+    elif args.file:
+        blob = Path(args.file).read_bytes()
+    else:
+        blob = sys.stdin.buffer.read()
+
+    decode(blob, events)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""
+Export recorded measurements from the Orange Pi database as CSV, the input
+of the batch codec benchmark (host/tscodec_bench) and, with --raw, of the
+sensor conversion replay (host/sensor_replay).
+
+Empty cells are missing readings. Rows without a device timestamp use the
+server timestamp.
+
+Usage:
+    python3 tools/export_measurements.py environment_data.db > measurements.csv
+    python3 tools/export_measurements.py environment_data.db --device node-1 --days 30 -o m.csv
+    host/build/tscodec_bench measurements.csv --batch 4
+    python3 tools/export_measurements.py environment_data.db --raw -o raw.csv
+    host/build/sensor_replay raw.csv
+"""
+
+import argparse
+import csv
+import sqlite3
+import sys
+import time
+
+COLUMNS = [
+    "device_id",
+    "COALESCE(timestamp_device, timestamp_server) AS timestamp_device",
+    "seq",
+    "dht22_temperature_c",
+    "dht22_humidity_percent",
+    "aht20_temperature_c",
+    "aht20_humidity_percent",
+    "bmp280_temperature_c",
+    "bmp280_pressure_pa",
+    "battery_mv",
+]
+
+# Register bytes sent by nodes built with CONFIG_SENSOR_RAW_CAPTURE
+RAW_COLUMNS = [
+    "raw_bmp280_calib",
+    "raw_bmp280",
+    "raw_aht20",
+    "raw_dht22",
+]
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("db", help="SQLite database written by main.py")
+    parser.add_argument("--device", help="only this device_id")
+    parser.add_argument("--days", type=float, help="only the last N days")
+    parser.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    parser.add_argument("--raw", action="store_true", help="add the raw sensor frames, only rows that have them")
+    args = parser.parse_args()
+
+    columns = COLUMNS + RAW_COLUMNS if args.raw else COLUMNS
+    where, params = [], []
+    if args.device:
+        where.append("device_id = ?")
+        params.append(args.device)
+    if args.days:
+        where.append("timestamp_server >= ?")
+        params.append(int(time.time() - args.days * 86400))
+    if args.raw:
+        where.append("COALESCE(" + ", ".join(RAW_COLUMNS) + ") IS NOT NULL")
+
+    query = f"SELECT {', '.join(columns)} FROM measurements"
+    if where:
+        query += " WHERE " + " AND ".join(where)
+    query += " ORDER BY device_id, timestamp_device"
+
+    conn = sqlite3.connect(f"file:{args.db}?mode=ro", uri=True)
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out, lineterminator="\n")
+    writer.writerow([c.split(" AS ")[-1] for c in columns])
+    rows = 0
+    for row in conn.execute(query, params):
+        writer.writerow(["" if v is None else v for v in row])
+        rows += 1
+    if out is not sys.stdout:
+        out.close()
+    print(f"{rows} measurements exported", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
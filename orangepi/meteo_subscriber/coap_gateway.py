@@ -0,0 +1,186 @@
+import os
+import socket
+import logging
+import time
+from typing import Dict, List, Optional, Tuple
+
+from dotenv import load_dotenv
+import paho.mqtt.client as mqtt
+
+# ----------------------------
+# Load environment variables
+# ----------------------------
+
+load_dotenv()
+
+MQTT_USERNAME = os.getenv("MQTT_USERNAME")
+MQTT_PASSWORD = os.getenv("MQTT_PASSWORD")
+MQTT_BROKER = os.getenv("MQTT_BROKER", "localhost")
+MQTT_PORT = int(os.getenv("MQTT_PORT", "1883"))
+
+COAP_BIND = os.getenv("COAP_BIND", "0.0.0.0")
+COAP_PORT = int(os.getenv("COAP_PORT", "5683"))
+
+LOG_LEVEL = os.getenv("LOG_LEVEL", "INFO").upper()
+
+# ----------------------------
+# Logging
+# ----------------------------
+
+logging.basicConfig(
+    level=getattr(logging, LOG_LEVEL, logging.INFO),
+    format="%(asctime)s [%(levelname)s] %(message)s",
+)
+
+# ----------------------------
+# CoAP (RFC 7252) - just enough for the node's POST
+# ----------------------------
+
+COAP_VERSION = 1
+TYPE_CON, TYPE_NON, TYPE_ACK, TYPE_RST = 0, 1, 2, 3
+CODE_POST = 0x02
+CODE_CHANGED = 0x44  # 2.04
+CODE_BAD_REQUEST = 0x80  # 4.00
+CODE_NOT_FOUND = 0x84  # 4.04
+OPTION_URI_PATH = 11
+
+# Duplicates of a CON message arrive within EXCHANGE_LIFETIME (~247 s)
+DEDUP_WINDOW_S = 247
+
+
+class CoapMessage:
+    def __init__(self, mtype: int, code: int, message_id: int, token: bytes,
+                 uri_path: List[str], payload: bytes):
+        self.mtype = mtype
+        self.code = code
+        self.message_id = message_id
+        self.token = token
+        self.uri_path = uri_path
+        self.payload = payload
+
+
+def _option_value(data: bytes, pos: int, nibble: int) -> Tuple[int, int]:
+    if nibble < 13:
+        return nibble, pos
+    if nibble == 13:
+        return data[pos] + 13, pos + 1
+    if nibble == 14:
+        return (data[pos] << 8 | data[pos + 1]) + 269, pos + 2
+    raise ValueError("reserved option nibble")
+
+
+def parse_message(data: bytes) -> Optional[CoapMessage]:
+    if len(data) < 4 or data[0] >> 6 != COAP_VERSION:
+        return None
+
+    mtype = (data[0] >> 4) & 0x03
+    tkl = data[0] & 0x0F
+    code = data[1]
+    message_id = data[2] << 8 | data[3]
+    if tkl > 8 or len(data) < 4 + tkl:
+        return None
+    token = data[4:4 + tkl]
+
+    pos = 4 + tkl
+    number = 0
+    uri_path: List[str] = []
+    payload = b""
+    try:
+        while pos < len(data):
+            if data[pos] == 0xFF:
+                payload = data[pos + 1:]
+                break
+            delta, length = data[pos] >> 4, data[pos] & 0x0F
+            pos += 1
+            delta, pos = _option_value(data, pos, delta)
+            length, pos = _option_value(data, pos, length)
+            number += delta
+            value = data[pos:pos + length]
+            pos += length
+            if number == OPTION_URI_PATH:
+                uri_path.append(value.decode("utf-8"))
+    except (IndexError, ValueError, UnicodeDecodeError):
+        return None
+
+    return CoapMessage(mtype, code, message_id, token, uri_path, payload)
+
+
+def build_ack(request: CoapMessage, code: int) -> bytes:
+    # Piggybacked response: ACK with the request's message id and token
+    header = bytes([
+        COAP_VERSION << 6 | TYPE_ACK << 4 | len(request.token),
+        code,
+        request.message_id >> 8,
+        request.message_id & 0xFF,
+    ])
+    return header + request.token
+
+
+# ----------------------------
+# Gateway
+# ----------------------------
+
+
+def handle_request(request: CoapMessage, client: mqtt.Client) -> int:
+    if request.code != CODE_POST:
+        return CODE_BAD_REQUEST
+
+    # /sensors/<node>/environment maps 1:1 onto the MQTT topic
+    if len(request.uri_path) != 3 or request.uri_path[0] != "sensors":
+        return CODE_NOT_FOUND
+
+    topic = "/".join(request.uri_path)
+    client.publish(topic, request.payload, qos=1)
+    logging.info(f"Republished {len(request.payload)} bytes to {topic}")
+    return CODE_CHANGED
+
+
+def serve(sock: socket.socket, client: mqtt.Client) -> None:
+    # (address, message id) -> (time, response code)
+    seen: Dict[Tuple[Tuple[str, int], int], Tuple[float, int]] = {}
+
+    while True:
+        data, addr = sock.recvfrom(1500)
+        request = parse_message(data)
+        if request is None or request.mtype not in (TYPE_CON, TYPE_NON):
+            logging.debug(f"Ignoring datagram from {addr}")
+            continue
+
+        now = time.monotonic()
+        seen = {k: v for k, v in seen.items() if now - v[0] < DEDUP_WINDOW_S}
+
+        key = (addr, request.message_id)
+        if key in seen:
+            # Retransmission: our ACK was lost, answer again without republishing
+            logging.debug(f"Duplicate message {request.message_id} from {addr}")
+            code = seen[key][1]
+        else:
+            code = handle_request(request, client)
+            seen[key] = (now, code)
+
+        if request.mtype == TYPE_CON:
+            sock.sendto(build_ack(request, code), addr)
+
+
+# ----------------------------
+# Main
+# ----------------------------
+
+
+def main():
+    client = mqtt.Client()
+    if MQTT_USERNAME and MQTT_PASSWORD:
+        client.username_pw_set(MQTT_USERNAME, MQTT_PASSWORD)
+
+    client.connect(MQTT_BROKER, MQTT_PORT, keepalive=60)
+    client.loop_start()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((COAP_BIND, COAP_PORT))
+
+    logging.info(f"CoAP gateway listening on {COAP_BIND}:{COAP_PORT}")
+    serve(sock, client)
+
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,8 @@ from typing import Any, Dict
 from dotenv import load_dotenv
 import paho.mqtt.client as mqtt
 
+import tscodec
+
 # ----------------------------
 # Load environment variables
 # ----------------------------
@@ -24,6 +26,11 @@ SQLITE_DB = os.getenv("SQLITE_DB", "environment_data.db")
 
 LOG_LEVEL = os.getenv("LOG_LEVEL", "INFO").upper()
 
+# Node health: resets that point to a hardware or firmware fault, and the
+# failed publish streak that is worth a warning
+ABNORMAL_RESETS = {"brownout", "panic", "int_wdt", "task_wdt", "wdt"}
+UNHEALTHY_PUBLISH_FAILURES = int(os.getenv("UNHEALTHY_PUBLISH_FAILURES", "3"))
+
 # ----------------------------
 # Logging
 # ----------------------------
@@ -66,6 +73,47 @@ def init_db(conn: sqlite3.Connection) -> None:
         )
     """)
 
+    # Columns added after the first deployment
+    existing = {row[1] for row in cursor.execute("PRAGMA table_info(measurements)")}
+    for column, sql_type in (
+        ("transport", "TEXT"),
+        ("awake_ms", "INTEGER"),
+        ("bmp280_profile", "TEXT"),
+        ("bmp280_noise_pa", "REAL"),
+        ("battery_mv", "INTEGER"),
+        ("power_tier", "TEXT"),
+        ("reset_reason", "TEXT"),
+        ("wake_cause", "TEXT"),
+        ("failed_publishes", "INTEGER"),
+        ("wifi_disconnects", "INTEGER"),
+        ("wifi_reason", "INTEGER"),
+        ("sensor_failures", "INTEGER"),
+        ("brownouts", "INTEGER"),
+        ("panics", "INTEGER"),
+        ("watchdogs", "INTEGER"),
+        ("min_free_heap", "INTEGER"),
+        ("largest_free_block", "INTEGER"),
+        ("free_internal", "INTEGER"),
+        ("free_psram", "INTEGER"),
+        ("stack_main", "INTEGER"),
+        ("stack_wifi", "INTEGER"),
+        ("stack_tcpip", "INTEGER"),
+        ("stack_event", "INTEGER"),
+        ("stack_mqtt", "INTEGER"),
+        ("seq", "INTEGER"),
+        ("cfg_version", "INTEGER"),
+        ("tx_power_dbm", "REAL"),
+        ("raw_bmp280_calib", "TEXT"),
+        ("raw_bmp280", "TEXT"),
+        ("raw_aht20", "TEXT"),
+        ("raw_dht22", "TEXT"),
+        ("i2c_busy_us", "INTEGER"),
+        ("i2c_errors", "INTEGER"),
+        ("i2c_trace", "TEXT"),
+    ):
+        if column not in existing:
+            cursor.execute(f"ALTER TABLE measurements ADD COLUMN {column} {sql_type}")
+
     cursor.execute("""
         CREATE INDEX IF NOT EXISTS idx_device_time
         ON measurements(device_id, timestamp_server)
@@ -76,6 +124,11 @@ def init_db(conn: sqlite3.Connection) -> None:
         ON measurements(timestamp_server)
     """)
 
+    cursor.execute("""
+        CREATE INDEX IF NOT EXISTS idx_device_seq
+        ON measurements(device_id, seq)
+    """)
+
     conn.commit()
 
 
@@ -105,18 +158,48 @@ def on_message(client, userdata, msg):
     conn: sqlite3.Connection = userdata["db"]
     now = int(time.time())
 
+    # Compressed batch of a battery-powered node (tscodec.py)
+    if msg.topic.endswith("/batch"):
+        device_id = msg.topic.split("/")[-2]
+        try:
+            samples = tscodec.decode(msg.payload)
+        except ValueError as e:
+            logging.warning(f"Invalid batch from {device_id}: {e}")
+            return
+        for sample in samples:
+            store_payload(conn, msg.topic, tscodec.to_payload(sample, device_id), now)
+        return
+
+    # Only measurements are stored; other node topics (e.g. the binary
+    # event log under sensors/<node>/log) are handled by dedicated tools
+    if not msg.topic.endswith("/environment"):
+        logging.debug(f"Ignoring message on {msg.topic}")
+        return
+
     try:
         payload = json.loads(msg.payload.decode("utf-8"))
     except json.JSONDecodeError:
         logging.warning("Received non-JSON payload")
         return
 
+    store_payload(conn, msg.topic, payload, now)
+
+
+def store_payload(conn: sqlite3.Connection, topic: str, payload: Dict[str, Any], now: int) -> None:
     device_id = payload.get("device_id", "unknown")
     firmware = payload.get("fw")
     ts_device = payload.get("ts_device")
     rssi = payload.get("rssi")
+    # Wi-Fi TX power limit of the wake (adapted to the link margin on some nodes)
+    tx_power_dbm = payload.get("tx_dbm")
     altitude_m = payload.get("altitude_m")
     free_heap = payload.get("free_heap")
+    transport = payload.get("transport")
+    awake_ms = payload.get("awake_ms")
+
+    # Samples buffered on the node (wake stub) carry their age in seconds
+    sample_age_s = payload.get("sample_age_s") or 0
+    timestamp = now - int(sample_age_s)
 
     dht22_temp = safe_get(payload, "dht22", "temperature_c")
     dht22_rh = safe_get(payload, "dht22", "humidity_percent")
@@ -126,9 +209,60 @@ def on_message(client, userdata, msg):
 
     bmp_temp = safe_get(payload, "bmp280", "temperature_c")
     bmp_press = safe_get(payload, "bmp280", "pressure_pa")
+    # Oversampling profile chosen by the node, tells the precision of the sample
+    bmp_profile = safe_get(payload, "bmp280", "profile")
+    bmp_noise = safe_get(payload, "bmp280", "noise_pa")
+
+    # Battery-powered nodes report their voltage and duty-cycle tier
+    battery_mv = safe_get(payload, "battery", "mv")
+    power_tier = safe_get(payload, "battery", "tier")
+
+    # Health summary: why the node last reset and what has been failing
+    health = payload.get("health") or {}
+    reset_reason = health.get("reset")
+    if reset_reason in ABNORMAL_RESETS or (health.get("pub_fail") or 0) >= UNHEALTHY_PUBLISH_FAILURES:
+        logging.warning(
+            f"{device_id} unhealthy: reset={reset_reason} pub_fail={health.get('pub_fail')} "
+            f"wifi_reason={health.get('wifi_reason')} sensor_fail={health.get('sensor_fail')}"
+        )
+
+    # Memory sampled at the peak of the wake; unused stack in bytes, null if no such task
+    memory = payload.get("mem") or {}
+    stacks = memory.get("stack") or {}
+
+    # Numbered measurements (node outbox): QoS 1 may deliver one twice, and a
+    # jump in the numbers means measurements were lost on the node
+    seq = payload.get("seq")
+
+    # Version of sensors/<node>/config the node runs with (absent: Kconfig values)
+    cfg_version = payload.get("cfg")
+
+    # Register bytes of the sensor values (debug nodes), hex; see host/sensor_replay
+    raw = payload.get("raw") or {}
+
+    # I2C trace of the wake (debug nodes): bus time and failed transactions
+    # over all devices, the per-device counters and histograms kept as JSON
+    i2c = payload.get("i2c")
+    i2c_busy_us = i2c_errors = i2c_trace = None
+    if isinstance(i2c, dict):
+        devices = [d for d in i2c.values() if isinstance(d, dict)]
+        i2c_busy_us = sum(d.get("us") or 0 for d in devices)
+        i2c_errors = sum((d.get("nack") or 0) + (d.get("tmo") or 0) for d in devices)
+        i2c_trace = json.dumps(i2c, separators=(",", ":"))
 
     try:
         cursor = conn.cursor()
+        if seq is not None:
+            last_seq, duplicate = cursor.execute(
+                "SELECT MAX(seq), SUM(seq = ?) FROM measurements WHERE device_id = ?",
+                (seq, device_id),
+            ).fetchone()
+            if duplicate:
+                logging.info(f"Duplicate seq {seq} from {device_id} ignored")
+                return
+            if last_seq is not None and seq > last_seq + 1:
+                logging.warning(f"{device_id} gap: seq {last_seq + 1}..{seq - 1} not received")
+
         cursor.execute(
             """
             INSERT INTO measurements (
@@ -145,12 +279,46 @@ def on_message(client, userdata, msg):
                 firmware_version,
                 rssi,
                 altitude_m,
-                free_heap
-            ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
+                free_heap,
+                transport,
+                awake_ms,
+                bmp280_profile,
+                bmp280_noise_pa,
+                battery_mv,
+                power_tier,
+                reset_reason,
+                wake_cause,
+                failed_publishes,
+                wifi_disconnects,
+                wifi_reason,
+                sensor_failures,
+                brownouts,
+                panics,
+                watchdogs,
+                min_free_heap,
+                largest_free_block,
+                free_internal,
+                free_psram,
+                stack_main,
+                stack_wifi,
+                stack_tcpip,
+                stack_event,
+                stack_mqtt,
+                seq,
+                cfg_version,
+                tx_power_dbm,
+                raw_bmp280_calib,
+                raw_bmp280,
+                raw_aht20,
+                raw_dht22,
+                i2c_busy_us,
+                i2c_errors,
+                i2c_trace
+            ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)
         """,
             (
                 device_id,
-                msg.topic,
+                topic,
                 dht22_temp,
                 dht22_rh,
                 aht20_temp,
@@ -158,11 +326,45 @@ def on_message(client, userdata, msg):
                 bmp_temp,
                 bmp_press,
                 ts_device,
-                now,
+                timestamp,
                 firmware,
                 rssi,
                 altitude_m,
                 free_heap,
+                transport,
+                awake_ms,
+                bmp_profile,
+                bmp_noise,
+                battery_mv,
+                power_tier,
+                reset_reason,
+                health.get("wake"),
+                health.get("pub_fail"),
+                health.get("wifi_disc"),
+                health.get("wifi_reason"),
+                health.get("sensor_fail"),
+                health.get("brownout"),
+                health.get("panic"),
+                health.get("wdt"),
+                memory.get("min_free"),
+                memory.get("largest"),
+                memory.get("internal"),
+                memory.get("psram"),
+                stacks.get("main"),
+                stacks.get("wifi"),
+                stacks.get("tcpip"),
+                stacks.get("event"),
+                stacks.get("mqtt"),
+                seq,
+                cfg_version,
+                tx_power_dbm,
+                raw.get("bmp280_calib"),
+                raw.get("bmp280"),
+                raw.get("aht20"),
+                raw.get("dht22"),
+                i2c_busy_us,
+                i2c_errors,
+                i2c_trace,
             ),
         )
         conn.commit()
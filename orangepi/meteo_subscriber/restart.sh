@@ -6,6 +6,7 @@
 echo "Restarting Meteo services..."
 
 sudo systemctl restart meteo-mqtt
+sudo systemctl restart meteo-coap
 sudo systemctl restart meteo-web
 
 sleep 2
@@ -15,6 +16,9 @@ echo "------"
 echo "MQTT Service:"
 sudo systemctl status meteo-mqtt --no-pager -l | head -n 5
 echo ""
+echo "CoAP Gateway:"
+sudo systemctl status meteo-coap --no-pager -l | head -n 5
+echo ""
 echo "Web Service:"
 sudo systemctl status meteo-web --no-pager -l | head -n 5
 echo ""
@@ -12,7 +12,7 @@ echo ""
 
 # Variables
 PROJECT_DIR="/home/<your_user>/dafer-embedded/orangepi/meteo_subscriber"
-SERVICE_FILES=("meteo-mqtt.service" "meteo-web.service")
+SERVICE_FILES=("meteo-mqtt.service" "meteo-coap.service" "meteo-web.service")
 SYSTEMD_DIR="/etc/systemd/system"
 
 # Check if running as root or with sudo
@@ -93,6 +93,7 @@ echo "================================================"
 echo ""
 echo "Services installed and started:"
 echo "  • meteo-mqtt.service  - MQTT listener"
+echo "  • meteo-coap.service  - CoAP gateway"
 echo "  • meteo-web.service   - Web dashboard"
 echo ""
 echo "Useful commands:"
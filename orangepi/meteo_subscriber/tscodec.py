@@ -0,0 +1,126 @@
+"""
+Decoder for the compressed measurement batches of battery-powered nodes
+(CONFIG_POWER_BATCH_COMPRESSED, topic sensors/<node>/batch).
+
+Mirrors components/uplink/tscodec.c in the firmware; see that header for
+the format. Values come back at the 0.01 resolution of the JSON payload.
+"""
+
+from typing import Any, Dict, List, Optional, Tuple
+
+MAGIC = 0x54
+VERSION = 1
+
+MODE_ABSENT = 0
+MODE_ALL_VALID = 1
+MODE_GAPS = 2
+
+# Channel order of the encoder: (payload section, field, scale)
+CHANNELS: List[Tuple[str, str, float]] = [
+    ("dht22", "temperature_c", 100.0),
+    ("dht22", "humidity_percent", 100.0),
+    ("aht20", "temperature_c", 100.0),
+    ("aht20", "humidity_percent", 100.0),
+    ("bmp280", "temperature_c", 100.0),
+    ("bmp280", "pressure_pa", 100.0),
+    ("battery", "mv", 1.0),
+]
+
+
+class _Reader:
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def byte(self) -> int:
+        if self.pos >= len(self.data):
+            raise ValueError("truncated batch")
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self) -> int:
+        value = 0
+        for shift in range(0, 64, 7):
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+        raise ValueError("varint too long")
+
+    def signed(self) -> int:
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+
+def decode(data: bytes) -> List[Dict[str, Any]]:
+    """Decode a batch into samples, oldest first; raises ValueError if invalid."""
+    r = _Reader(data)
+    if r.byte() != MAGIC or r.byte() != VERSION:
+        raise ValueError("not a tscodec batch")
+    count = r.byte()
+    if count == 0:
+        raise ValueError("empty batch")
+
+    ts = [r.signed()]
+    last_age = r.signed()
+    seq = [r.varint()]
+
+    delta = 0
+    for i in range(1, count):
+        v = r.signed()
+        delta = v if i == 1 else delta + v
+        ts.append(ts[-1] + delta)
+    for _ in range(1, count):
+        seq.append(seq[-1] + 1 + r.signed())
+
+    values: List[List[Optional[float]]] = []
+    for _, _, scale in CHANNELS:
+        mode = r.byte()
+        column: List[Optional[float]] = [None] * count
+        if mode not in (MODE_ABSENT, MODE_ALL_VALID, MODE_GAPS):
+            raise ValueError(f"unknown channel mode {mode}")
+        if mode != MODE_ABSENT:
+            bits = 0xFF
+            value = None
+            for i in range(count):
+                if mode == MODE_GAPS and i % 8 == 0:
+                    bits = r.byte()
+                if bits & (1 << (i % 8)):
+                    v = r.signed()
+                    value = v if value is None else value + v
+                    column[i] = round(value / scale, 2) if scale != 1.0 else value
+        values.append(column)
+
+    if r.pos != len(data):
+        raise ValueError("trailing bytes")
+
+    now = ts[-1] + last_age
+    samples = []
+    for i in range(count):
+        sample: Dict[str, Any] = {
+            "ts_device": ts[i],
+            "sample_age_s": max(now - ts[i], 0),
+            "seq": seq[i] or None,
+        }
+        for (section, field, _), column in zip(CHANNELS, values):
+            sample[f"{section}.{field}"] = column[i]
+        samples.append(sample)
+    return samples
+
+
+def to_payload(sample: Dict[str, Any], device_id: str) -> Dict[str, Any]:
+    """Shape a decoded sample like the JSON payload, for the same storage path."""
+    payload: Dict[str, Any] = {
+        "device_id": device_id,
+        "ts_device": sample["ts_device"],
+        "sample_age_s": sample["sample_age_s"],
+        "transport": "mqtt",
+    }
+    if sample["seq"] is not None:
+        payload["seq"] = sample["seq"]
+    for section, field, _ in CHANNELS:
+        value = sample[f"{section}.{field}"]
+        if value is not None:
+            payload.setdefault(section, {})[field] = value
+    return payload